@@ -0,0 +1,205 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AsyncSimulation.h"
+#include "spring_mass.h"
+#include "SpringMassStats.h"
+#include "HAL/RunnableThread.h"
+
+
+AsyncSimulation::AsyncSimulation(SpringMassSystem& system)
+	: m_system(system)
+{
+}
+
+AsyncSimulation::~AsyncSimulation()
+{
+	stop();
+}
+
+void
+AsyncSimulation::start(const SpringMassSettings& settings, float stepRate, float maxStep)
+{
+	if (m_thread)
+	{
+		return;
+	}
+	m_system.applySettings(settings);
+	m_step = 1.0f / FMath::Max(stepRate, 1.0f);
+	m_maxStep = maxStep;
+
+	// both sides start out with the current positions
+	const TArray<FVector3f>& positions = m_system.massPoints.positions;
+	m_previous = positions;
+	for (Snapshot& snapshot : m_snapshots)
+	{
+		snapshot.previous = positions;
+		snapshot.current = positions;
+		snapshot.time = FPlatformTime::Seconds();
+		snapshot.step = m_step;
+	}
+	m_writing = 0;
+	m_ready = 1;
+	m_reading = 2;
+
+	m_stopping = false;
+	m_thread = FRunnableThread::Create(this, TEXT("SpringMassSimulation"), 0, TPri_AboveNormal);
+}
+
+void
+AsyncSimulation::stop()
+{
+	if (!m_thread)
+	{
+		return;
+	}
+	m_thread->Kill(true);
+	delete m_thread;
+	m_thread = nullptr;
+
+	// forces sent after the last step still count
+	processCommands();
+}
+
+void
+AsyncSimulation::addForce(uint32 id, const FVector3f& f)
+{
+	Command command;
+	command.type = Command::Type::Force;
+	command.id = id;
+	command.force = f;
+	m_commands.Enqueue(command);
+}
+
+void
+AsyncSimulation::applySettings(const SpringMassSettings& settings)
+{
+	Command command;
+	command.type = Command::Type::Settings;
+	command.settings = settings;
+	m_commands.Enqueue(command);
+}
+
+void
+AsyncSimulation::setColliders(const SpringMassColliders& colliders)
+{
+	FScopeLock lock(&m_collidersLock);
+	m_pendingColliders = colliders;
+	m_collidersChanged = true;
+}
+
+bool
+AsyncSimulation::interpolate(TArray<FVector3f>& positions)
+{
+	// take the newest snapshot if the simulation published one since the last call
+	if (m_ready.load() & FreshBit)
+	{
+		m_reading = m_ready.exchange(m_reading) & ~FreshBit;
+	}
+	const Snapshot& snapshot = m_snapshots[m_reading];
+	const int32 n = snapshot.current.Num();
+	if (n == 0)
+	{
+		return false;
+	}
+
+	const float alpha = FMath::Clamp(float(FPlatformTime::Seconds() - snapshot.time) / snapshot.step, 0.0f, 1.0f);
+	positions.SetNumUninitialized(n, false);
+	for (int32 i = 0; i < n; i++)
+	{
+		positions[i] = FMath::Lerp(snapshot.previous[i], snapshot.current[i], alpha);
+	}
+	return true;
+}
+
+uint32
+AsyncSimulation::Run()
+{
+	double next = FPlatformTime::Seconds();
+	while (!m_stopping)
+	{
+		processCommands();
+		advance();
+		publish();
+
+		// sleep until the next step is due, or drop the time the thread fell behind by
+		next += m_step;
+		const double now = FPlatformTime::Seconds();
+		if (next > now)
+		{
+			FPlatformProcess::SleepNoStats(float(next - now));
+		}
+		else if (now - next > MaxLag)
+		{
+			next = now;
+		}
+	}
+	return 0;
+}
+
+void
+AsyncSimulation::Stop()
+{
+	m_stopping = true;
+}
+
+void
+AsyncSimulation::processCommands()
+{
+	Command command;
+	while (m_commands.Dequeue(command))
+	{
+		switch (command.type)
+		{
+		case Command::Type::Force:
+			m_system.addForce(command.id, command.force);
+			break;
+		case Command::Type::Settings:
+			m_system.applySettings(command.settings);
+			break;
+		}
+	}
+
+	FScopeLock lock(&m_collidersLock);
+	if (m_collidersChanged)
+	{
+		Swap(m_system.m_collision.m_colliders, m_pendingColliders);
+		m_collidersChanged = false;
+	}
+}
+
+void
+AsyncSimulation::advance()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpringMassSimulate);
+	TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassSimulate);
+	if (m_system.m_solver != ESpringMassSolver::Explicit)
+	{
+		INC_DWORD_STAT(STAT_SpringMassSubsteps);
+		m_system.step(m_step);
+		return;
+	}
+
+	// the same time per step, in substeps as large as the springs allow
+	const float limit = FMath::Min(m_maxStep, m_system.estimateStableStep());
+	const int32 substeps = FMath::Max(1, FMath::CeilToInt(m_step / limit));
+	INC_DWORD_STAT_BY(STAT_SpringMassSubsteps, substeps);
+	for (int32 i = 0; i < substeps; i++)
+	{
+		m_system.step(m_step / substeps);
+	}
+}
+
+void
+AsyncSimulation::publish()
+{
+	const TArray<FVector3f>& positions = m_system.massPoints.positions;
+	Snapshot& snapshot = m_snapshots[m_writing];
+	snapshot.previous = m_previous;
+	snapshot.current = positions;
+	snapshot.time = FPlatformTime::Seconds();
+	snapshot.step = m_step;
+	m_previous = positions;
+
+	// hand the snapshot over and continue with the one that was ready
+	m_writing = m_ready.exchange(m_writing | FreshBit) & ~FreshBit;
+}
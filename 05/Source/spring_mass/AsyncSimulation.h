@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SpringMassSystem.h"
+
+#include "HAL/Runnable.h"
+#include "HAL/CriticalSection.h"
+#include "Containers/Queue.h"
+
+#include <atomic>
+
+class FRunnableThread;
+
+/**
+ * Runs a spring-mass system on a dedicated thread at a fixed rate, decoupled
+ * from the frame rate of the game thread.
+ *
+ * While the thread runs it owns the system. The game thread hands it forces
+ * and settings through a lock-free queue and reads the positions back from
+ * a triple buffer: the simulation fills one snapshot while the game thread
+ * reads another and the third holds the newest one, the buffers change hands
+ * by exchanging one atomic index. Each snapshot carries the positions before
+ * and after its step, the game thread interpolates between them by the time
+ * passed since the snapshot was published, so the mesh moves smoothly one
+ * step behind the simulation.
+ */
+class SPRING_MASS_API AsyncSimulation : public FRunnable
+{
+public:
+	// the thread catches up at most this many seconds, beyond that time is dropped
+	static constexpr double MaxLag = 0.1;
+
+	AsyncSimulation(SpringMassSystem& system);
+	virtual ~AsyncSimulation();
+
+	// start stepping the system, stepRate steps per second, each split into
+	// explicit substeps no longer than maxStep
+	void start(const SpringMassSettings& settings, float stepRate, float maxStep);
+	// wait for the thread to finish, the system belongs to the caller again
+	void stop();
+	bool isRunning() const { return m_thread != nullptr; }
+
+	// applied before the next step, callable from any thread
+	void addForce(uint32 id, const FVector3f& f);
+	void applySettings(const SpringMassSettings& settings);
+	// replace the colliders before the next step, the latest call wins
+	void setColliders(const SpringMassColliders& colliders);
+
+	// positions interpolated to the current time, false until the first snapshot arrived
+	bool interpolate(TArray<FVector3f>& positions);
+
+	//~ Begin FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	//~ End FRunnable Interface
+
+protected:
+	struct Command
+	{
+		enum class Type : uint8
+		{
+			Force,
+			Settings
+		};
+		Type type;
+		uint32 id;
+		FVector3f force;
+		SpringMassSettings settings;
+	};
+
+	struct Snapshot
+	{
+		TArray<FVector3f> previous;
+		TArray<FVector3f> current;
+		// FPlatformTime::Seconds() when published
+		double time = 0.0;
+		float step = 0.0f;
+	};
+
+	// set with the index of a snapshot in m_ready that was not read yet
+	static constexpr uint32 FreshBit = 4;
+
+	SpringMassSystem& m_system;
+	FRunnableThread* m_thread = nullptr;
+	std::atomic<bool> m_stopping{ false };
+
+	TQueue<Command, EQueueMode::Mpsc> m_commands;
+
+	// colliders change every frame, they are copied into a pending set that
+	// the simulation swaps with its own instead of queueing allocations
+	FCriticalSection m_collidersLock;
+	SpringMassColliders m_pendingColliders;
+	bool m_collidersChanged = false;
+
+	Snapshot m_snapshots[3];
+	// owned by the simulation thread
+	int32 m_writing = 0;
+	// newest snapshot not owned by either side, with FreshBit
+	std::atomic<uint32> m_ready{ 1 };
+	// owned by the game thread
+	int32 m_reading = 2;
+
+	// positions after the previous step, simulation thread only
+	TArray<FVector3f> m_previous;
+
+	float m_step = 1 / 200.0f;
+	float m_maxStep = 1 / 200.0f;
+
+	void processCommands();
+	void advance();
+	void publish();
+};
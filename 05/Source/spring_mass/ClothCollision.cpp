@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ClothCollision.h"
+#include "spring_mass.h"
+#include "SpringMassSystem.h"
+
+
+void
+SpringMassColliders::reset()
+{
+	spheres.Reset();
+	capsules.Reset();
+	planes.Reset();
+}
+
+void
+ClothCollision::resolve(SpringMassSystem& system, IntegratorState& state)
+{
+	const TArray<FVector3f>& positions = system.massPoints.positions;
+	const TArray<float>& invMasses = system.massPoints.invMasses;
+
+	if (m_colliders.spheres.Num() > 0 || m_colliders.capsules.Num() > 0)
+	{
+		// a collider overlaps at most 3 cells per axis, more for long capsules
+		float cellSize = m_thickness;
+		for (const SpringMassColliders::Sphere& sphere : m_colliders.spheres)
+		{
+			cellSize = FMath::Max(cellSize, 2.0f * (sphere.radius + m_thickness));
+		}
+		for (const SpringMassColliders::Capsule& capsule : m_colliders.capsules)
+		{
+			cellSize = FMath::Max(cellSize, 2.0f * (capsule.radius + m_thickness));
+		}
+		m_hash.build(positions, cellSize, system.m_parallel);
+	}
+
+	for (const SpringMassColliders::Sphere& sphere : m_colliders.spheres)
+	{
+		const float reach = sphere.radius + m_thickness;
+		const FVector3f extent(reach);
+		m_hash.forEachPointNear(sphere.center - extent, sphere.center + extent, [&](int32 i)
+		{
+			const FVector3f offset = positions[i] - sphere.center;
+			const float distance2 = offset.SizeSquared();
+			if (distance2 >= reach * reach || invMasses[i] == 0.0f)
+			{
+				return;
+			}
+			const float distance = FMath::Sqrt(distance2);
+			const FVector3f normal = distance > SMALL_NUMBER ? offset / distance : FVector3f(0, 0, 1);
+			respond(system, state, i, normal, reach - distance);
+		});
+	}
+
+	for (const SpringMassColliders::Capsule& capsule : m_colliders.capsules)
+	{
+		const float reach = capsule.radius + m_thickness;
+		const FVector3f extent(reach);
+		const FVector3f axis = capsule.b - capsule.a;
+		const float length2 = axis.SizeSquared();
+		m_hash.forEachPointNear(capsule.a.ComponentMin(capsule.b) - extent, capsule.a.ComponentMax(capsule.b) + extent, [&](int32 i)
+		{
+			// closest point on the segment
+			const float t = length2 > 0.0f ? FMath::Clamp(((positions[i] - capsule.a) | axis) / length2, 0.0f, 1.0f) : 0.0f;
+			const FVector3f offset = positions[i] - (capsule.a + axis * t);
+			const float distance2 = offset.SizeSquared();
+			if (distance2 >= reach * reach || invMasses[i] == 0.0f)
+			{
+				return;
+			}
+			const float distance = FMath::Sqrt(distance2);
+			const FVector3f normal = distance > SMALL_NUMBER ? offset / distance : FVector3f(0, 0, 1);
+			respond(system, state, i, normal, reach - distance);
+		});
+	}
+
+	for (const FPlane4f& plane : m_colliders.planes)
+	{
+		const FVector3f normal(plane.X, plane.Y, plane.Z);
+		for (int32 i = 0; i < positions.Num(); i++)
+		{
+			const float depth = m_thickness - plane.PlaneDot(positions[i]);
+			if (depth > 0.0f && invMasses[i] != 0.0f)
+			{
+				respond(system, state, i, normal, depth);
+			}
+		}
+	}
+}
+
+void
+ClothCollision::respond(SpringMassSystem& system, IntegratorState& state, int32 i, const FVector3f& normal, float depth) const
+{
+	MassPoints& points = system.massPoints;
+	system.m_sleep.wakePoint(system, state, i);
+
+	points.positions[i] += normal * depth;
+
+	// drop the velocity into the collider, friction slows the rest
+	FVector3f& velocity = points.velocities[i];
+	const float normalSpeed = velocity | normal;
+	if (normalSpeed < 0.0f)
+	{
+		const FVector3f tangential = velocity - normal * normalSpeed;
+		const float tangentialSpeed = tangential.Size();
+		const float scale = tangentialSpeed > SMALL_NUMBER ? FMath::Max(0.0f, 1.0f + m_friction * normalSpeed / tangentialSpeed) : 0.0f;
+		velocity = tangential * scale;
+	}
+
+	// position Verlet takes its velocity from the previous position
+	if (state.primed && state.prevPositions.Num() == points.num())
+	{
+		state.prevPositions[i] = points.positions[i] - velocity * state.prevDeltaT;
+	}
+}
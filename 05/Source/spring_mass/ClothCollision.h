@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SpatialHash.h"
+
+class SpringMassSystem;
+struct IntegratorState;
+
+/**
+ * Primitive colliders in the local space of a spring-mass system. Capsules
+ * are the segment a-b swept by the radius, planes keep the points on the side
+ * their normal points to.
+ */
+struct SPRING_MASS_API SpringMassColliders
+{
+	struct Sphere
+	{
+		FVector3f center;
+		float radius;
+	};
+	struct Capsule
+	{
+		FVector3f a;
+		FVector3f b;
+		float radius;
+	};
+
+	TArray<Sphere> spheres;
+	TArray<Capsule> capsules;
+	TArray<FPlane4f> planes;
+
+	// remove all colliders, keep the allocations
+	void reset();
+	bool isEmpty() const { return spheres.Num() == 0 && capsules.Num() == 0 && planes.Num() == 0; }
+};
+
+/**
+ * Pushes mass points out of the colliders after each step.
+ *
+ * The points are put into a spatial hash with cells as large as the biggest
+ * sphere or capsule, rebuilt every step. Every sphere and capsule only looks
+ * at the cells its bounds overlap, the cost grows with the points near the
+ * colliders instead of points times colliders. Planes are unbounded and test
+ * every point.
+ *
+ * A colliding point is moved onto the surface, loses the velocity into the
+ * collider and is slowed tangentially by Coulomb friction. Sleeping points a
+ * collider reaches are woken.
+ */
+class SPRING_MASS_API ClothCollision
+{
+public:
+	// distance the points keep from the colliders
+	float m_thickness = 1.0f;
+	// tangential speed lost per normal speed removed
+	float m_friction = 0.3f;
+
+	// set by the owner, swapped in by the async simulation
+	SpringMassColliders m_colliders;
+
+	// push the points out of the colliders, call after a step
+	void resolve(SpringMassSystem& system, IntegratorState& state);
+
+protected:
+	SpatialHash m_hash;
+
+	// move point i along normal by depth and fix its velocity and history
+	void respond(SpringMassSystem& system, IntegratorState& state, int32 i, const FVector3f& normal, float depth) const;
+};
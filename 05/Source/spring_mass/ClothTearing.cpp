@@ -0,0 +1,382 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ClothTearing.h"
+#include "spring_mass.h"
+#include "SpringMassSystem.h"
+#include "SpringMassStats.h"
+#include "Algo/Sort.h"
+#include "Misc/ScopeLock.h"
+
+
+void
+ClothTearing::buildPointTriangles(int32 numPoints)
+{
+	m_pointTriangleOffsets.Init(0, numPoints + 1);
+	for (uint32 v : m_indices)
+	{
+		m_pointTriangleOffsets[v + 1]++;
+	}
+	for (int32 i = 0; i < numPoints; i++)
+	{
+		m_pointTriangleOffsets[i + 1] += m_pointTriangleOffsets[i];
+	}
+	TArray<int32> cursor = m_pointTriangleOffsets;
+	m_pointTriangles.SetNumUninitialized(m_pointTriangleOffsets[numPoints]);
+	for (int32 k = 0; k < m_indices.Num(); k++)
+	{
+		m_pointTriangles[cursor[m_indices[k]]++] = k / 3;
+	}
+}
+
+int32
+ClothTearing::cornerOf(int32 t, uint32 v) const
+{
+	for (int32 k = 0; k < 3; k++)
+	{
+		if (m_indices[3 * t + k] == v)
+		{
+			return k;
+		}
+	}
+	return INDEX_NONE;
+}
+
+int32
+ClothTearing::edgeOf(int32 t, uint32 a, uint32 b) const
+{
+	const int32 k = cornerOf(t, a);
+	if (k == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+	// edge k runs from corner k to k + 1, edge k + 2 ends at corner k
+	if (m_indices[3 * t + (k + 1) % 3] == b)
+	{
+		return k;
+	}
+	return m_indices[3 * t + (k + 2) % 3] == b ? (k + 2) % 3 : INDEX_NONE;
+}
+
+void
+ClothTearing::init(const SpringMassSystem& system, const TArray<uint32>& indices)
+{
+	m_indices = indices;
+	const int32 numTriangles = indices.Num() / 3;
+	m_indices.SetNum(numTriangles * 3);
+	buildPointTriangles(system.massPoints.num());
+
+	// the other triangle at each edge, found among the triangles of its first point
+	m_neighbours.Init(INDEX_NONE, numTriangles * 3);
+	for (int32 t = 0; t < numTriangles; t++)
+	{
+		for (int32 e = 0; e < 3; e++)
+		{
+			const uint32 a = m_indices[3 * t + e];
+			const uint32 b = m_indices[3 * t + (e + 1) % 3];
+			for (int32 j = m_pointTriangleOffsets[a]; j < m_pointTriangleOffsets[a + 1]; j++)
+			{
+				const int32 u = m_pointTriangles[j];
+				if (u != t && edgeOf(u, a, b) != INDEX_NONE)
+				{
+					m_neighbours[3 * t + e] = u;
+					break;
+				}
+			}
+		}
+	}
+	clearChanges();
+}
+
+void
+ClothTearing::reset()
+{
+	m_indices.Empty();
+	m_neighbours.Empty();
+	m_pointTriangleOffsets.Empty();
+	m_pointTriangles.Empty();
+	m_broken.Empty();
+	clearChanges();
+}
+
+bool
+ClothTearing::unlinkEdge(uint32 a, uint32 b, FIntPoint& opposite)
+{
+	for (int32 j = m_pointTriangleOffsets[a]; j < m_pointTriangleOffsets[a + 1]; j++)
+	{
+		const int32 t = m_pointTriangles[j];
+		const int32 e = edgeOf(t, a, b);
+		if (e == INDEX_NONE || m_neighbours[3 * t + e] == INDEX_NONE)
+		{
+			continue;
+		}
+		const int32 u = m_neighbours[3 * t + e];
+		const int32 f = edgeOf(u, a, b);
+		m_neighbours[3 * t + e] = INDEX_NONE;
+		m_neighbours[3 * u + f] = INDEX_NONE;
+		opposite = FIntPoint(m_indices[3 * t + (e + 2) % 3], m_indices[3 * u + (f + 2) % 3]);
+		return true;
+	}
+	return false;
+}
+
+bool
+ClothTearing::update(SpringMassSystem& system, IntegratorState& state)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpringMassTearing);
+	TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassTearing);
+	MassPoints& points = system.massPoints;
+
+	// springs stretched past the limit, the batches collect their own and
+	// hand them over once. Springs between sleeping regions do not stretch
+	const float limit = FMath::Square(1.0f + m_maxStrain);
+	m_broken.Reset();
+	{
+		const TArray<Spring>& springs = system.getSprings();
+		FCriticalSection lock;
+		system.forEachSpringBatch([this, &springs, &points, limit, &lock](int32 first, int32 last)
+		{
+			TArray<int32> found;
+			for (int32 i = first; i < last; i++)
+			{
+				const Spring& s = springs[i];
+				const float length2 = (points.positions[s.m_m1] - points.positions[s.m_m2]).SizeSquared();
+				if (length2 > limit * FMath::Square(s.m_spring_length_init))
+				{
+					found.Add(i);
+				}
+			}
+			if (found.Num() > 0)
+			{
+				FScopeLock scope(&lock);
+				m_broken.Append(found);
+			}
+		});
+	}
+	if (m_broken.Num() == 0)
+	{
+		return false;
+	}
+	// the pass over the springs below walks them in order
+	Algo::Sort(m_broken);
+	const TArray<int32>& broken = m_broken;
+
+	// the springs change from here on, the system stops sharing them
+	system.editTopology();
+	const TArray<Spring>& springs = system.getSprings();
+
+	// tear the triangles apart along broken edges, the spring across the
+	// edge goes with them
+	auto pairKey = [](uint32 a, uint32 b)
+	{
+		return (uint64(FMath::Min(a, b)) << 32) | FMath::Max(a, b);
+	};
+	TSet<uint64> cuts;
+	TArray<uint32> torn;
+	TArray<uint32> ends;
+	for (int32 i : broken)
+	{
+		const Spring& s = springs[i];
+		ends.Add(s.m_m1);
+		ends.Add(s.m_m2);
+		FIntPoint opposite;
+		if (unlinkEdge(s.m_m1, s.m_m2, opposite))
+		{
+			cuts.Add(pairKey(opposite.X, opposite.Y));
+			torn.Add(s.m_m1);
+			torn.Add(s.m_m2);
+		}
+	}
+
+	// split the points whose triangle fan fell apart, every extra piece of
+	// the fan gets a copy of the point
+	const int32 numOld = points.num();
+	TArray<uint32> remapped = m_indices;
+	TArray<uint8> split;
+	split.SetNumZeroed(numOld);
+	TArray<int32> labels;
+	TArray<int32> counts;
+	TArray<int32> stack;
+	for (uint32 v : torn)
+	{
+		if (split[v])
+		{
+			continue;
+		}
+		const int32 first = m_pointTriangleOffsets[v];
+		const int32 fan = m_pointTriangleOffsets[v + 1] - first;
+		labels.Init(INDEX_NONE, fan);
+		counts.Reset();
+		for (int32 j = 0; j < fan; j++)
+		{
+			if (labels[j] != INDEX_NONE)
+			{
+				continue;
+			}
+			// flood the piece through the linked edges at v
+			const int32 piece = counts.Add(0);
+			labels[j] = piece;
+			stack.Add(j);
+			while (stack.Num() > 0)
+			{
+				const int32 t = m_pointTriangles[first + stack.Pop()];
+				counts[piece]++;
+				const int32 k = cornerOf(t, v);
+				for (int32 e : { k, (k + 2) % 3 })
+				{
+					const int32 u = m_neighbours[3 * t + e];
+					for (int32 l = 0; u != INDEX_NONE && l < fan; l++)
+					{
+						if (m_pointTriangles[first + l] == u && labels[l] == INDEX_NONE)
+						{
+							labels[l] = piece;
+							stack.Add(l);
+						}
+					}
+				}
+			}
+		}
+		if (counts.Num() < 2)
+		{
+			continue;
+		}
+
+		// the mass is shared by the triangles of each piece
+		split[v] = 1;
+		const FVector3f position = points.positions[v];
+		const FVector3f velocity = points.velocities[v];
+		const float invMass = points.invMasses[v];
+		const bool movable = !points.pinned[v];
+		const float mass = invMass > 0.0f ? 1.0f / invMass : 0.0f;
+		TArray<uint32> pieceIds;
+		pieceIds.Add(v);
+		for (int32 piece = 1; piece < counts.Num(); piece++)
+		{
+			const uint32 id = points.add(position, mass * counts[piece] / fan, movable);
+			points.velocities[id] = velocity;
+			pieceIds.Add(id);
+			m_newPointSources.Add(v);
+		}
+		if (movable)
+		{
+			points.invMasses[v] = invMass * fan / counts[0];
+		}
+		for (int32 j = 0; j < fan; j++)
+		{
+			if (labels[j] > 0)
+			{
+				const int32 t = m_pointTriangles[first + j];
+				remapped[3 * t + cornerOf(t, v)] = pieceIds[labels[j]];
+				m_changedTriangles.Add(t);
+			}
+		}
+	}
+
+	// the piece a spring at a split point belongs to: the pieces of the
+	// triangles it runs along, or across to the opposite corner
+	constexpr int32 Ambiguous = -2;
+	auto follow = [this, &remapped, &split](uint32 v, uint32 w)
+	{
+		if (!split[v])
+		{
+			return int32(v);
+		}
+		int32 result = INDEX_NONE;
+		for (int32 j = m_pointTriangleOffsets[v]; j < m_pointTriangleOffsets[v + 1]; j++)
+		{
+			const int32 t = m_pointTriangles[j];
+			const int32 k = cornerOf(t, v);
+			const int32 across = m_neighbours[3 * t + (k + 1) % 3];
+			if (cornerOf(t, w) == INDEX_NONE && (across == INDEX_NONE || cornerOf(across, w) == INDEX_NONE))
+			{
+				continue;
+			}
+			const int32 id = int32(remapped[3 * t + k]);
+			if (result != INDEX_NONE && result != id)
+			{
+				return Ambiguous;
+			}
+			result = id;
+		}
+		// springs beyond the neighbouring triangles stay with the first piece
+		return result == INDEX_NONE ? int32(v) : result;
+	};
+
+	// one pass over the springs, moved springs are removed and added again
+	// to their color group since they change region
+	const TArray<int32>& colorOffsets = system.getColorOffsets();
+	TArray<int32> removals;
+	TArray<Spring> additions;
+	TArray<int32> additionGroups;
+	int32 group = 0;
+	int32 next = 0;
+	for (int32 i = 0; i < springs.Num(); i++)
+	{
+		while (group + 1 < colorOffsets.Num() && colorOffsets[group + 1] <= i)
+		{
+			group++;
+		}
+		const Spring& s = springs[i];
+		if ((next < broken.Num() && broken[next] == i) || cuts.Contains(pairKey(s.m_m1, s.m_m2)))
+		{
+			next += next < broken.Num() && broken[next] == i ? 1 : 0;
+			removals.Add(i);
+			continue;
+		}
+		const int32 a = follow(s.m_m1, s.m_m2);
+		const int32 b = follow(s.m_m2, s.m_m1);
+		if (a == Ambiguous || b == Ambiguous)
+		{
+			removals.Add(i);
+		}
+		else if (uint32(a) != s.m_m1 || uint32(b) != s.m_m2)
+		{
+			removals.Add(i);
+			additions.Add(Spring(a, b, s.m_spring_length_init));
+			additionGroups.Add(group);
+		}
+	}
+
+	// removals from the back, so the indices still to remove stay valid
+	SleepRegions& sleep = system.m_sleep;
+	for (int32 j = removals.Num() - 1; j >= 0; j--)
+	{
+		sleep.removeSpring(system, removals[j]);
+	}
+	for (int32 j = 0; j < additions.Num(); j++)
+	{
+		sleep.addSpring(system, additions[j], additionGroups[j]);
+	}
+
+	m_indices = MoveTemp(remapped);
+	if (points.num() > numOld)
+	{
+		buildPointTriangles(points.num());
+		sleep.updatePoints(system, state);
+	}
+	else
+	{
+		for (uint32 v : ends)
+		{
+			sleep.wakePoint(system, state, v);
+		}
+	}
+
+	Algo::Sort(m_changedTriangles);
+	int32 unique = 0;
+	for (int32 t : m_changedTriangles)
+	{
+		if (unique == 0 || m_changedTriangles[unique - 1] != t)
+		{
+			m_changedTriangles[unique++] = t;
+		}
+	}
+	m_changedTriangles.SetNum(unique);
+	return true;
+}
+
+void
+ClothTearing::clearChanges()
+{
+	m_newPointSources.Reset();
+	m_changedTriangles.Reset();
+}
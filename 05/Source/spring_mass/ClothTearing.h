@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class SpringMassSystem;
+struct IntegratorState;
+
+/**
+ * Tears a spring-mass cloth apart where it is stretched too far.
+ *
+ * After each step, springs longer than (1 + m_maxStrain) times their rest
+ * length break. A broken spring along a triangle edge unlinks the two
+ * triangles on either side, and the spring between their opposite corners is
+ * cut with it. A mass point whose triangle fan falls into several pieces is
+ * split: the first piece keeps it, every other piece gets a copy appended to
+ * the mass points with the same position and velocity and its share of the
+ * mass. Springs at a split point follow the triangles they run along or
+ * across, springs supported by more than one piece are removed.
+ *
+ * Springs are edited in place through SleepRegions, so they stay dense and
+ * sorted by color and region pair, and the mass points stay one compact array
+ * with the copies at its end. The new points and the triangles that changed
+ * are logged for the render mesh until clearChanges.
+ */
+class SPRING_MASS_API ClothTearing
+{
+public:
+	bool m_enabled = false;
+	// strain at which a spring breaks
+	float m_maxStrain = 1.0f;
+
+	// store the triangles and link the ones sharing an edge, call after the
+	// springs are colored
+	void init(const SpringMassSystem& system, const TArray<uint32>& indices);
+	void reset();
+	bool isInitialized() const { return m_neighbours.Num() > 0; }
+
+	// break overstretched springs and split the cloth along them, call after
+	// a step, true if springs or mass points changed
+	bool update(SpringMassSystem& system, IntegratorState& state);
+
+	// triangles with the corners moved to the split points
+	const TArray<uint32>& getIndices() const { return m_indices; }
+
+	// mass point i copied getNewPointSources()[i - (num points - count)]
+	const TArray<uint32>& getNewPointSources() const { return m_newPointSources; }
+	// triangles with a corner moved since the last clearChanges
+	const TArray<int32>& getChangedTriangles() const { return m_changedTriangles; }
+	bool hasChanges() const { return m_changedTriangles.Num() > 0 || m_newPointSources.Num() > 0; }
+	void clearChanges();
+
+protected:
+	TArray<uint32> m_indices;
+	// triangle across edge e of triangle t, which runs from corner e to e + 1,
+	// is m_neighbours[3 t + e], INDEX_NONE at a border or a tear
+	TArray<int32> m_neighbours;
+	// triangles at point i are m_pointTriangles[m_pointTriangleOffsets[i] .. m_pointTriangleOffsets[i + 1])
+	TArray<int32> m_pointTriangleOffsets;
+	TArray<int32> m_pointTriangles;
+
+	TArray<uint32> m_newPointSources;
+	TArray<int32> m_changedTriangles;
+	// springs broken in the current update, reused across updates
+	TArray<int32> m_broken;
+
+	void buildPointTriangles(int32 numPoints);
+	// corner of triangle t at point v, INDEX_NONE if t does not touch v
+	int32 cornerOf(int32 t, uint32 v) const;
+	// edge of triangle t between points a and b, INDEX_NONE if it has none
+	int32 edgeOf(int32 t, uint32 a, uint32 b) const;
+	// unlink the triangles along edge (a, b), false if they were not linked
+	bool unlinkEdge(uint32 a, uint32 b, FIntPoint& opposite);
+};
@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GridStencil.h"
+#include "spring_mass.h"
+#include "SimdKernels.h"
+#include "SleepRegions.h"
+#include "Async/ParallelFor.h"
+
+// column instantiates direction<D> once for each of them
+static_assert(GridStencil::NumDirections == 4, "the stencil is north, east, north east and south east");
+
+
+// dst[i] += sign * src[i] for the three components
+static FORCEINLINE void
+accumulate(float* RESTRICT dst, const float* RESTRICT src, int32 rows, int32 count, float sign)
+{
+	for (int32 c = 0; c < 3; c++)
+	{
+		for (int32 i = 0; i < count; i++)
+		{
+			dst[c * rows + i] += sign * src[c * rows + i];
+		}
+	}
+}
+
+// scratch of the calling thread, a task runs on one thread from start to end
+static float*
+threadScratch(int32 num)
+{
+	static thread_local TArray<float> scratch;
+	if (scratch.Num() < num)
+	{
+		scratch.SetNumUninitialized(num);
+	}
+	return scratch.GetData();
+}
+
+void
+GridStencil::init(int32 rows, int32 cols, float spacing)
+{
+	m_rows = rows;
+	m_cols = cols;
+	m_spacing = spacing;
+	m_columnsPerTask = FMath::Max(1, SpringsPerTask / (NumDirections * rows));
+}
+
+void
+GridStencil::reset()
+{
+	m_rows = 0;
+	m_cols = 0;
+}
+
+int32
+GridStencil::numSprings() const
+{
+	// north in every column, east, north east and south east between neighbouring ones
+	return (m_rows - 1) * m_cols + (m_rows + 2 * (m_rows - 1)) * (m_cols - 1);
+}
+
+bool
+GridStencil::isAsleep(const SleepRegions& sleep, int32 x) const
+{
+	const int32 first = x * m_rows / SleepRegions::RegionSize;
+	const int32 last = (FMath::Min(x + 2, m_cols) * m_rows - 1) / SleepRegions::RegionSize;
+	for (int32 r = first; r <= last; r++)
+	{
+		if (!sleep.isAsleep(r))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+template<int32 D>
+void
+GridStencil::direction(const float* columnA, const float* columnB, float stiffness, float damper, const SimdKernels& kernels, float* forcesA, float* forcesB, float* springForces) const
+{
+	constexpr Direction d = Directions[D];
+	// the springs start at row first of column A and end d.rows further in column B
+	constexpr int32 first = d.rows < 0 ? -d.rows : 0;
+	const int32 count = m_rows - (d.rows < 0 ? -d.rows : d.rows);
+	const float* end = d.columns == 0 ? columnA : columnB;
+	float* endForces = d.columns == 0 ? forcesA : forcesB;
+
+	kernels.stencilSprings(columnA + first, end + first + d.rows, m_rows, count, d.length * m_spacing, stiffness, damper, springForces);
+	// two loops, the ends of a north spring are neighbours in the same column
+	accumulate(forcesA + first, springForces, m_rows, count, 1.0f);
+	accumulate(endForces + first + d.rows, springForces, m_rows, count, -1.0f);
+}
+
+void
+GridStencil::column(MassPoints& points, int32 x, float stiffness, float damper, const SimdKernels& kernels, float* scratch) const
+{
+	const int32 rows = m_rows;
+	float* columnA = scratch;
+	float* columnB = columnA + 6 * rows;
+	float* forcesA = columnB + 6 * rows;
+	float* forcesB = forcesA + 3 * rows;
+	float* springForces = forcesB + 3 * rows;
+	const bool bNext = x + 1 < m_cols;
+
+	// structure of arrays copies of the two columns
+	auto load = [&points, rows](int32 column, float* soa)
+	{
+		const FVector3f* positions = &points.positions[column * rows];
+		const FVector3f* velocities = &points.velocities[column * rows];
+		for (int32 z = 0; z < rows; z++)
+		{
+			soa[z] = positions[z].X;
+			soa[rows + z] = positions[z].Y;
+			soa[2 * rows + z] = positions[z].Z;
+			soa[3 * rows + z] = velocities[z].X;
+			soa[4 * rows + z] = velocities[z].Y;
+			soa[5 * rows + z] = velocities[z].Z;
+		}
+	};
+	load(x, columnA);
+	FMemory::Memzero(forcesA, 3 * rows * sizeof(float));
+	direction<0>(columnA, columnB, stiffness, damper, kernels, forcesA, forcesB, springForces);
+	if (bNext)
+	{
+		load(x + 1, columnB);
+		FMemory::Memzero(forcesB, 3 * rows * sizeof(float));
+		direction<1>(columnA, columnB, stiffness, damper, kernels, forcesA, forcesB, springForces);
+		direction<2>(columnA, columnB, stiffness, damper, kernels, forcesA, forcesB, springForces);
+		direction<3>(columnA, columnB, stiffness, damper, kernels, forcesA, forcesB, springForces);
+	}
+
+	auto store = [&points, rows](int32 column, const float* soa)
+	{
+		FVector3f* forces = &points.forces[column * rows];
+		for (int32 z = 0; z < rows; z++)
+		{
+			forces[z] += FVector3f(soa[z], soa[rows + z], soa[2 * rows + z]);
+		}
+	};
+	store(x, forcesA);
+	if (bNext)
+	{
+		store(x + 1, forcesB);
+	}
+}
+
+void
+GridStencil::springForces(MassPoints& points, float stiffness, float damper, bool bParallel, const SimdKernels& kernels, const SleepRegions& sleep) const
+{
+	check(points.num() == m_rows * m_cols);
+	const int32 perPass = FMath::DivideAndRoundUp(m_cols, 2);
+	const int32 tasks = FMath::DivideAndRoundUp(perPass, m_columnsPerTask);
+
+	// column x writes columns x and x + 1, so columns of one parity never share a point
+	for (int32 parity = 0; parity < 2; parity++)
+	{
+		auto task = [this, &points, stiffness, damper, &kernels, &sleep, parity](int32 t)
+		{
+			float* scratch = threadScratch(ScratchPerRow * m_rows);
+			const bool bSleeping = sleep.numAsleep() > 0;
+			const int32 last = FMath::Min((t + 1) * m_columnsPerTask, FMath::DivideAndRoundUp(m_cols - parity, 2));
+			for (int32 i = t * m_columnsPerTask; i < last; i++)
+			{
+				// springs with a sleeping end still pull on the awake one
+				const int32 x = parity + 2 * i;
+				if (!bSleeping || !isAsleep(sleep, x))
+				{
+					column(points, x, stiffness, damper, kernels, scratch);
+				}
+			}
+		};
+		if (bParallel)
+		{
+			ParallelFor(tasks, task);
+		}
+		else
+		{
+			for (int32 t = 0; t < tasks; t++)
+			{
+				task(t);
+			}
+		}
+	}
+}
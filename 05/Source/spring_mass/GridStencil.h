@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "MassPoints.h"
+
+struct SimdKernels;
+class SleepRegions;
+
+/**
+ * Spring forces of a regular lattice, computed from the stencil instead of a
+ * spring list.
+ *
+ * Mass point x * rows + z sits in column x and row z, like the lattice of
+ * ASpringMassActor. Every point has a spring to its neighbours in the four
+ * Directions, at the rest length of a lattice with m_spacing between rows and
+ * columns. A column and the next one are copied into structure of arrays
+ * scratch, and each direction is a run of SimdKernels::stencilSprings along
+ * the column with a fixed offset, contiguous loads instead of gathers. A
+ * column writes its own forces and those of the next column, so the even and
+ * the odd columns run in two parallel passes. Columns whose points all sleep
+ * are skipped.
+ */
+class SPRING_MASS_API GridStencil
+{
+public:
+	// neighbour a spring runs to, in columns and rows, and its rest length in spacings
+	struct Direction
+	{
+		int32 columns;
+		int32 rows;
+		float length;
+	};
+	// north, east, north east and south east
+	static constexpr Direction Directions[] = {
+		{ 0, 1, 1.0f },
+		{ 1, 0, 1.0f },
+		{ 1, 1, 1.41421356f },
+		{ 1, -1, 1.41421356f },
+	};
+	static constexpr int32 NumDirections = UE_ARRAY_COUNT(Directions);
+
+	// springs evaluated by one parallel task
+	static constexpr int32 SpringsPerTask = 2048;
+
+	// lattice of cols columns with rows points each, spacing apart
+	void init(int32 rows, int32 cols, float spacing);
+	void reset();
+	bool isInitialized() const { return m_rows > 0; }
+
+	int32 numRows() const { return m_rows; }
+	int32 numCols() const { return m_cols; }
+	float getSpacing() const { return m_spacing; }
+	// springs of the lattice, as many as SpringMassTopology::getLattice lists
+	int32 numSprings() const;
+
+	// accumulate the spring and damper forces of every spring like Spring::Tick,
+	// except those of columns in sleeping regions
+	void springForces(MassPoints& points, float stiffness, float damper, bool bParallel, const SimdKernels& kernels, const SleepRegions& sleep) const;
+
+protected:
+	int32 m_rows = 0;
+	int32 m_cols = 0;
+	float m_spacing = 0.0f;
+	int32 m_columnsPerTask = 1;
+
+	// positions and velocities of two columns, their forces and the forces of
+	// one direction, kept per worker thread
+	static constexpr int32 ScratchPerRow = 6 + 6 + 3 + 3 + 3;
+
+	// every region the springs of column x write to sleeps
+	bool isAsleep(const SleepRegions& sleep, int32 x) const;
+
+	// the springs of column x, north inside it and the others to column x + 1
+	void column(MassPoints& points, int32 x, float stiffness, float damper, const SimdKernels& kernels, float* scratch) const;
+	template<int32 D>
+	void direction(const float* columnA, const float* columnB, float stiffness, float damper, const SimdKernels& kernels, float* forcesA, float* forcesB, float* springForces) const;
+};
@@ -0,0 +1,269 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ImplicitSolver.h"
+#include "spring_mass.h"
+#include "SpringMassSystem.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	// sum fn(first, last) over batches of mass points in a fixed order,
+	// so the parallel and the serial path give the same result
+	double sumPointBatches(const SpringMassSystem& system, TArray<double>& partials, TFunctionRef<double(int32, int32)> fn)
+	{
+		const int32 n = system.massPoints.num();
+		const int32 numBatches = FMath::DivideAndRoundUp(n, SpringMassSystem::PointBatchSize);
+		partials.SetNumUninitialized(numBatches);
+		ParallelFor(numBatches, [&](int32 batch)
+		{
+			const int32 first = batch * SpringMassSystem::PointBatchSize;
+			partials[batch] = fn(first, FMath::Min(n, first + SpringMassSystem::PointBatchSize));
+		}, !system.m_parallel);
+
+		double sum = 0.0;
+		for (double p : partials)
+		{
+			sum += p;
+		}
+		return sum;
+	}
+}
+
+void
+ImplicitSolver::init(const SpringMassSystem& system)
+{
+	const int32 numSprings = system.getSprings().Num();
+	m_springDirs.SetNumUninitialized(numSprings);
+	m_springA.SetNumUninitialized(numSprings);
+	m_springB.SetNumUninitialized(numSprings);
+
+	const int32 numPoints = system.massPoints.num();
+	m_rhs.SetNumUninitialized(numPoints);
+	m_dv.SetNumUninitialized(numPoints);
+	m_residual.SetNumUninitialized(numPoints);
+	m_search.SetNumUninitialized(numPoints);
+	m_product.SetNumUninitialized(numPoints);
+	m_invDiag.SetNumUninitialized(numPoints);
+
+	m_initialized = true;
+}
+
+void
+ImplicitSolver::reset()
+{
+	m_springDirs.Empty();
+	m_springA.Empty();
+	m_springB.Empty();
+	m_rhs.Empty();
+	m_dv.Empty();
+	m_residual.Empty();
+	m_search.Empty();
+	m_product.Empty();
+	m_invDiag.Empty();
+	m_partials.Empty();
+	m_initialized = false;
+}
+
+void
+ImplicitSolver::step(SpringMassSystem& system, float deltaT)
+{
+	assemble(system, deltaT);
+	solve(system);
+
+	// apply the velocity change and move the points with the new velocity
+	MassPoints& points = system.massPoints;
+	system.forEachPointBatch([this, &points, deltaT](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			if (!points.pinned[i])
+			{
+				points.velocities[i] += m_dv[i];
+				points.positions[i] += points.velocities[i] * deltaT;
+			}
+			points.forces[i] = FVector3f::ZeroVector;
+		}
+	});
+}
+
+void
+ImplicitSolver::assemble(SpringMassSystem& system, float deltaT)
+{
+	MassPoints& points = system.massPoints;
+	const float h = deltaT;
+	const float k = system.m_stiffness;
+	const float kd = system.m_damper;
+
+	// the spring pass accumulates into the right hand side and the diagonal
+	system.forEachPointBatch([this](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			m_rhs[i] = FVector3f::ZeroVector;
+			m_invDiag[i] = FVector3f::ZeroVector;
+		}
+	});
+
+	const TArray<Spring>& springs = system.getSprings();
+	system.forEachSpringBatch([this, &springs, &points, h, k, kd](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			const Spring& s = springs[i];
+			const FVector3f m1m2 = points.positions[s.m_m2] - points.positions[s.m_m1];
+			const float length = m1m2.Size();
+			if (length <= SMALL_NUMBER)
+			{
+				m_springDirs[i] = FVector3f::ZeroVector;
+				m_springA[i] = 0.0f;
+				m_springB[i] = 0.0f;
+				continue;
+			}
+			const FVector3f n = m1m2 / length;
+			const FVector3f vel = points.velocities[s.m_m1] - points.velocities[s.m_m2];
+
+			// same forces as Spring::Tick
+			const FVector3f force = k * (length - s.m_spring_length_init) * n - kd * FVector3f::DotProduct(vel, n) * n;
+			points.forces[s.m_m1] += force;
+			points.forces[s.m_m2] -= force;
+
+			// dF/dx = -k (n n^T + c (I - n n^T)), the transversal part is dropped
+			// under compression to keep the system positive definite
+			const float c = FMath::Max(0.0f, 1.0f - s.m_spring_length_init / length);
+			const float b = h * h * k * c;
+			const float a = h * kd + h * h * k * (1.0f - c);
+			m_springDirs[i] = n;
+			m_springA[i] = a;
+			m_springB[i] = b;
+
+			// h^2 dF/dx v
+			const FVector3f dxv = -(h * h * k) * ((1.0f - c) * FVector3f::DotProduct(n, vel) * n + c * vel);
+			m_rhs[s.m_m1] += dxv;
+			m_rhs[s.m_m2] -= dxv;
+
+			const FVector3f diag = a * n * n + FVector3f(b);
+			m_invDiag[s.m_m1] += diag;
+			m_invDiag[s.m_m2] += diag;
+		}
+	});
+
+	// add gravity and finish right hand side and preconditioner, fixed points keep dv = 0
+	system.forEachPointBatch([this, &system, &points, h](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			if (points.pinned[i])
+			{
+				m_rhs[i] = FVector3f::ZeroVector;
+				m_invDiag[i] = FVector3f::ZeroVector;
+				continue;
+			}
+			const float mass = 1.0f / points.invMasses[i];
+			points.forces[i] += system.m_gravity * mass;
+			m_rhs[i] += points.forces[i] * h;
+			const FVector3f diag = m_invDiag[i] + FVector3f(mass);
+			m_invDiag[i] = FVector3f(1.0f / diag.X, 1.0f / diag.Y, 1.0f / diag.Z);
+		}
+	});
+}
+
+void
+ImplicitSolver::multiply(const SpringMassSystem& system)
+{
+	const MassPoints& points = system.massPoints;
+
+	system.forEachPointBatch([this, &points](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			m_product[i] = points.pinned[i] ? FVector3f::ZeroVector : m_search[i] / points.invMasses[i];
+		}
+	});
+
+	const TArray<Spring>& springs = system.getSprings();
+	system.forEachSpringBatch([this, &springs](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			const Spring& s = springs[i];
+			const FVector3f d = m_search[s.m_m1] - m_search[s.m_m2];
+			const FVector3f& n = m_springDirs[i];
+			const FVector3f product = m_springA[i] * FVector3f::DotProduct(n, d) * n + m_springB[i] * d;
+			m_product[s.m_m1] += product;
+			m_product[s.m_m2] -= product;
+		}
+	});
+}
+
+void
+ImplicitSolver::solve(const SpringMassSystem& system)
+{
+	const TArray<uint8>& pinned = system.massPoints.pinned;
+
+	// start from dv = 0, so the residual is the right hand side
+	const double rhsNorm = sumPointBatches(system, m_partials, [this](int32 first, int32 last)
+	{
+		double sum = 0.0;
+		for (int32 i = first; i < last; i++)
+		{
+			m_dv[i] = FVector3f::ZeroVector;
+			m_residual[i] = m_rhs[i];
+			m_search[i] = m_invDiag[i] * m_residual[i];
+			sum += FVector3f::DotProduct(m_residual[i], m_search[i]);
+		}
+		return sum;
+	});
+
+	double rz = rhsNorm;
+	const double threshold = rhsNorm * m_tolerance * m_tolerance;
+	m_lastIterations = 0;
+	while (m_lastIterations < m_maxIterations && rz > threshold)
+	{
+		m_lastIterations++;
+		multiply(system);
+
+		const double pAp = sumPointBatches(system, m_partials, [this, &pinned](int32 first, int32 last)
+		{
+			double sum = 0.0;
+			for (int32 i = first; i < last; i++)
+			{
+				if (!pinned[i])
+				{
+					sum += FVector3f::DotProduct(m_search[i], m_product[i]);
+				}
+			}
+			return sum;
+		});
+		if (pAp <= 0.0)
+		{
+			break;
+		}
+
+		// step along the search direction and measure the preconditioned residual
+		const float alpha = float(rz / pAp);
+		const double rzNew = sumPointBatches(system, m_partials, [this, &pinned, alpha](int32 first, int32 last)
+		{
+			double sum = 0.0;
+			for (int32 i = first; i < last; i++)
+			{
+				if (!pinned[i])
+				{
+					m_dv[i] += alpha * m_search[i];
+					m_residual[i] -= alpha * m_product[i];
+					sum += FVector3f::DotProduct(m_residual[i], m_invDiag[i] * m_residual[i]);
+				}
+			}
+			return sum;
+		});
+
+		const float beta = float(rzNew / rz);
+		rz = rzNew;
+		system.forEachPointBatch([this, beta](int32 first, int32 last)
+		{
+			for (int32 i = first; i < last; i++)
+			{
+				m_search[i] = m_invDiag[i] * m_residual[i] + beta * m_search[i];
+			}
+		});
+	}
+}
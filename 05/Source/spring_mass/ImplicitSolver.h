@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class SpringMassSystem;
+
+/**
+ * Backward Euler integration of a spring-mass system.
+ *
+ * Every step solves (M - h dF/dv - h^2 dF/dx) dv = h (F + h dF/dx v) with a
+ * Jacobi preconditioned conjugate gradient. The Jacobian block of a spring is
+ * a * n n^T + b * I, so it is stored as (n, a, b) in the order of the spring
+ * list and applied matrix-free, color group by color group.
+ */
+class SPRING_MASS_API ImplicitSolver
+{
+public:
+	// conjugate gradient stops after this many iterations
+	int32 m_maxIterations = 40;
+	// or when the residual dropped below this fraction of the right hand side
+	float m_tolerance = 1e-3f;
+
+	// allocate the per spring and per mass point buffers for a topology
+	void init(const SpringMassSystem& system);
+	bool isInitialized() const { return m_initialized; }
+	// drop the buffers, the next step rebuilds them
+	void reset();
+
+	// advance the system by one timestep of any size
+	void step(SpringMassSystem& system, float deltaT);
+
+	// conjugate gradient iterations used by the last step
+	int32 getLastIterations() const { return m_lastIterations; }
+
+protected:
+	bool m_initialized = false;
+	int32 m_lastIterations = 0;
+
+	// Jacobian of each spring: direction and coefficients of a * n n^T + b * I
+	TArray<FVector3f> m_springDirs;
+	TArray<float> m_springA;
+	TArray<float> m_springB;
+
+	// conjugate gradient vectors, one entry per mass point
+	TArray<FVector3f> m_rhs;
+	TArray<FVector3f> m_dv;
+	TArray<FVector3f> m_residual;
+	TArray<FVector3f> m_search;
+	TArray<FVector3f> m_product;
+	TArray<FVector3f> m_invDiag;
+	// per batch partial sums of the dot products
+	TArray<double> m_partials;
+
+	// evaluate springs: forces, Jacobians, preconditioner and right hand side
+	void assemble(SpringMassSystem& system, float deltaT);
+	// m_product = A * m_search
+	void multiply(const SpringMassSystem& system);
+	// solve A * m_dv = m_rhs
+	void solve(const SpringMassSystem& system);
+};
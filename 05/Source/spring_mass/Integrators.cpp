@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Integrators.h"
+#include "spring_mass.h"
+#include "SpringMassSystem.h"
+#include "SpringMassStats.h"
+
+
+void
+IntegratorState::reset()
+{
+	prevPositions.Empty();
+	prevDeltaT = 0.0f;
+	accelerations.Empty();
+	startPositions.Empty();
+	startVelocities.Empty();
+	externalForces.Empty();
+	sumPositions.Empty();
+	sumVelocities.Empty();
+	primed = false;
+}
+
+void
+SymplecticEulerIntegrator::step(SpringMassSystem& system, IntegratorState& /*state*/, float deltaT)
+{
+	MassPoints& points = system.massPoints;
+	const FVector3f gravity = system.m_gravity;
+
+	const SimdKernels& kernels = SimdKernels::get(system.m_simdLevel);
+
+	system.updateSprings();
+
+	SCOPE_CYCLE_COUNTER(STAT_SpringMassIntegrate);
+	TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassIntegrate);
+	system.forEachPointBatch([&points, &kernels, gravity, deltaT](int32 first, int32 last)
+	{
+		kernels.integrate(points, first, last, gravity, deltaT);
+	});
+}
+
+void
+PositionVerletIntegrator::step(SpringMassSystem& system, IntegratorState& state, float deltaT)
+{
+	MassPoints& points = system.massPoints;
+	const FVector3f gravity = system.m_gravity;
+	const int32 n = points.num();
+
+	// start the history from the current velocities
+	if (!state.primed)
+	{
+		state.prevPositions.SetNumUninitialized(n);
+		for (int32 i = 0; i < n; i++)
+		{
+			state.prevPositions[i] = points.positions[i] - points.velocities[i] * deltaT;
+		}
+		state.prevDeltaT = deltaT;
+		state.primed = true;
+	}
+
+	// time corrected Verlet, so the step size may change between steps
+	const float ratio = deltaT / state.prevDeltaT;
+	const float invSpan = 1.0f / (deltaT + state.prevDeltaT);
+	const float deltaT2 = deltaT * deltaT;
+	TArray<FVector3f>& prev = state.prevPositions;
+
+	system.updateSprings();
+
+	SCOPE_CYCLE_COUNTER(STAT_SpringMassIntegrate);
+	TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassIntegrate);
+	system.forEachPointBatch([&points, &prev, gravity, ratio, invSpan, deltaT2](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			const FVector3f x = points.positions[i];
+			const FVector3f next = x + (x - prev[i]) * ratio + pointAcceleration(points, i, gravity) * deltaT2;
+			// central difference, used by the spring dampers of the next step
+			points.velocities[i] = (next - prev[i]) * invSpan;
+			prev[i] = x;
+			points.positions[i] = next;
+			points.forces[i] = FVector3f::ZeroVector;
+		}
+	});
+	state.prevDeltaT = deltaT;
+}
+
+void
+VelocityVerletIntegrator::step(SpringMassSystem& system, IntegratorState& state, float deltaT)
+{
+	MassPoints& points = system.massPoints;
+	const FVector3f gravity = system.m_gravity;
+	const int32 n = points.num();
+	TArray<FVector3f>& acc = state.accelerations;
+
+	// the first step needs the accelerations at the start
+	if (!state.primed)
+	{
+		acc.SetNumUninitialized(n);
+		system.updateSprings();
+		for (int32 i = 0; i < n; i++)
+		{
+			acc[i] = pointAcceleration(points, i, gravity);
+			points.forces[i] = FVector3f::ZeroVector;
+		}
+		state.primed = true;
+	}
+
+	// half kick and drift, the springs are evaluated at the half step velocity
+	const float halfDeltaT = 0.5f * deltaT;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpringMassIntegrate);
+		TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassIntegrate);
+		system.forEachPointBatch([&points, &acc, halfDeltaT, deltaT](int32 first, int32 last)
+		{
+			for (int32 i = first; i < last; i++)
+			{
+				points.velocities[i] += acc[i] * halfDeltaT;
+				points.positions[i] += points.velocities[i] * deltaT;
+			}
+		});
+	}
+
+	// second half kick with the new accelerations
+	system.updateSprings();
+
+	SCOPE_CYCLE_COUNTER(STAT_SpringMassIntegrate);
+	TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassIntegrate);
+	system.forEachPointBatch([&points, &acc, gravity, halfDeltaT](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			acc[i] = pointAcceleration(points, i, gravity);
+			points.velocities[i] += acc[i] * halfDeltaT;
+			points.forces[i] = FVector3f::ZeroVector;
+		}
+	});
+}
+
+namespace
+{
+	// accumulate the derivative (v, a) of the current RK4 stage and move to the
+	// next stage state, or to the final state after the fourth stage
+	template<bool bFinal>
+	void rk4Stage(SpringMassSystem& system, IntegratorState& state, float weight, float offset, float sumScale)
+	{
+		MassPoints& points = system.massPoints;
+		const FVector3f gravity = system.m_gravity;
+
+		system.updateSprings();
+
+		SCOPE_CYCLE_COUNTER(STAT_SpringMassIntegrate);
+		TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassIntegrate);
+		system.forEachPointBatch([&points, &state, gravity, weight, offset, sumScale](int32 first, int32 last)
+		{
+			for (int32 i = first; i < last; i++)
+			{
+				const FVector3f v = points.velocities[i];
+				const FVector3f a = pointAcceleration(points, i, gravity);
+				state.sumPositions[i] += v * weight;
+				state.sumVelocities[i] += a * weight;
+				if constexpr (bFinal)
+				{
+					points.positions[i] = state.startPositions[i] + state.sumPositions[i] * sumScale;
+					points.velocities[i] = state.startVelocities[i] + state.sumVelocities[i] * sumScale;
+					points.forces[i] = FVector3f::ZeroVector;
+				}
+				else
+				{
+					points.positions[i] = state.startPositions[i] + v * offset;
+					points.velocities[i] = state.startVelocities[i] + a * offset;
+					points.forces[i] = state.externalForces[i];
+				}
+			}
+		});
+	}
+}
+
+void
+RK4Integrator::step(SpringMassSystem& system, IntegratorState& state, float deltaT)
+{
+	MassPoints& points = system.massPoints;
+	const int32 n = points.num();
+
+	state.startPositions = points.positions;
+	state.startVelocities = points.velocities;
+	state.externalForces = points.forces;
+	state.sumPositions.SetNumUninitialized(n);
+	state.sumVelocities.SetNumUninitialized(n);
+	FMemory::Memzero(state.sumPositions.GetData(), n * sizeof(FVector3f));
+	FMemory::Memzero(state.sumVelocities.GetData(), n * sizeof(FVector3f));
+
+	const float sumScale = deltaT / 6.0f;
+	rk4Stage<false>(system, state, 1.0f, 0.5f * deltaT, sumScale);
+	rk4Stage<false>(system, state, 2.0f, 0.5f * deltaT, sumScale);
+	rk4Stage<false>(system, state, 2.0f, deltaT, sumScale);
+	rk4Stage<true>(system, state, 1.0f, 0.0f, sumScale);
+}
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "MassPoints.h"
+
+class SpringMassSystem;
+
+/**
+ * Scratch buffers of the explicit integrators. Multi-step schemes keep
+ * history here between steps; it is cleared whenever the topology or the
+ * integrator changes.
+ */
+struct SPRING_MASS_API IntegratorState
+{
+	// position Verlet: positions of the previous step and its length
+	TArray<FVector3f> prevPositions;
+	float prevDeltaT = 0.0f;
+	// velocity Verlet: accelerations at the end of the previous step
+	TArray<FVector3f> accelerations;
+	// RK4: state at the beginning of the step, external forces and stage sums
+	TArray<FVector3f> startPositions;
+	TArray<FVector3f> startVelocities;
+	TArray<FVector3f> externalForces;
+	TArray<FVector3f> sumPositions;
+	TArray<FVector3f> sumVelocities;
+	// history is valid
+	bool primed = false;
+
+	void reset();
+};
+
+// Explicit integrator policies. Each one advances a SpringMassSystem by one
+// step through SpringMassSystem::stepExplicit<Policy>; the per mass point
+// loops are instantiated per policy, pinned points are handled by their zero
+// inverse mass and gravity mask instead of a branch.
+
+// v += a h, x += v h
+struct SPRING_MASS_API SymplecticEulerIntegrator
+{
+	static void step(SpringMassSystem& system, IntegratorState& state, float deltaT);
+};
+
+// x' = x + (x - x_prev) h / h_prev + a h^2, v = (x' - x_prev) / (h + h_prev)
+struct SPRING_MASS_API PositionVerletIntegrator
+{
+	static void step(SpringMassSystem& system, IntegratorState& state, float deltaT);
+};
+
+// x += v h + a h^2 / 2, v += (a + a') h / 2
+struct SPRING_MASS_API VelocityVerletIntegrator
+{
+	static void step(SpringMassSystem& system, IntegratorState& state, float deltaT);
+};
+
+// classic fourth order Runge-Kutta, four force evaluations per step
+struct SPRING_MASS_API RK4Integrator
+{
+	static void step(SpringMassSystem& system, IntegratorState& state, float deltaT);
+};
+
+// acceleration of mass point i from its accumulated force and gravity
+FORCEINLINE FVector3f pointAcceleration(const MassPoints& points, int32 i, const FVector3f& gravity)
+{
+	return points.forces[i] * points.invMasses[i] + gravity * float(!points.pinned[i]);
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MassPoints.h"
+#include "spring_mass.h"
+
+
+uint32
+MassPoints::add(const FVector3f& pos, float mass, bool movable)
+{
+	positions.Add(pos);
+	velocities.Add(FVector3f::ZeroVector);
+	forces.Add(FVector3f::ZeroVector);
+	invMasses.Add(movable ? 1.0f / mass : 0.0f);
+	return pinned.Add(movable ? 0 : 1);
+}
+
+void
+MassPoints::reset(int32 reserve)
+{
+	positions.Reset(reserve);
+	velocities.Reset(reserve);
+	forces.Reset(reserve);
+	invMasses.Reset(reserve);
+	pinned.Reset(reserve);
+}
+
+void
+MassPoints::addForce(uint32 id, const FVector3f& f)
+{
+	if (!pinned[id])
+	{
+		forces[id] += f;
+	}
+}
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Mass points of a spring-mass system stored as a structure of arrays.
+ * A mass point is identified by its 32-bit index, which is the same in every
+ * array and equals the index of the vertex it is attached to.
+ */
+struct SPRING_MASS_API MassPoints
+{
+	// current position in local coordinate system
+	TArray<FVector3f> positions;
+	// current mass-spring system state
+	TArray<FVector3f> velocities;
+	TArray<FVector3f> forces;
+	// 1 / mass, zero for fixed points
+	TArray<float> invMasses;
+	// is this point fixed?
+	TArray<uint8> pinned;
+
+	// append a mass point and return its index
+	uint32 add(const FVector3f& pos, float mass, bool movable);
+	// remove all mass points, keep the allocations
+	void reset(int32 reserve = 0);
+	int32 num() const { return positions.Num(); }
+
+	// add an external force
+	void addForce(uint32 id, const FVector3f& f);
+};
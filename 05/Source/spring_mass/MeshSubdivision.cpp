@@ -0,0 +1,360 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MeshSubdivision.h"
+#include "spring_mass.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Sort.h"
+#include "Misc/ScopeLock.h"
+
+
+// both orders of a pair give the same key
+static uint64
+pairKey(uint32 a, uint32 b)
+{
+	return a < b ? (uint64(a) << 32) | b : (uint64(b) << 32) | a;
+}
+
+// an edge with the corners opposite to it in its first two triangles
+struct SubdivisionEdge
+{
+	uint32 a;
+	uint32 b;
+	uint32 opposite[2];
+	int32 triangles;
+};
+
+// rows of weights over the vertices of the level before, in CSR form
+struct SubdivisionStencils
+{
+	TArray<int32> offsets;
+	TArray<int32> points;
+	TArray<float> weights;
+
+	void add(int32 point, float weight)
+	{
+		points.Add(point);
+		weights.Add(weight);
+	}
+	void endRow() { offsets.Add(points.Num()); }
+};
+
+// one level of Loop subdivision: the stencils of the new vertices over the
+// old ones, the new triangles and UVs. Vertices that keep their place are
+// marked in fixed, rest positions on the first level add the corners of the
+// border to them
+static void
+subdivideOnce(const TArray<uint32>& indices, const TArray<FVector2f>& uvs, const TArray<FVector3f>* positions,
+	TArray<uint8>& fixed, SubdivisionStencils& stencils, TArray<uint32>& newIndices, TArray<FVector2f>& newUVs)
+{
+	const int32 numVertices = uvs.Num();
+	const int32 numTriangles = indices.Num() / 3;
+
+	// edges in the order they are first seen, so the new vertices follow the triangles
+	TMap<uint64, int32> edgeIds;
+	edgeIds.Reserve(indices.Num());
+	TArray<SubdivisionEdge> edges;
+	edges.Reserve(indices.Num());
+	TArray<int32> triangleEdges;
+	triangleEdges.SetNumUninitialized(numTriangles * 3);
+	for (int32 t = 0; t < numTriangles; t++)
+	{
+		for (int32 e = 0; e < 3; e++)
+		{
+			const uint32 a = indices[3 * t + e];
+			const uint32 b = indices[3 * t + (e + 1) % 3];
+			const uint64 key = pairKey(a, b);
+			const int32* found = edgeIds.Find(key);
+			const int32 id = found ? *found : edges.Num();
+			if (!found)
+			{
+				edgeIds.Add(key, id);
+				edges.Add({ a, b, { 0, 0 }, 0 });
+			}
+			SubdivisionEdge& edge = edges[id];
+			if (edge.triangles < 2)
+			{
+				edge.opposite[edge.triangles] = indices[3 * t + (e + 2) % 3];
+			}
+			edge.triangles++;
+			triangleEdges[3 * t + e] = id;
+		}
+	}
+
+	// neighbours of every vertex, and the ones along border edges
+	TArray<int32> neighbourOffsets;
+	neighbourOffsets.Init(0, numVertices + 1);
+	TArray<int32> borderCounts;
+	borderCounts.Init(0, numVertices);
+	TArray<uint32> borderNeighbours;
+	borderNeighbours.Init(0, numVertices * 2);
+	for (const SubdivisionEdge& edge : edges)
+	{
+		neighbourOffsets[edge.a + 1]++;
+		neighbourOffsets[edge.b + 1]++;
+		if (edge.triangles != 2)
+		{
+			if (borderCounts[edge.a] < 2)
+			{
+				borderNeighbours[2 * edge.a + borderCounts[edge.a]] = edge.b;
+			}
+			if (borderCounts[edge.b] < 2)
+			{
+				borderNeighbours[2 * edge.b + borderCounts[edge.b]] = edge.a;
+			}
+			borderCounts[edge.a]++;
+			borderCounts[edge.b]++;
+		}
+	}
+	for (int32 v = 0; v < numVertices; v++)
+	{
+		neighbourOffsets[v + 1] += neighbourOffsets[v];
+	}
+	TArray<int32> cursor = neighbourOffsets;
+	TArray<uint32> neighbours;
+	neighbours.SetNumUninitialized(neighbourOffsets[numVertices]);
+	for (const SubdivisionEdge& edge : edges)
+	{
+		neighbours[cursor[edge.a]++] = edge.b;
+		neighbours[cursor[edge.b]++] = edge.a;
+	}
+
+	// a border runs through a vertex at most once, and it bends at the corners
+	for (int32 v = 0; v < numVertices; v++)
+	{
+		if (borderCounts[v] != 0 && borderCounts[v] != 2)
+		{
+			fixed[v] = 1;
+		}
+		else if (positions && borderCounts[v] == 2)
+		{
+			const FVector3f& p = (*positions)[v];
+			const FVector3f d0 = ((*positions)[borderNeighbours[2 * v]] - p).GetSafeNormal();
+			const FVector3f d1 = ((*positions)[borderNeighbours[2 * v + 1]] - p).GetSafeNormal();
+			fixed[v] |= uint8(FVector3f::DotProduct(d0, d1) > -0.99f);
+		}
+	}
+
+	stencils.offsets.Reset(numVertices + edges.Num() + 1);
+	stencils.points.Reset();
+	stencils.weights.Reset();
+	stencils.endRow();
+
+	// the old vertices move towards their neighbours
+	for (int32 v = 0; v < numVertices; v++)
+	{
+		const int32 valence = neighbourOffsets[v + 1] - neighbourOffsets[v];
+		if (fixed[v] || valence == 0)
+		{
+			stencils.add(v, 1.0f);
+		}
+		else if (borderCounts[v] == 2)
+		{
+			stencils.add(v, 0.75f);
+			stencils.add(borderNeighbours[2 * v], 0.125f);
+			stencils.add(borderNeighbours[2 * v + 1], 0.125f);
+		}
+		else
+		{
+			const float beta = valence == 3 ? 3.0f / 16.0f : 3.0f / (8.0f * valence);
+			stencils.add(v, 1.0f - valence * beta);
+			for (int32 k = neighbourOffsets[v]; k < neighbourOffsets[v + 1]; k++)
+			{
+				stencils.add(neighbours[k], beta);
+			}
+		}
+		stencils.endRow();
+	}
+
+	// a new vertex on every edge
+	for (const SubdivisionEdge& edge : edges)
+	{
+		if (edge.triangles == 2)
+		{
+			stencils.add(edge.a, 0.375f);
+			stencils.add(edge.b, 0.375f);
+			stencils.add(edge.opposite[0], 0.125f);
+			stencils.add(edge.opposite[1], 0.125f);
+		}
+		else
+		{
+			stencils.add(edge.a, 0.5f);
+			stencils.add(edge.b, 0.5f);
+		}
+		stencils.endRow();
+	}
+
+	newUVs.Reset(numVertices + edges.Num());
+	newUVs.Append(uvs);
+	for (const SubdivisionEdge& edge : edges)
+	{
+		newUVs.Add((uvs[edge.a] + uvs[edge.b]) * 0.5f);
+	}
+	fixed.SetNumZeroed(numVertices + edges.Num());
+
+	// four triangles in place of each, with the winding of the old one
+	newIndices.Reset(numTriangles * 12);
+	for (int32 t = 0; t < numTriangles; t++)
+	{
+		const uint32 a = indices[3 * t];
+		const uint32 b = indices[3 * t + 1];
+		const uint32 c = indices[3 * t + 2];
+		const uint32 ab = numVertices + triangleEdges[3 * t];
+		const uint32 bc = numVertices + triangleEdges[3 * t + 1];
+		const uint32 ca = numVertices + triangleEdges[3 * t + 2];
+		newIndices.Append({ a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca });
+	}
+}
+
+void
+MeshSubdivision::init(const SpringMassTopology& topology, int32 levels)
+{
+	const int32 numPoints = topology.positions.Num();
+	m_levels = levels;
+	m_indices = topology.indices;
+	m_indices.SetNum(m_indices.Num() / 3 * 3);
+	m_uvs = topology.uvs;
+	m_uvs.SetNumZeroed(numPoints);
+
+	// start from every mass point as it is
+	SubdivisionStencils total;
+	total.endRow();
+	for (int32 p = 0; p < numPoints; p++)
+	{
+		total.add(p, 1.0f);
+		total.endRow();
+	}
+
+	TArray<uint8> fixed;
+	fixed.SetNumZeroed(numPoints);
+	for (int32 p = 0; p < numPoints && p < topology.pinned.Num(); p++)
+	{
+		fixed[p] = topology.pinned[p];
+	}
+
+	SubdivisionStencils level;
+	SubdivisionStencils next;
+	TArray<uint32> indices;
+	TArray<FVector2f> uvs;
+	TArray<float> sums;
+	sums.Init(0.0f, numPoints);
+	// row that last touched each mass point
+	TArray<int32> touchedBy;
+	TArray<int32> touched;
+	for (int32 l = 0; l < levels; l++)
+	{
+		subdivideOnce(m_indices, m_uvs, l == 0 ? &topology.positions : nullptr, fixed, level, indices, uvs);
+		Swap(m_indices, indices);
+		Swap(m_uvs, uvs);
+
+		// the new stencils over the mass points: the weights of a level over
+		// the vertices of the one before, times their stencils
+		const int32 numRows = level.offsets.Num() - 1;
+		touchedBy.Init(INDEX_NONE, numPoints);
+		next.offsets.Reset(numRows + 1);
+		next.points.Reset();
+		next.weights.Reset();
+		next.endRow();
+		for (int32 row = 0; row < numRows; row++)
+		{
+			for (int32 k = level.offsets[row]; k < level.offsets[row + 1]; k++)
+			{
+				const int32 v = level.points[k];
+				for (int32 j = total.offsets[v]; j < total.offsets[v + 1]; j++)
+				{
+					const int32 p = total.points[j];
+					if (touchedBy[p] != row)
+					{
+						touchedBy[p] = row;
+						touched.Add(p);
+					}
+					sums[p] += level.weights[k] * total.weights[j];
+				}
+			}
+			// in mass point order, so neighbouring vertices read memory in the same direction
+			Algo::Sort(touched);
+			for (int32 p : touched)
+			{
+				next.add(p, sums[p]);
+				sums[p] = 0.0f;
+			}
+			touched.Reset();
+			next.endRow();
+		}
+		Swap(total, next);
+	}
+
+	// slices of vertices padded to their longest stencil, lane by lane, with
+	// weight 0 on a mass point the stencil reads anyway
+	constexpr int32 Slice = SimdKernels::StencilSlice;
+	m_numVertices = total.offsets.Num() - 1;
+	const int32 numSlices = FMath::DivideAndRoundUp(m_numVertices, Slice);
+	m_sliceOffsets.SetNumUninitialized(numSlices + 1);
+	m_slicePoints.Reset();
+	m_sliceWeights.Reset();
+	for (int32 s = 0; s < numSlices; s++)
+	{
+		m_sliceOffsets[s] = m_slicePoints.Num();
+		const int32 firstVertex = s * Slice;
+		const int32 lastVertex = FMath::Min(m_numVertices, firstVertex + Slice);
+		int32 length = 0;
+		for (int32 v = firstVertex; v < lastVertex; v++)
+		{
+			length = FMath::Max(length, total.offsets[v + 1] - total.offsets[v]);
+		}
+		for (int32 k = 0; k < length; k++)
+		{
+			for (int32 lane = 0; lane < Slice; lane++)
+			{
+				const int32 v = FMath::Min(firstVertex + lane, lastVertex - 1);
+				const int32 first = total.offsets[v];
+				const bool bInside = firstVertex + lane < lastVertex && first + k < total.offsets[v + 1];
+				m_slicePoints.Add(3 * total.points[bInside ? first + k : first]);
+				m_sliceWeights.Add(bInside ? total.weights[first + k] : 0.0f);
+			}
+		}
+	}
+	m_sliceOffsets[numSlices] = m_slicePoints.Num();
+}
+
+MeshSubdivisionRef
+MeshSubdivision::get(const SpringMassTopologyRef& topology, int32 levels)
+{
+	// the subdivisions in use, found by the topology they keep alive. There are
+	// few of them, expired ones are dropped while looking
+	static FCriticalSection lock;
+	static TArray<TWeakPtr<const MeshSubdivision, ESPMode::ThreadSafe>> subdivisions;
+	FScopeLock scope(&lock);
+
+	for (int32 i = subdivisions.Num() - 1; i >= 0; --i)
+	{
+		const TSharedPtr<const MeshSubdivision, ESPMode::ThreadSafe> shared = subdivisions[i].Pin();
+		if (!shared)
+		{
+			subdivisions.RemoveAtSwap(i);
+		}
+		else if (shared->m_topology.Get() == &topology.Get() && shared->m_levels == levels)
+		{
+			return shared.ToSharedRef();
+		}
+	}
+	TSharedRef<MeshSubdivision, ESPMode::ThreadSafe> subdivision = MakeShared<MeshSubdivision, ESPMode::ThreadSafe>();
+	subdivision->init(*topology, levels);
+	subdivision->m_topology = topology;
+	subdivisions.Add(subdivision);
+	return subdivision;
+}
+
+void
+MeshSubdivision::evaluate(const TArray<FVector3f>& positions, TArray<FVector3f>& vertices, const SimdKernels& kernels, bool bParallel) const
+{
+	vertices.SetNumUninitialized(m_numVertices, false);
+	const float* x = reinterpret_cast<const float*>(positions.GetData());
+	float* out = reinterpret_cast<float*>(vertices.GetData());
+	const int32 numSlices = m_sliceOffsets.Num() - 1;
+	const int32 numTasks = FMath::DivideAndRoundUp(numSlices, SlicesPerTask);
+	ParallelFor(numTasks, [this, &kernels, x, out, numSlices](int32 task)
+	{
+		const int32 first = task * SlicesPerTask;
+		kernels.gatherStencils(x, m_slicePoints.GetData(), m_sliceWeights.GetData(), m_sliceOffsets.GetData(), first, FMath::Min(numSlices, first + SlicesPerTask), m_numVertices, out);
+	}, !bParallel);
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SpringMassTopology.h"
+#include "SimdKernels.h"
+
+class MeshSubdivision;
+// subdivisions are read only once shared
+typedef TSharedRef<const MeshSubdivision, ESPMode::ThreadSafe> MeshSubdivisionRef;
+
+/**
+ * Loop subdivision of the triangles of a SpringMassTopology, for rendering a
+ * smooth surface over fewer simulated mass points.
+ *
+ * Every level splits each triangle into four. A vertex moves towards its
+ * neighbours with Loop's weights, a new vertex on an edge takes 3/8 of its
+ * ends and 1/8 of the corners opposite to it. Border edges and edges of more
+ * than two triangles are curves of their own: their vertices only see their
+ * neighbours along the border, so the cloth keeps its outline. Pinned points
+ * and corners of the rest shape stay where the simulation puts them.
+ *
+ * The weights only depend on the triangles. All levels are multiplied out
+ * into one stencil per vertex, the mass points it reads and their weights.
+ * The stencils are stored in slices of SimdKernels::StencilSlice vertices,
+ * interleaved lane by lane and padded with zero weights to the longest one of
+ * the slice. Per frame SimdKernels::gatherStencils computes a slice with one
+ * gather per component and stencil entry, with no adjacency lookups and the
+ * slices in parallel. Texture coordinates are interpolated linearly.
+ */
+class SPRING_MASS_API MeshSubdivision
+{
+public:
+	// slices of vertices computed by one parallel task
+	static constexpr int32 SlicesPerTask = 64;
+
+	// build the stencils of levels subdivisions of a topology
+	void init(const SpringMassTopology& topology, int32 levels);
+
+	// the subdivision of a topology, shared by every system using it
+	static MeshSubdivisionRef get(const SpringMassTopologyRef& topology, int32 levels);
+
+	// vertices of the subdivided surface over the mass point positions
+	void evaluate(const TArray<FVector3f>& positions, TArray<FVector3f>& vertices, const SimdKernels& kernels, bool bParallel) const;
+
+	int32 numVertices() const { return m_numVertices; }
+	int32 numLevels() const { return m_levels; }
+	const TArray<uint32>& getIndices() const { return m_indices; }
+	const TArray<FVector2f>& getUVs() const { return m_uvs; }
+
+protected:
+	// the stencils of slice s are m_sliceOffsets[s] .. m_sliceOffsets[s + 1], see
+	// SimdKernels::gatherStencils; the points are float offsets, 3 per mass point
+	TArray<int32> m_sliceOffsets;
+	TArray<int32> m_slicePoints;
+	TArray<float> m_sliceWeights;
+	int32 m_numVertices = 0;
+
+	TArray<uint32> m_indices;
+	TArray<FVector2f> m_uvs;
+	int32 m_levels = 0;
+
+	// what get subdivided, kept alive while the subdivision is shared
+	TSharedPtr<const SpringMassTopology, ESPMode::ThreadSafe> m_topology;
+};
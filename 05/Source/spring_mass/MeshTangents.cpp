@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MeshTangents.h"
+#include "spring_mass.h"
+
+
+void
+MeshTangents::init(const TArray<uint32>& indices, const TArray<FVector2f>& uvs, int32 numVertices)
+{
+	m_indices = indices;
+	if (uvs.Num() == numVertices)
+	{
+		m_uvs = uvs;
+	}
+	else
+	{
+		m_uvs.Init(FVector2f::ZeroVector, numVertices);
+	}
+
+	// count the triangles of each vertex, then place them with a prefix sum
+	m_vertexLast.Init(0, numVertices);
+	for (uint32 index : indices)
+	{
+		m_vertexLast[index]++;
+	}
+	m_vertexFirst.SetNumUninitialized(numVertices);
+	int32 offset = 0;
+	for (int32 v = 0; v < numVertices; v++)
+	{
+		m_vertexFirst[v] = offset;
+		offset += m_vertexLast[v];
+		m_vertexLast[v] = m_vertexFirst[v];
+	}
+
+	m_vertexTriangles.SetNumUninitialized(indices.Num());
+	for (int32 i = 0; i < indices.Num(); i++)
+	{
+		m_vertexTriangles[m_vertexLast[indices[i]]++] = i / 3;
+	}
+}
+
+void
+MeshTangents::splitVertices(const TArray<uint32>& indices, const TArray<uint32>& sources, const TArray<int32>& triangles)
+{
+	check(indices.Num() == m_indices.Num());
+	const int32 first = numVertices();
+	const int32 n = first + sources.Num();
+	for (int32 t : triangles)
+	{
+		FMemory::Memcpy(&m_indices[3 * t], &indices[3 * t], 3 * sizeof(uint32));
+	}
+	for (uint32 source : sources)
+	{
+		m_uvs.Add(m_uvs[source]);
+	}
+
+	// the split vertices keep the triangles that still use them
+	for (uint32 source : sources)
+	{
+		if (int32(source) >= first)
+		{
+			continue;
+		}
+		int32 last = m_vertexFirst[source];
+		for (int32 k = m_vertexFirst[source]; k < m_vertexLast[source]; k++)
+		{
+			const uint32* triangle = &m_indices[3 * m_vertexTriangles[k]];
+			if (triangle[0] == source || triangle[1] == source || triangle[2] == source)
+			{
+				m_vertexTriangles[last++] = m_vertexTriangles[k];
+			}
+		}
+		m_vertexLast[source] = last;
+	}
+
+	// the new vertices only have changed triangles, their rows go past the others
+	m_vertexFirst.SetNumUninitialized(n);
+	m_vertexLast.SetNumUninitialized(n);
+	for (int32 v = first; v < n; v++)
+	{
+		m_vertexLast[v] = 0;
+	}
+	for (int32 t : triangles)
+	{
+		for (int32 corner = 0; corner < 3; corner++)
+		{
+			const int32 v = m_indices[3 * t + corner];
+			if (v >= first)
+			{
+				m_vertexLast[v]++;
+			}
+		}
+	}
+	int32 offset = m_vertexTriangles.Num();
+	for (int32 v = first; v < n; v++)
+	{
+		m_vertexFirst[v] = offset;
+		offset += m_vertexLast[v];
+		m_vertexLast[v] = m_vertexFirst[v];
+	}
+	m_vertexTriangles.SetNumUninitialized(offset);
+	for (int32 t : triangles)
+	{
+		for (int32 corner = 0; corner < 3; corner++)
+		{
+			const int32 v = m_indices[3 * t + corner];
+			if (v >= first)
+			{
+				m_vertexTriangles[m_vertexLast[v]++] = t;
+			}
+		}
+	}
+}
+
+void
+MeshTangents::compute(const TArray<FVector3f>& positions, int32 first, int32 last, SpringMassMeshTangent* tangents) const
+{
+	for (int32 v = first; v < last; v++)
+	{
+		FVector3f normal = FVector3f::ZeroVector;
+		FVector3f tangent = FVector3f::ZeroVector;
+		FVector3f bitangent = FVector3f::ZeroVector;
+
+		for (int32 k = m_vertexFirst[v]; k < m_vertexLast[v]; k++)
+		{
+			const uint32* triangle = &m_indices[3 * m_vertexTriangles[k]];
+			const FVector3f& p0 = positions[triangle[0]];
+			const FVector3f edge1 = positions[triangle[1]] - p0;
+			const FVector3f edge2 = positions[triangle[2]] - p0;
+
+			// winding of the engine's mesh tools, the length is twice the area
+			normal += edge2 ^ edge1;
+
+			// direction of increasing U and V in the plane of the triangle
+			const FVector2f& uv0 = m_uvs[triangle[0]];
+			const FVector2f uv1 = m_uvs[triangle[1]] - uv0;
+			const FVector2f uv2 = m_uvs[triangle[2]] - uv0;
+			const float det = uv1.X * uv2.Y - uv2.X * uv1.Y;
+			if (FMath::Abs(det) > SMALL_NUMBER)
+			{
+				const float invDet = 1.0f / det;
+				tangent += (edge1 * uv2.Y - edge2 * uv1.Y) * invDet;
+				bitangent += (edge2 * uv1.X - edge1 * uv2.X) * invDet;
+			}
+		}
+
+		if (!normal.Normalize())
+		{
+			normal = FVector3f(0, 0, 1);
+		}
+
+		// orthogonalize, or any direction in the plane without usable UVs
+		tangent -= normal * (normal | tangent);
+		if (!tangent.Normalize())
+		{
+			tangent = normal ^ (FMath::Abs(normal.X) < 0.9f ? FVector3f(1, 0, 0) : FVector3f(0, 1, 0));
+			tangent.Normalize();
+		}
+		const float sign = ((normal ^ tangent) | bitangent) < 0.0f ? -1.0f : 1.0f;
+
+		tangents[v].tangentX = FPackedNormal(tangent);
+		tangents[v].tangentZ = FPackedNormal(FVector4f(normal, sign));
+	}
+}
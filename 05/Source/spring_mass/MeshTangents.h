@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "PackedNormal.h"
+
+// tangent frame of a vertex in the layout of the static mesh tangent buffer,
+// tangentZ.W holds the sign of the bitangent
+struct SpringMassMeshTangent
+{
+	FPackedNormal tangentX;
+	FPackedNormal tangentZ;
+};
+
+/**
+ * Per-vertex normals and tangents of a triangle list with fixed topology.
+ *
+ * The triangles around each vertex are stored as rows of one array: the
+ * triangles of vertex v are m_vertexTriangles[m_vertexFirst[v] .. m_vertexLast[v]).
+ * A vertex gathers the area weighted face normals and UV tangents of its
+ * triangles, so any vertex ranges can be computed in parallel without
+ * atomics, at the cost of evaluating each face once per corner.
+ *
+ * Splitting vertices only rewrites the rows of the split vertices, which
+ * shrink in place, and appends the rows of the new ones.
+ */
+class SPRING_MASS_API MeshTangents
+{
+public:
+	// store the triangle list and UVs and build the vertex to triangle adjacency
+	void init(const TArray<uint32>& indices, const TArray<FVector2f>& uvs, int32 numVertices);
+
+	// vertices were appended as copies of sources, with their UVs, and the
+	// given triangles of indices now use them instead
+	void splitVertices(const TArray<uint32>& indices, const TArray<uint32>& sources, const TArray<int32>& triangles);
+
+	// tangent frames of vertices [first, last) for the given positions
+	void compute(const TArray<FVector3f>& positions, int32 first, int32 last, SpringMassMeshTangent* tangents) const;
+
+	int32 numVertices() const { return m_vertexFirst.Num(); }
+	const TArray<uint32>& getIndices() const { return m_indices; }
+	const TArray<FVector2f>& getUVs() const { return m_uvs; }
+	// triangles of vertex v
+	TArrayView<const int32> getVertexTriangles(int32 v) const { return MakeArrayView(m_vertexTriangles.GetData() + m_vertexFirst[v], m_vertexLast[v] - m_vertexFirst[v]); }
+
+protected:
+	TArray<uint32> m_indices;
+	TArray<FVector2f> m_uvs;
+
+	// vertex to triangle adjacency
+	TArray<int32> m_vertexFirst;
+	TArray<int32> m_vertexLast;
+	TArray<int32> m_vertexTriangles;
+};
@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RestState.h"
+#include "spring_mass.h"
+#include "SpringMassSystem.h"
+
+
+static uint32
+hashFloat(uint32 hash, float value)
+{
+	uint32 bits;
+	FMemory::Memcpy(&bits, &value, sizeof(bits));
+	return HashCombine(hash, bits);
+}
+
+static uint32
+hashVector(uint32 hash, const FVector3f& v)
+{
+	return hashFloat(hashFloat(hashFloat(hash, v.X), v.Y), v.Z);
+}
+
+uint32
+RestStateCache::fingerprint(const SpringMassSystem& system)
+{
+	const MassPoints& points = system.massPoints;
+	uint32 hash = HashCombine(uint32(points.num()), uint32(system.numSprings()));
+	hash = hashFloat(hashFloat(hashFloat(hash, system.m_mass), system.m_stiffness), system.m_damper);
+	hash = hashVector(hash, system.m_gravity);
+
+	// a lattice is the same whether or not it lists its springs. Listed ones
+	// are sorted by color, which only depends on their original order
+	if (system.m_grid.isInitialized())
+	{
+		const GridStencil& grid = system.m_grid;
+		hash = hashFloat(HashCombine(hash, HashCombine(uint32(grid.numRows()), uint32(grid.numCols()))), grid.getSpacing());
+	}
+	else
+	{
+		for (const Spring& s : system.getSprings())
+		{
+			hash = hashFloat(HashCombine(hash, HashCombine(s.m_m1, s.m_m2)), s.m_spring_length_init);
+		}
+	}
+	// pinned points keep the position they were loaded with
+	for (int32 i = 0; i < points.num(); i++)
+	{
+		if (points.pinned[i])
+		{
+			hash = hashVector(HashCombine(hash, uint32(i)), points.positions[i]);
+		}
+	}
+	return hash;
+}
+
+void
+RestStateCache::write(const SpringMassSystem& system, float bakedTime, float residualSpeed, TArray<uint8>& cache)
+{
+	const MassPoints& points = system.massPoints;
+	const SIZE_T arrayBytes = points.num() * sizeof(FVector3f);
+
+	RestStateHeader header;
+	header.magic = Magic;
+	header.version = Version;
+	header.numPoints = points.num();
+	header.numSprings = system.numSprings();
+	header.fingerprint = fingerprint(system);
+	header.bakedTime = bakedTime;
+	header.residualSpeed = residualSpeed;
+	header.reserved = 0;
+
+	cache.SetNumUninitialized(sizeof(RestStateHeader) + 2 * arrayBytes);
+	uint8* data = cache.GetData();
+	FMemory::Memcpy(data, &header, sizeof(RestStateHeader));
+	FMemory::Memcpy(data + sizeof(RestStateHeader), points.positions.GetData(), arrayBytes);
+	FMemory::Memcpy(data + sizeof(RestStateHeader) + arrayBytes, points.velocities.GetData(), arrayBytes);
+}
+
+bool
+RestStateCache::read(SpringMassSystem& system, TArrayView<const uint8> cache)
+{
+	MassPoints& points = system.massPoints;
+	const SIZE_T arrayBytes = points.num() * sizeof(FVector3f);
+	if (SIZE_T(cache.Num()) != sizeof(RestStateHeader) + 2 * arrayBytes)
+	{
+		return false;
+	}
+
+	RestStateHeader header;
+	FMemory::Memcpy(&header, cache.GetData(), sizeof(RestStateHeader));
+	if (header.magic != Magic || header.version != Version || header.numPoints != uint32(points.num())
+		|| header.numSprings != uint32(system.numSprings()) || header.fingerprint != fingerprint(system))
+	{
+		return false;
+	}
+
+	const uint8* data = cache.GetData() + sizeof(RestStateHeader);
+	FMemory::Memcpy(points.positions.GetData(), data, arrayBytes);
+	FMemory::Memcpy(points.velocities.GetData(), data + arrayBytes, arrayBytes);
+	for (FVector3f& force : points.forces)
+	{
+		force = FVector3f::ZeroVector;
+	}
+	system.restart();
+	return true;
+}
+
+bool
+RestStateBaker::bake(SpringMassSystem& system, TArray<uint8>& cache) const
+{
+	MassPoints& points = system.massPoints;
+	const float deltaT = system.m_solver == ESpringMassSolver::Explicit ? FMath::Min(m_maxStep, system.estimateStableStep()) : m_frameStep;
+
+	// sleeping regions would report a rest the springs have not reached, and
+	// a torn cloth would not fit the system the cache is read into
+	const bool bSleeping = system.m_sleep.m_enabled;
+	const bool bTearing = system.m_tearing.m_enabled;
+	system.m_sleep.m_enabled = false;
+	system.m_tearing.m_enabled = false;
+	system.restart();
+
+	float time = 0.0f;
+	float settled = 0.0f;
+	float maxSpeed = MAX_flt;
+	double previousEnergy = 0.0;
+	while (settled < m_settleTime && time < m_maxTime)
+	{
+		system.step(deltaT);
+		time += deltaT;
+
+		double energy = 0.0;
+		float maxSpeed2 = 0.0f;
+		for (int32 i = 0; i < points.num(); i++)
+		{
+			if (points.invMasses[i] > 0.0f)
+			{
+				const float speed2 = points.velocities[i].SizeSquared();
+				energy += speed2 / points.invMasses[i];
+				maxSpeed2 = FMath::Max(maxSpeed2, speed2);
+			}
+		}
+		maxSpeed = FMath::Sqrt(maxSpeed2);
+		settled = maxSpeed < m_settledSpeed ? settled + deltaT : 0.0f;
+
+		// past a peak of the kinetic energy the cloth swings through its
+		// equilibrium, stopping it there removes the swing without a drag
+		// that would slow the fall
+		if (energy < previousEnergy)
+		{
+			for (FVector3f& velocity : points.velocities)
+			{
+				velocity = FVector3f::ZeroVector;
+			}
+			system.restart();
+			energy = 0.0;
+		}
+		previousEnergy = energy;
+	}
+
+	system.m_sleep.m_enabled = bSleeping;
+	system.m_tearing.m_enabled = bTearing;
+	RestStateCache::write(system, time, maxSpeed, cache);
+	return settled >= m_settleTime;
+}
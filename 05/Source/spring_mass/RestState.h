@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class SpringMassSystem;
+
+/**
+ * Settled positions and velocities of a spring-mass system, baked offline so
+ * a cloth starts at rest instead of sagging into shape after it spawns.
+ *
+ * A cache is a header followed by the positions and the velocities as laid
+ * out in MassPoints, so it can be memory-mapped and copied into the system
+ * as is. The header carries a fingerprint of the springs, pinned points and
+ * parameters the equilibrium depends on, a cache of another system is refused.
+ */
+struct RestStateHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint32 numPoints;
+	uint32 numSprings;
+	uint32 fingerprint;
+	// simulated seconds of the bake and the largest speed it left
+	float bakedTime;
+	float residualSpeed;
+	uint32 reserved;
+};
+
+class SPRING_MASS_API RestStateCache
+{
+public:
+	static constexpr uint32 Magic = 0x53524d53; // "SMRS"
+	static constexpr uint32 Version = 1;
+
+	// hash of everything the settled shape depends on
+	static uint32 fingerprint(const SpringMassSystem& system);
+
+	// the current positions and velocities of system
+	static void write(const SpringMassSystem& system, float bakedTime, float residualSpeed, TArray<uint8>& cache);
+
+	// replace the positions and velocities of system, false and nothing
+	// changed if the cache is damaged or was baked for another system
+	static bool read(SpringMassSystem& system, TArrayView<const uint8> cache);
+};
+
+/**
+ * Simulates a system until it comes to rest. The kinetic energy is removed
+ * whenever it peaks, which takes a hanging cloth to its equilibrium in a
+ * fraction of the time its own damping would.
+ */
+class SPRING_MASS_API RestStateBaker
+{
+public:
+	// largest explicit step, the implicit and XPBD solvers take m_frameStep
+	float m_maxStep = 1 / 200.0f;
+	float m_frameStep = 1 / 90.0f;
+	// at rest once no point moved faster than this for m_settleTime seconds
+	float m_settledSpeed = 0.01f;
+	float m_settleTime = 0.25f;
+	// simulated seconds after which the bake gives up
+	float m_maxTime = 60.0f;
+
+	// settle system with its current settings and write its state into cache,
+	// false if it was still moving after m_maxTime
+	bool bake(SpringMassSystem& system, TArray<uint8>& cache) const;
+};
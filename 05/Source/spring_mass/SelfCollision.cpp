@@ -0,0 +1,299 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SelfCollision.h"
+#include "spring_mass.h"
+#include "SpringMassSystem.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+
+
+// closest point to p on triangle abc as barycentric weights, Ericson 5.1.5
+static FVector3f
+closestOnTriangle(const FVector3f& p, const FVector3f& a, const FVector3f& b, const FVector3f& c)
+{
+	const FVector3f ab = b - a;
+	const FVector3f ac = c - a;
+	const FVector3f ap = p - a;
+	const float d1 = ab | ap;
+	const float d2 = ac | ap;
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		return FVector3f(1, 0, 0);
+	}
+
+	const FVector3f bp = p - b;
+	const float d3 = ab | bp;
+	const float d4 = ac | bp;
+	if (d3 >= 0.0f && d4 <= d3)
+	{
+		return FVector3f(0, 1, 0);
+	}
+
+	const float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		const float v = d1 / (d1 - d3);
+		return FVector3f(1.0f - v, v, 0);
+	}
+
+	const FVector3f cp = p - c;
+	const float d5 = ab | cp;
+	const float d6 = ac | cp;
+	if (d6 >= 0.0f && d5 <= d6)
+	{
+		return FVector3f(0, 0, 1);
+	}
+
+	const float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		const float w = d2 / (d2 - d6);
+		return FVector3f(1.0f - w, 0, w);
+	}
+
+	const float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		return FVector3f(0, 1.0f - w, w);
+	}
+
+	const float denom = 1.0f / (va + vb + vc);
+	const float v = vb * denom;
+	const float w = vc * denom;
+	return FVector3f(1.0f - v - w, v, w);
+}
+
+void
+SelfCollision::init(const SpringMassSystem& system, const TArray<uint32>& indices)
+{
+	const TArray<FVector3f>& positions = system.massPoints.positions;
+	const int32 n = positions.Num();
+	m_indices = indices;
+
+	// spring neighbours, sorted for the binary search in isLinked
+	m_linkOffsets.Init(0, n + 1);
+	for (const Spring& s : system.getSprings())
+	{
+		m_linkOffsets[s.m_m1 + 1]++;
+		m_linkOffsets[s.m_m2 + 1]++;
+	}
+	for (int32 i = 0; i < n; i++)
+	{
+		m_linkOffsets[i + 1] += m_linkOffsets[i];
+	}
+	TArray<int32> cursor = m_linkOffsets;
+	m_links.SetNumUninitialized(m_linkOffsets[n]);
+	for (const Spring& s : system.getSprings())
+	{
+		m_links[cursor[s.m_m1]++] = s.m_m2;
+		m_links[cursor[s.m_m2]++] = s.m_m1;
+	}
+	for (int32 i = 0; i < n; i++)
+	{
+		Algo::Sort(MakeArrayView(m_links.GetData() + m_linkOffsets[i], m_linkOffsets[i + 1] - m_linkOffsets[i]));
+	}
+
+	m_triangleReach = 0.0f;
+	for (int32 k = 0; k + 2 < indices.Num(); k += 3)
+	{
+		const FVector3f& a = positions[indices[k]];
+		const FVector3f& b = positions[indices[k + 1]];
+		const FVector3f& c = positions[indices[k + 2]];
+		const FVector3f centroid = (a + b + c) / 3.0f;
+		m_triangleReach = FMath::Max(m_triangleReach, FMath::Max3(FVector3f::Dist(a, centroid), FVector3f::Dist(b, centroid), FVector3f::Dist(c, centroid)));
+	}
+	m_centroids.SetNumUninitialized(indices.Num() / 3);
+
+	m_positionDeltas.Init(FVector3f::ZeroVector, n);
+	m_velocityDeltas.Init(FVector3f::ZeroVector, n);
+}
+
+void
+SelfCollision::reset()
+{
+	m_indices.Empty();
+	m_linkOffsets.Empty();
+	m_links.Empty();
+	m_centroids.Empty();
+	m_positionDeltas.Empty();
+	m_velocityDeltas.Empty();
+}
+
+void
+SelfCollision::resolve(SpringMassSystem& system, IntegratorState& state)
+{
+	MassPoints& points = system.massPoints;
+	const int32 n = points.num();
+	if (m_positionDeltas.Num() != n)
+	{
+		return;
+	}
+
+	const int32 numTriangles = m_centroids.Num();
+	auto centroids = [this, &points, numTriangles](int32 batch)
+	{
+		const int32 last = FMath::Min(numTriangles, (batch + 1) * SpatialHash::BuildBatchSize);
+		for (int32 t = batch * SpatialHash::BuildBatchSize; t < last; t++)
+		{
+			const uint32* triangle = &m_indices[3 * t];
+			m_centroids[t] = (points.positions[triangle[0]] + points.positions[triangle[1]] + points.positions[triangle[2]]) / 3.0f;
+		}
+	};
+	const int32 batches = FMath::DivideAndRoundUp(numTriangles, SpatialHash::BuildBatchSize);
+	if (system.m_parallel)
+	{
+		ParallelFor(batches, centroids);
+	}
+	else
+	{
+		for (int32 batch = 0; batch < batches; batch++)
+		{
+			centroids(batch);
+		}
+	}
+	m_pointHash.build(points.positions, m_thickness, system.m_parallel);
+	m_triangleHash.build(m_centroids, m_triangleReach * EdgeStretch + m_thickness, system.m_parallel);
+
+	// gather, reads positions and velocities only
+	system.forEachPointBatch([this, &system](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			gather(system, i);
+		}
+	});
+
+	// apply
+	const bool bVerlet = state.primed && state.prevPositions.Num() == n;
+	system.forEachPointBatch([this, &points, &state, bVerlet](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			if (m_positionDeltas[i].IsZero() && m_velocityDeltas[i].IsZero())
+			{
+				continue;
+			}
+			points.positions[i] += m_positionDeltas[i];
+			points.velocities[i] += m_velocityDeltas[i];
+			// position Verlet takes its velocity from the previous position
+			if (bVerlet)
+			{
+				state.prevPositions[i] = points.positions[i] - points.velocities[i] * state.prevDeltaT;
+			}
+			m_positionDeltas[i] = FVector3f::ZeroVector;
+			m_velocityDeltas[i] = FVector3f::ZeroVector;
+		}
+	});
+}
+
+bool
+SelfCollision::isLinked(int32 a, int32 b) const
+{
+	int32 low = m_linkOffsets[a];
+	int32 high = m_linkOffsets[a + 1];
+	while (low < high)
+	{
+		const int32 mid = (low + high) / 2;
+		if (m_links[mid] < b)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return low < m_linkOffsets[a + 1] && m_links[low] == b;
+}
+
+void
+SelfCollision::gather(const SpringMassSystem& system, int32 i)
+{
+	const MassPoints& points = system.massPoints;
+	const float wi = points.invMasses[i];
+	if (wi == 0.0f)
+	{
+		return;
+	}
+
+	const FVector3f& p = points.positions[i];
+	const FVector3f& v = points.velocities[i];
+
+	FVector3f deltaX = FVector3f::ZeroVector;
+	FVector3f deltaV = FVector3f::ZeroVector;
+	int32 contacts = 0;
+	auto separate = [&](const FVector3f& normal, float depth, const FVector3f& relative, float share)
+	{
+		deltaX += normal * (depth * share);
+		const float approach = relative | normal;
+		if (approach < 0.0f)
+		{
+			deltaV -= normal * (approach * share);
+		}
+		contacts++;
+	};
+
+	// point against point
+	const FVector3f pointRange(m_thickness);
+	m_pointHash.forEachPointNear(p - pointRange, p + pointRange, [&](int32 j)
+	{
+		const FVector3f offset = p - points.positions[j];
+		const float distance2 = offset.SizeSquared();
+		if (j == i || distance2 >= m_thickness * m_thickness || isLinked(i, j))
+		{
+			return;
+		}
+		const float distance = FMath::Sqrt(distance2);
+		const FVector3f normal = distance > SMALL_NUMBER ? offset / distance : FVector3f(0, 0, 1);
+		const float wj = points.invMasses[j];
+		separate(normal, m_thickness - distance, v - points.velocities[j], wi / (wi + wj));
+	});
+
+	// point against triangle
+	const float triangleReach = m_triangleHash.getCellSize();
+	const FVector3f triangleRange(triangleReach);
+	m_triangleHash.forEachPointNear(p - triangleRange, p + triangleRange, [&](int32 t)
+	{
+		// bounding sphere first, most triangles in the cells are farther away
+		if (FVector3f::DistSquared(p, m_centroids[t]) >= triangleReach * triangleReach)
+		{
+			return;
+		}
+		const uint32* triangle = &m_indices[3 * t];
+		const FVector3f& a = points.positions[triangle[0]];
+		const FVector3f& b = points.positions[triangle[1]];
+		const FVector3f& c = points.positions[triangle[2]];
+		const FVector3f bary = closestOnTriangle(p, a, b, c);
+		const FVector3f toPoint = p - (a * bary.X + b * bary.Y + c * bary.Z);
+		const float distance2 = toPoint.SizeSquared();
+		if (distance2 >= m_thickness * m_thickness)
+		{
+			return;
+		}
+		for (int32 k = 0; k < 3; k++)
+		{
+			if (int32(triangle[k]) == i || isLinked(i, triangle[k]))
+			{
+				return;
+			}
+		}
+
+		const float distance = FMath::Sqrt(distance2);
+		FVector3f normal = distance > SMALL_NUMBER ? toPoint / distance : (b - a) ^ (c - a);
+		if (distance <= SMALL_NUMBER && !normal.Normalize())
+		{
+			return;
+		}
+		const float wt = bary.X * bary.X * points.invMasses[triangle[0]] + bary.Y * bary.Y * points.invMasses[triangle[1]] + bary.Z * bary.Z * points.invMasses[triangle[2]];
+		const FVector3f triangleVelocity = points.velocities[triangle[0]] * bary.X + points.velocities[triangle[1]] * bary.Y + points.velocities[triangle[2]] * bary.Z;
+		separate(normal, m_thickness - distance, v - triangleVelocity, wi / (wi + wt));
+	});
+
+	// averaged, contacts of one point overlap
+	if (contacts > 0)
+	{
+		m_positionDeltas[i] = deltaX / float(contacts);
+		m_velocityDeltas[i] = deltaV / float(contacts);
+	}
+}
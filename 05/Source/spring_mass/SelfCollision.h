@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SpatialHash.h"
+
+class SpringMassSystem;
+struct IntegratorState;
+
+/**
+ * Keeps the cloth of a spring-mass system from passing through itself.
+ *
+ * After each step the mass points are hashed into a grid with cells of
+ * m_thickness, and the triangle centroids into one with cells of the largest
+ * centroid to corner distance plus the thickness. Every point finds the points
+ * and triangles closer than m_thickness in the 27 cells around it. Pairs
+ * linked by a spring, and triangles with a corner linked to the point, are
+ * rest neighbours and skipped.
+ *
+ * Each awake point gathers its own share of the separation from all its
+ * contacts in parallel and the averaged corrections are applied afterwards,
+ * so no two tasks write the same point. Points are pushed away from close
+ * points by the inverse mass ratio of the pair and away from close triangles
+ * by that of the point and the triangle at the closest point; the triangle
+ * corners take their share when their own points meet the other layer. The
+ * approaching relative velocity is removed.
+ */
+class SPRING_MASS_API SelfCollision
+{
+public:
+	// triangles may stretch this much beyond their rest size before contacts can be missed
+	static constexpr float EdgeStretch = 1.25f;
+
+	bool m_enabled = false;
+	// distance the cloth keeps from itself
+	float m_thickness = 2.0f;
+
+	// store the triangles and the spring neighbours of every point,
+	// call after the springs are colored
+	void init(const SpringMassSystem& system, const TArray<uint32>& indices);
+	void reset();
+	bool isInitialized() const { return m_linkOffsets.Num() > 0; }
+
+	// separate the cloth where it came closer than m_thickness, call after a step
+	void resolve(SpringMassSystem& system, IntegratorState& state);
+
+protected:
+	TArray<uint32> m_indices;
+	// spring neighbours of point i are m_links[m_linkOffsets[i] .. m_linkOffsets[i + 1]), sorted
+	TArray<int32> m_linkOffsets;
+	TArray<int32> m_links;
+	// largest distance of a triangle corner from the centroid at rest
+	float m_triangleReach = 0.0f;
+
+	SpatialHash m_pointHash;
+	SpatialHash m_triangleHash;
+	TArray<FVector3f> m_centroids;
+	// separation gathered per point, applied once every point is done
+	TArray<FVector3f> m_positionDeltas;
+	TArray<FVector3f> m_velocityDeltas;
+
+	bool isLinked(int32 a, int32 b) const;
+	void gather(const SpringMassSystem& system, int32 i);
+};
@@ -0,0 +1,629 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SimdKernels.h"
+#include "spring_mass.h"
+#include "Integrators.h"
+
+#if PLATFORM_CPU_X86_FAMILY
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// MSVC accepts every intrinsic everywhere, clang and gcc need the instruction set per function
+#if defined(__clang__) || defined(__GNUC__)
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIMD_TARGET(isa)
+#endif
+
+// the vector kernels gather the indices and the rest length straight out of the spring list
+static_assert(sizeof(Spring) == 3 * sizeof(uint32), "Spring must be two indices and a rest length");
+static_assert(sizeof(FVector3f) == 3 * sizeof(float), "FVector3f must be three packed floats");
+
+namespace
+{
+	void springForcesScalar(const Spring* springs, int32 first, int32 last, MassPoints& points, float stiffness, float damper)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			springs[i].Tick(points, stiffness, damper);
+		}
+	}
+
+	void integrateScalar(MassPoints& points, int32 first, int32 last, const FVector3f& gravity, float deltaT)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			points.velocities[i] += pointAcceleration(points, i, gravity) * deltaT;
+			points.positions[i] += points.velocities[i] * deltaT;
+			points.forces[i] = FVector3f::ZeroVector;
+		}
+	}
+
+	void stencilSpringsScalar(const float* p, const float* q, int32 stride, int32 count, float rest, float stiffness, float damper, float* f)
+	{
+		for (int32 i = 0; i < count; i++)
+		{
+			const float dx = q[i] - p[i];
+			const float dy = q[stride + i] - p[stride + i];
+			const float dz = q[2 * stride + i] - p[2 * stride + i];
+			const float len = FMath::Sqrt(dx * dx + dy * dy + dz * dz);
+			// degenerate springs get a zero direction and so no force
+			const float inv = len > SMALL_NUMBER ? 1.0f / len : 0.0f;
+			const float nx = dx * inv, ny = dy * inv, nz = dz * inv;
+			const float vn = (p[3 * stride + i] - q[3 * stride + i]) * nx + (p[4 * stride + i] - q[4 * stride + i]) * ny + (p[5 * stride + i] - q[5 * stride + i]) * nz;
+			const float scale = stiffness * (len - rest) - damper * vn;
+			f[i] = scale * nx;
+			f[stride + i] = scale * ny;
+			f[2 * stride + i] = scale * nz;
+		}
+	}
+
+	// the sums of one slice into vertices, lanes past count are dropped
+	FORCEINLINE void storeSlice(const float sums[3][SimdKernels::StencilSlice], int32 count, float* vertices)
+	{
+		for (int32 lane = 0; lane < FMath::Min(count, SimdKernels::StencilSlice); lane++)
+		{
+			vertices[3 * lane] = sums[0][lane];
+			vertices[3 * lane + 1] = sums[1][lane];
+			vertices[3 * lane + 2] = sums[2][lane];
+		}
+	}
+
+	// also the SSE2 version: without gather the lanes would be loaded one by one anyway
+	void gatherStencilsScalar(const float* x, const int32* points, const float* weights, const int32* sliceOffsets, int32 first, int32 last, int32 count, float* vertices)
+	{
+		constexpr int32 Slice = SimdKernels::StencilSlice;
+		for (int32 s = first; s < last; s++)
+		{
+			float sums[3][Slice] = {};
+			for (int32 k = sliceOffsets[s]; k < sliceOffsets[s + 1]; k += Slice)
+			{
+				for (int32 lane = 0; lane < Slice; lane++)
+				{
+					const float* p = x + points[k + lane];
+					const float w = weights[k + lane];
+					sums[0][lane] += p[0] * w;
+					sums[1][lane] += p[1] * w;
+					sums[2][lane] += p[2] * w;
+				}
+			}
+			storeSlice(sums, count - Slice * s, vertices + 3 * Slice * s);
+		}
+	}
+
+	// add the forces of one vector of springs to both end points, scalar because the
+	// instruction sets below AVX-512 have no scatter
+	FORCEINLINE void scatterForces(float* forces, const int32* m1, const int32* m2, const float* fx, const float* fy, const float* fz, int32 count)
+	{
+		for (int32 lane = 0; lane < count; lane++)
+		{
+			float* f1 = forces + 3 * m1[lane];
+			float* f2 = forces + 3 * m2[lane];
+			f1[0] += fx[lane];
+			f1[1] += fy[lane];
+			f1[2] += fz[lane];
+			f2[0] -= fx[lane];
+			f2[1] -= fy[lane];
+			f2[2] -= fz[lane];
+		}
+	}
+
+#if PLATFORM_CPU_X86_FAMILY
+
+	void springForcesSSE2(const Spring* springs, int32 first, int32 last, MassPoints& points, float stiffness, float damper)
+	{
+		const float* x = reinterpret_cast<const float*>(points.positions.GetData());
+		const float* v = reinterpret_cast<const float*>(points.velocities.GetData());
+		float* f = reinterpret_cast<float*>(points.forces.GetData());
+		const __m128 k = _mm_set1_ps(stiffness);
+		const __m128 kd = _mm_set1_ps(damper);
+		const __m128 eps = _mm_set1_ps(SMALL_NUMBER);
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		alignas(16) int32 m1[4], m2[4];
+		alignas(16) float fx[4], fy[4], fz[4];
+		int32 i = first;
+		for (; i + 4 <= last; i += 4)
+		{
+			// SSE2 has no gather, load the lanes one by one
+			alignas(16) float d[3][4], dv[3][4], rest[4];
+			for (int32 lane = 0; lane < 4; lane++)
+			{
+				const Spring& s = springs[i + lane];
+				m1[lane] = int32(s.m_m1);
+				m2[lane] = int32(s.m_m2);
+				rest[lane] = s.m_spring_length_init;
+				for (int32 c = 0; c < 3; c++)
+				{
+					d[c][lane] = x[3 * m2[lane] + c] - x[3 * m1[lane] + c];
+					dv[c][lane] = v[3 * m1[lane] + c] - v[3 * m2[lane] + c];
+				}
+			}
+			const __m128 dx = _mm_load_ps(d[0]), dy = _mm_load_ps(d[1]), dz = _mm_load_ps(d[2]);
+			const __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+			// degenerate springs get a zero direction and so no force
+			const __m128 inv = _mm_and_ps(_mm_cmpgt_ps(len, eps), _mm_div_ps(one, len));
+			const __m128 nx = _mm_mul_ps(dx, inv), ny = _mm_mul_ps(dy, inv), nz = _mm_mul_ps(dz, inv);
+			const __m128 vn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(dv[0]), nx), _mm_mul_ps(_mm_load_ps(dv[1]), ny)), _mm_mul_ps(_mm_load_ps(dv[2]), nz));
+			// F = (k (|d| - L) - kd (v1 - v2) . n) n
+			const __m128 scale = _mm_sub_ps(_mm_mul_ps(k, _mm_sub_ps(len, _mm_load_ps(rest))), _mm_mul_ps(kd, vn));
+			_mm_store_ps(fx, _mm_mul_ps(scale, nx));
+			_mm_store_ps(fy, _mm_mul_ps(scale, ny));
+			_mm_store_ps(fz, _mm_mul_ps(scale, nz));
+			scatterForces(f, m1, m2, fx, fy, fz, 4);
+		}
+		springForcesScalar(springs, i, last, points, stiffness, damper);
+	}
+
+	void integrateSSE2(MassPoints& points, int32 first, int32 last, const FVector3f& gravity, float deltaT)
+	{
+		float* x = reinterpret_cast<float*>(points.positions.GetData());
+		float* v = reinterpret_cast<float*>(points.velocities.GetData());
+		float* f = reinterpret_cast<float*>(points.forces.GetData());
+		const float* w = points.invMasses.GetData();
+		const uint8* pinned = points.pinned.GetData();
+
+		// 4 points are 12 floats or 3 vectors, gravity repeats every 3 lanes
+		const __m128 g[3] = {
+			_mm_setr_ps(gravity.X, gravity.Y, gravity.Z, gravity.X),
+			_mm_setr_ps(gravity.Y, gravity.Z, gravity.X, gravity.Y),
+			_mm_setr_ps(gravity.Z, gravity.X, gravity.Y, gravity.Z) };
+		const __m128 h = _mm_set1_ps(deltaT);
+		const __m128 zero = _mm_setzero_ps();
+
+		int32 i = first;
+		for (; i + 4 <= last; i += 4)
+		{
+			const __m128 invMass = _mm_loadu_ps(w + i);
+			const __m128 movable = _mm_setr_ps(float(!pinned[i]), float(!pinned[i + 1]), float(!pinned[i + 2]), float(!pinned[i + 3]));
+			// per point values spread to the x, y, z lanes of the point
+			const __m128 wk[3] = {
+				_mm_shuffle_ps(invMass, invMass, _MM_SHUFFLE(1, 0, 0, 0)),
+				_mm_shuffle_ps(invMass, invMass, _MM_SHUFFLE(2, 2, 1, 1)),
+				_mm_shuffle_ps(invMass, invMass, _MM_SHUFFLE(3, 3, 3, 2)) };
+			const __m128 mk[3] = {
+				_mm_shuffle_ps(movable, movable, _MM_SHUFFLE(1, 0, 0, 0)),
+				_mm_shuffle_ps(movable, movable, _MM_SHUFFLE(2, 2, 1, 1)),
+				_mm_shuffle_ps(movable, movable, _MM_SHUFFLE(3, 3, 3, 2)) };
+			for (int32 c = 0; c < 3; c++)
+			{
+				const int32 j = 3 * i + 4 * c;
+				const __m128 a = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(f + j), wk[c]), _mm_mul_ps(g[c], mk[c]));
+				const __m128 vel = _mm_add_ps(_mm_loadu_ps(v + j), _mm_mul_ps(a, h));
+				_mm_storeu_ps(v + j, vel);
+				_mm_storeu_ps(x + j, _mm_add_ps(_mm_loadu_ps(x + j), _mm_mul_ps(vel, h)));
+				_mm_storeu_ps(f + j, zero);
+			}
+		}
+		integrateScalar(points, i, last, gravity, deltaT);
+	}
+
+	void stencilSpringsSSE2(const float* p, const float* q, int32 stride, int32 count, float rest, float stiffness, float damper, float* f)
+	{
+		const __m128 k = _mm_set1_ps(stiffness);
+		const __m128 kd = _mm_set1_ps(damper);
+		const __m128 length = _mm_set1_ps(rest);
+		const __m128 eps = _mm_set1_ps(SMALL_NUMBER);
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		// the lanes are consecutive springs, no gather needed
+		int32 i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 dx = _mm_sub_ps(_mm_loadu_ps(q + i), _mm_loadu_ps(p + i));
+			const __m128 dy = _mm_sub_ps(_mm_loadu_ps(q + stride + i), _mm_loadu_ps(p + stride + i));
+			const __m128 dz = _mm_sub_ps(_mm_loadu_ps(q + 2 * stride + i), _mm_loadu_ps(p + 2 * stride + i));
+			const __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+			const __m128 inv = _mm_and_ps(_mm_cmpgt_ps(len, eps), _mm_div_ps(one, len));
+			const __m128 nx = _mm_mul_ps(dx, inv), ny = _mm_mul_ps(dy, inv), nz = _mm_mul_ps(dz, inv);
+			const __m128 dvx = _mm_sub_ps(_mm_loadu_ps(p + 3 * stride + i), _mm_loadu_ps(q + 3 * stride + i));
+			const __m128 dvy = _mm_sub_ps(_mm_loadu_ps(p + 4 * stride + i), _mm_loadu_ps(q + 4 * stride + i));
+			const __m128 dvz = _mm_sub_ps(_mm_loadu_ps(p + 5 * stride + i), _mm_loadu_ps(q + 5 * stride + i));
+			const __m128 vn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dvx, nx), _mm_mul_ps(dvy, ny)), _mm_mul_ps(dvz, nz));
+			const __m128 scale = _mm_sub_ps(_mm_mul_ps(k, _mm_sub_ps(len, length)), _mm_mul_ps(kd, vn));
+			_mm_storeu_ps(f + i, _mm_mul_ps(scale, nx));
+			_mm_storeu_ps(f + stride + i, _mm_mul_ps(scale, ny));
+			_mm_storeu_ps(f + 2 * stride + i, _mm_mul_ps(scale, nz));
+		}
+		stencilSpringsScalar(p + i, q + i, stride, count - i, rest, stiffness, damper, f + i);
+	}
+
+	SIMD_TARGET("avx2")
+	void springForcesAVX2(const Spring* springs, int32 first, int32 last, MassPoints& points, float stiffness, float damper)
+	{
+		const float* x = reinterpret_cast<const float*>(points.positions.GetData());
+		const float* v = reinterpret_cast<const float*>(points.velocities.GetData());
+		float* f = reinterpret_cast<float*>(points.forces.GetData());
+		const int32* springInts = reinterpret_cast<const int32*>(springs);
+		const float* springFloats = reinterpret_cast<const float*>(springs);
+		const __m256 k = _mm256_set1_ps(stiffness);
+		const __m256 kd = _mm256_set1_ps(damper);
+		const __m256 eps = _mm256_set1_ps(SMALL_NUMBER);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256i three = _mm256_set1_epi32(3);
+		const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+		alignas(32) int32 m1[8], m2[8];
+		alignas(32) float fx[8], fy[8], fz[8];
+		int32 i = first;
+		for (; i + 8 <= last; i += 8)
+		{
+			// springs are 3 words: m1, m2, rest length
+			const __m256i s3 = _mm256_mullo_epi32(_mm256_add_epi32(_mm256_set1_epi32(i), lanes), three);
+			const __m256i i1 = _mm256_i32gather_epi32(springInts, s3, 4);
+			const __m256i i2 = _mm256_i32gather_epi32(springInts + 1, s3, 4);
+			const __m256 rest = _mm256_i32gather_ps(springFloats + 2, s3, 4);
+			const __m256i p1 = _mm256_mullo_epi32(i1, three);
+			const __m256i p2 = _mm256_mullo_epi32(i2, three);
+
+			const __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(x, p2, 4), _mm256_i32gather_ps(x, p1, 4));
+			const __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(x + 1, p2, 4), _mm256_i32gather_ps(x + 1, p1, 4));
+			const __m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(x + 2, p2, 4), _mm256_i32gather_ps(x + 2, p1, 4));
+			const __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+			// degenerate springs get a zero direction and so no force
+			const __m256 inv = _mm256_and_ps(_mm256_cmp_ps(len, eps, _CMP_GT_OQ), _mm256_div_ps(one, len));
+			const __m256 nx = _mm256_mul_ps(dx, inv), ny = _mm256_mul_ps(dy, inv), nz = _mm256_mul_ps(dz, inv);
+
+			const __m256 dvx = _mm256_sub_ps(_mm256_i32gather_ps(v, p1, 4), _mm256_i32gather_ps(v, p2, 4));
+			const __m256 dvy = _mm256_sub_ps(_mm256_i32gather_ps(v + 1, p1, 4), _mm256_i32gather_ps(v + 1, p2, 4));
+			const __m256 dvz = _mm256_sub_ps(_mm256_i32gather_ps(v + 2, p1, 4), _mm256_i32gather_ps(v + 2, p2, 4));
+			const __m256 vn = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dvx, nx), _mm256_mul_ps(dvy, ny)), _mm256_mul_ps(dvz, nz));
+
+			// F = (k (|d| - L) - kd (v1 - v2) . n) n
+			const __m256 scale = _mm256_sub_ps(_mm256_mul_ps(k, _mm256_sub_ps(len, rest)), _mm256_mul_ps(kd, vn));
+			_mm256_store_ps(fx, _mm256_mul_ps(scale, nx));
+			_mm256_store_ps(fy, _mm256_mul_ps(scale, ny));
+			_mm256_store_ps(fz, _mm256_mul_ps(scale, nz));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(m1), i1);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(m2), i2);
+			scatterForces(f, m1, m2, fx, fy, fz, 8);
+		}
+		springForcesScalar(springs, i, last, points, stiffness, damper);
+	}
+
+	SIMD_TARGET("avx2")
+	void integrateAVX2(MassPoints& points, int32 first, int32 last, const FVector3f& gravity, float deltaT)
+	{
+		float* x = reinterpret_cast<float*>(points.positions.GetData());
+		float* v = reinterpret_cast<float*>(points.velocities.GetData());
+		float* f = reinterpret_cast<float*>(points.forces.GetData());
+		const float* w = points.invMasses.GetData();
+		const uint8* pinned = points.pinned.GetData();
+
+		// 8 points are 24 floats or 3 vectors, lane j of vector c belongs to point (8 c + j) / 3
+		const __m256i expand[3] = {
+			_mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2),
+			_mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5),
+			_mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7) };
+		const __m256 g[3] = {
+			_mm256_setr_ps(gravity.X, gravity.Y, gravity.Z, gravity.X, gravity.Y, gravity.Z, gravity.X, gravity.Y),
+			_mm256_setr_ps(gravity.Z, gravity.X, gravity.Y, gravity.Z, gravity.X, gravity.Y, gravity.Z, gravity.X),
+			_mm256_setr_ps(gravity.Y, gravity.Z, gravity.X, gravity.Y, gravity.Z, gravity.X, gravity.Y, gravity.Z) };
+		const __m256 h = _mm256_set1_ps(deltaT);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 zero = _mm256_setzero_ps();
+
+		int32 i = first;
+		for (; i + 8 <= last; i += 8)
+		{
+			const __m256 invMass = _mm256_loadu_ps(w + i);
+			const __m256i pin = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pinned + i)));
+			const __m256 movable = _mm256_sub_ps(one, _mm256_cvtepi32_ps(pin));
+			for (int32 c = 0; c < 3; c++)
+			{
+				const int32 j = 3 * i + 8 * c;
+				const __m256 wk = _mm256_permutevar8x32_ps(invMass, expand[c]);
+				const __m256 mk = _mm256_permutevar8x32_ps(movable, expand[c]);
+				const __m256 a = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(f + j), wk), _mm256_mul_ps(g[c], mk));
+				const __m256 vel = _mm256_add_ps(_mm256_loadu_ps(v + j), _mm256_mul_ps(a, h));
+				_mm256_storeu_ps(v + j, vel);
+				_mm256_storeu_ps(x + j, _mm256_add_ps(_mm256_loadu_ps(x + j), _mm256_mul_ps(vel, h)));
+				_mm256_storeu_ps(f + j, zero);
+			}
+		}
+		integrateScalar(points, i, last, gravity, deltaT);
+	}
+
+	SIMD_TARGET("avx2")
+	void stencilSpringsAVX2(const float* p, const float* q, int32 stride, int32 count, float rest, float stiffness, float damper, float* f)
+	{
+		const __m256 k = _mm256_set1_ps(stiffness);
+		const __m256 kd = _mm256_set1_ps(damper);
+		const __m256 length = _mm256_set1_ps(rest);
+		const __m256 eps = _mm256_set1_ps(SMALL_NUMBER);
+		const __m256 one = _mm256_set1_ps(1.0f);
+
+		int32 i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(q + i), _mm256_loadu_ps(p + i));
+			const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(q + stride + i), _mm256_loadu_ps(p + stride + i));
+			const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(q + 2 * stride + i), _mm256_loadu_ps(p + 2 * stride + i));
+			const __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+			const __m256 inv = _mm256_and_ps(_mm256_cmp_ps(len, eps, _CMP_GT_OQ), _mm256_div_ps(one, len));
+			const __m256 nx = _mm256_mul_ps(dx, inv), ny = _mm256_mul_ps(dy, inv), nz = _mm256_mul_ps(dz, inv);
+			const __m256 dvx = _mm256_sub_ps(_mm256_loadu_ps(p + 3 * stride + i), _mm256_loadu_ps(q + 3 * stride + i));
+			const __m256 dvy = _mm256_sub_ps(_mm256_loadu_ps(p + 4 * stride + i), _mm256_loadu_ps(q + 4 * stride + i));
+			const __m256 dvz = _mm256_sub_ps(_mm256_loadu_ps(p + 5 * stride + i), _mm256_loadu_ps(q + 5 * stride + i));
+			const __m256 vn = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dvx, nx), _mm256_mul_ps(dvy, ny)), _mm256_mul_ps(dvz, nz));
+			const __m256 scale = _mm256_sub_ps(_mm256_mul_ps(k, _mm256_sub_ps(len, length)), _mm256_mul_ps(kd, vn));
+			_mm256_storeu_ps(f + i, _mm256_mul_ps(scale, nx));
+			_mm256_storeu_ps(f + stride + i, _mm256_mul_ps(scale, ny));
+			_mm256_storeu_ps(f + 2 * stride + i, _mm256_mul_ps(scale, nz));
+		}
+		stencilSpringsScalar(p + i, q + i, stride, count - i, rest, stiffness, damper, f + i);
+	}
+
+	SIMD_TARGET("avx2")
+	void gatherStencilsAVX2(const float* x, const int32* points, const float* weights, const int32* sliceOffsets, int32 first, int32 last, int32 count, float* vertices)
+	{
+		constexpr int32 Slice = SimdKernels::StencilSlice;
+		for (int32 s = first; s < last; s++)
+		{
+			// two vectors of 8 lanes per slice
+			__m256 sums[3][2];
+			for (int32 c = 0; c < 3; c++)
+			{
+				sums[c][0] = _mm256_setzero_ps();
+				sums[c][1] = _mm256_setzero_ps();
+			}
+			for (int32 k = sliceOffsets[s]; k < sliceOffsets[s + 1]; k += Slice)
+			{
+				for (int32 half = 0; half < 2; half++)
+				{
+					const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(points + k + 8 * half));
+					const __m256 w = _mm256_loadu_ps(weights + k + 8 * half);
+					sums[0][half] = _mm256_add_ps(sums[0][half], _mm256_mul_ps(_mm256_i32gather_ps(x, p, 4), w));
+					sums[1][half] = _mm256_add_ps(sums[1][half], _mm256_mul_ps(_mm256_i32gather_ps(x + 1, p, 4), w));
+					sums[2][half] = _mm256_add_ps(sums[2][half], _mm256_mul_ps(_mm256_i32gather_ps(x + 2, p, 4), w));
+				}
+			}
+			alignas(32) float lanes[3][Slice];
+			for (int32 c = 0; c < 3; c++)
+			{
+				_mm256_store_ps(lanes[c], sums[c][0]);
+				_mm256_store_ps(lanes[c] + 8, sums[c][1]);
+			}
+			storeSlice(lanes, count - Slice * s, vertices + 3 * Slice * s);
+		}
+	}
+
+	SIMD_TARGET("avx512f")
+	void springForcesAVX512(const Spring* springs, int32 first, int32 last, MassPoints& points, float stiffness, float damper)
+	{
+		const float* x = reinterpret_cast<const float*>(points.positions.GetData());
+		const float* v = reinterpret_cast<const float*>(points.velocities.GetData());
+		float* f = reinterpret_cast<float*>(points.forces.GetData());
+		const int32* springInts = reinterpret_cast<const int32*>(springs);
+		const float* springFloats = reinterpret_cast<const float*>(springs);
+		const __m512 k = _mm512_set1_ps(stiffness);
+		const __m512 kd = _mm512_set1_ps(damper);
+		const __m512 eps = _mm512_set1_ps(SMALL_NUMBER);
+		const __m512 one = _mm512_set1_ps(1.0f);
+		const __m512i three = _mm512_set1_epi32(3);
+		const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+		int32 i = first;
+		for (; i + 16 <= last; i += 16)
+		{
+			// springs are 3 words: m1, m2, rest length
+			const __m512i s3 = _mm512_mullo_epi32(_mm512_add_epi32(_mm512_set1_epi32(i), lanes), three);
+			const __m512i p1 = _mm512_mullo_epi32(_mm512_i32gather_epi32(s3, springInts, 4), three);
+			const __m512i p2 = _mm512_mullo_epi32(_mm512_i32gather_epi32(s3, springInts + 1, 4), three);
+			const __m512 rest = _mm512_i32gather_ps(s3, springFloats + 2, 4);
+
+			const __m512 dx = _mm512_sub_ps(_mm512_i32gather_ps(p2, x, 4), _mm512_i32gather_ps(p1, x, 4));
+			const __m512 dy = _mm512_sub_ps(_mm512_i32gather_ps(p2, x + 1, 4), _mm512_i32gather_ps(p1, x + 1, 4));
+			const __m512 dz = _mm512_sub_ps(_mm512_i32gather_ps(p2, x + 2, 4), _mm512_i32gather_ps(p1, x + 2, 4));
+			const __m512 len = _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz)));
+			// degenerate springs get a zero direction and so no force
+			const __m512 inv = _mm512_maskz_div_ps(_mm512_cmp_ps_mask(len, eps, _CMP_GT_OQ), one, len);
+			const __m512 nx = _mm512_mul_ps(dx, inv), ny = _mm512_mul_ps(dy, inv), nz = _mm512_mul_ps(dz, inv);
+
+			const __m512 dvx = _mm512_sub_ps(_mm512_i32gather_ps(p1, v, 4), _mm512_i32gather_ps(p2, v, 4));
+			const __m512 dvy = _mm512_sub_ps(_mm512_i32gather_ps(p1, v + 1, 4), _mm512_i32gather_ps(p2, v + 1, 4));
+			const __m512 dvz = _mm512_sub_ps(_mm512_i32gather_ps(p1, v + 2, 4), _mm512_i32gather_ps(p2, v + 2, 4));
+			const __m512 vn = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dvx, nx), _mm512_mul_ps(dvy, ny)), _mm512_mul_ps(dvz, nz));
+
+			// F = (k (|d| - L) - kd (v1 - v2) . n) n
+			const __m512 scale = _mm512_sub_ps(_mm512_mul_ps(k, _mm512_sub_ps(len, rest)), _mm512_mul_ps(kd, vn));
+			const __m512 fx = _mm512_mul_ps(scale, nx), fy = _mm512_mul_ps(scale, ny), fz = _mm512_mul_ps(scale, nz);
+
+			// springs of a range share no mass point, so gather, add and scatter is safe
+			_mm512_i32scatter_ps(f, p1, _mm512_add_ps(_mm512_i32gather_ps(p1, f, 4), fx), 4);
+			_mm512_i32scatter_ps(f + 1, p1, _mm512_add_ps(_mm512_i32gather_ps(p1, f + 1, 4), fy), 4);
+			_mm512_i32scatter_ps(f + 2, p1, _mm512_add_ps(_mm512_i32gather_ps(p1, f + 2, 4), fz), 4);
+			_mm512_i32scatter_ps(f, p2, _mm512_sub_ps(_mm512_i32gather_ps(p2, f, 4), fx), 4);
+			_mm512_i32scatter_ps(f + 1, p2, _mm512_sub_ps(_mm512_i32gather_ps(p2, f + 1, 4), fy), 4);
+			_mm512_i32scatter_ps(f + 2, p2, _mm512_sub_ps(_mm512_i32gather_ps(p2, f + 2, 4), fz), 4);
+		}
+		springForcesScalar(springs, i, last, points, stiffness, damper);
+	}
+
+	SIMD_TARGET("avx512f")
+	void integrateAVX512(MassPoints& points, int32 first, int32 last, const FVector3f& gravity, float deltaT)
+	{
+		float* x = reinterpret_cast<float*>(points.positions.GetData());
+		float* v = reinterpret_cast<float*>(points.velocities.GetData());
+		float* f = reinterpret_cast<float*>(points.forces.GetData());
+		const float* w = points.invMasses.GetData();
+		const uint8* pinned = points.pinned.GetData();
+
+		// 16 points are 48 floats or 3 vectors, lane j of vector c belongs to point (16 c + j) / 3
+		alignas(64) int32 expandLanes[48];
+		alignas(64) float gravityLanes[48];
+		for (int32 j = 0; j < 48; j++)
+		{
+			expandLanes[j] = j / 3;
+			gravityLanes[j] = gravity[j % 3];
+		}
+		__m512i expand[3];
+		__m512 g[3];
+		for (int32 c = 0; c < 3; c++)
+		{
+			expand[c] = _mm512_load_si512(expandLanes + 16 * c);
+			g[c] = _mm512_load_ps(gravityLanes + 16 * c);
+		}
+		const __m512 h = _mm512_set1_ps(deltaT);
+		const __m512 one = _mm512_set1_ps(1.0f);
+		const __m512 zero = _mm512_setzero_ps();
+
+		int32 i = first;
+		for (; i + 16 <= last; i += 16)
+		{
+			const __m512 invMass = _mm512_loadu_ps(w + i);
+			const __m512i pin = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pinned + i)));
+			const __m512 movable = _mm512_sub_ps(one, _mm512_cvtepi32_ps(pin));
+			for (int32 c = 0; c < 3; c++)
+			{
+				const int32 j = 3 * i + 16 * c;
+				const __m512 wk = _mm512_permutexvar_ps(expand[c], invMass);
+				const __m512 mk = _mm512_permutexvar_ps(expand[c], movable);
+				const __m512 a = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(f + j), wk), _mm512_mul_ps(g[c], mk));
+				const __m512 vel = _mm512_add_ps(_mm512_loadu_ps(v + j), _mm512_mul_ps(a, h));
+				_mm512_storeu_ps(v + j, vel);
+				_mm512_storeu_ps(x + j, _mm512_add_ps(_mm512_loadu_ps(x + j), _mm512_mul_ps(vel, h)));
+				_mm512_storeu_ps(f + j, zero);
+			}
+		}
+		integrateScalar(points, i, last, gravity, deltaT);
+	}
+
+	SIMD_TARGET("avx512f")
+	void stencilSpringsAVX512(const float* p, const float* q, int32 stride, int32 count, float rest, float stiffness, float damper, float* f)
+	{
+		const __m512 k = _mm512_set1_ps(stiffness);
+		const __m512 kd = _mm512_set1_ps(damper);
+		const __m512 length = _mm512_set1_ps(rest);
+		const __m512 eps = _mm512_set1_ps(SMALL_NUMBER);
+		const __m512 one = _mm512_set1_ps(1.0f);
+
+		// the last vector is masked, there is no scalar tail
+		for (int32 i = 0; i < count; i += 16)
+		{
+			const __mmask16 m = count - i >= 16 ? __mmask16(0xffff) : __mmask16((1u << (count - i)) - 1);
+			const __m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, q + i), _mm512_maskz_loadu_ps(m, p + i));
+			const __m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, q + stride + i), _mm512_maskz_loadu_ps(m, p + stride + i));
+			const __m512 dz = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, q + 2 * stride + i), _mm512_maskz_loadu_ps(m, p + 2 * stride + i));
+			const __m512 len = _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz)));
+			const __m512 inv = _mm512_maskz_div_ps(_mm512_cmp_ps_mask(len, eps, _CMP_GT_OQ), one, len);
+			const __m512 nx = _mm512_mul_ps(dx, inv), ny = _mm512_mul_ps(dy, inv), nz = _mm512_mul_ps(dz, inv);
+			const __m512 dvx = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, p + 3 * stride + i), _mm512_maskz_loadu_ps(m, q + 3 * stride + i));
+			const __m512 dvy = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, p + 4 * stride + i), _mm512_maskz_loadu_ps(m, q + 4 * stride + i));
+			const __m512 dvz = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, p + 5 * stride + i), _mm512_maskz_loadu_ps(m, q + 5 * stride + i));
+			const __m512 vn = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dvx, nx), _mm512_mul_ps(dvy, ny)), _mm512_mul_ps(dvz, nz));
+			const __m512 scale = _mm512_sub_ps(_mm512_mul_ps(k, _mm512_sub_ps(len, length)), _mm512_mul_ps(kd, vn));
+			_mm512_mask_storeu_ps(f + i, m, _mm512_mul_ps(scale, nx));
+			_mm512_mask_storeu_ps(f + stride + i, m, _mm512_mul_ps(scale, ny));
+			_mm512_mask_storeu_ps(f + 2 * stride + i, m, _mm512_mul_ps(scale, nz));
+		}
+	}
+
+	SIMD_TARGET("avx512f")
+	void gatherStencilsAVX512(const float* x, const int32* points, const float* weights, const int32* sliceOffsets, int32 first, int32 last, int32 count, float* vertices)
+	{
+		constexpr int32 Slice = SimdKernels::StencilSlice;
+		for (int32 s = first; s < last; s++)
+		{
+			__m512 sx = _mm512_setzero_ps(), sy = _mm512_setzero_ps(), sz = _mm512_setzero_ps();
+			for (int32 k = sliceOffsets[s]; k < sliceOffsets[s + 1]; k += Slice)
+			{
+				const __m512i p = _mm512_loadu_si512(points + k);
+				const __m512 w = _mm512_loadu_ps(weights + k);
+				sx = _mm512_add_ps(sx, _mm512_mul_ps(_mm512_i32gather_ps(p, x, 4), w));
+				sy = _mm512_add_ps(sy, _mm512_mul_ps(_mm512_i32gather_ps(p, x + 1, 4), w));
+				sz = _mm512_add_ps(sz, _mm512_mul_ps(_mm512_i32gather_ps(p, x + 2, 4), w));
+			}
+			alignas(64) float lanes[3][Slice];
+			_mm512_store_ps(lanes[0], sx);
+			_mm512_store_ps(lanes[1], sy);
+			_mm512_store_ps(lanes[2], sz);
+			storeSlice(lanes, count - Slice * s, vertices + 3 * Slice * s);
+		}
+	}
+
+	void cpuid(int32 info[4], int32 leaf)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		__cpuidex(info, leaf, 0);
+#else
+		__cpuid_count(leaf, 0, info[0], info[1], info[2], info[3]);
+#endif
+	}
+
+	uint64 xgetbv0()
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		return _xgetbv(0);
+#else
+		uint32 eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (uint64(edx) << 32) | eax;
+#endif
+	}
+
+#endif // PLATFORM_CPU_X86_FAMILY
+}
+
+ESimdLevel
+SimdKernels::detect()
+{
+#if PLATFORM_CPU_X86_FAMILY
+	int32 info[4];
+	cpuid(info, 0);
+	const int32 maxLeaf = info[0];
+
+	cpuid(info, 1);
+	if (!(info[3] & (1 << 26)))
+	{
+		return ESimdLevel::Scalar;
+	}
+
+	// AVX needs the CPU flag and the OS saving the ymm registers (XCR0 bits 1, 2)
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || maxLeaf < 7)
+	{
+		return ESimdLevel::SSE2;
+	}
+	const uint64 xcr0 = xgetbv0();
+	if ((xcr0 & 0x6) != 0x6)
+	{
+		return ESimdLevel::SSE2;
+	}
+
+	cpuid(info, 7);
+	const bool avx2 = (info[1] & (1 << 5)) != 0;
+	const bool avx512f = (info[1] & (1 << 16)) != 0;
+	// AVX-512 also needs the opmask and zmm state (XCR0 bits 5, 6, 7)
+	if (avx512f && (xcr0 & 0xe6) == 0xe6)
+	{
+		return ESimdLevel::AVX512;
+	}
+	return avx2 ? ESimdLevel::AVX2 : ESimdLevel::SSE2;
+#else
+	return ESimdLevel::Scalar;
+#endif
+}
+
+const SimdKernels&
+SimdKernels::get(ESimdLevel level)
+{
+	static const SimdKernels kernels[] = {
+		{ &springForcesScalar, &integrateScalar, &stencilSpringsScalar, &gatherStencilsScalar },
+#if PLATFORM_CPU_X86_FAMILY
+		{ &springForcesSSE2, &integrateSSE2, &stencilSpringsSSE2, &gatherStencilsScalar },
+		{ &springForcesAVX2, &integrateAVX2, &stencilSpringsAVX2, &gatherStencilsAVX2 },
+		{ &springForcesAVX512, &integrateAVX512, &stencilSpringsAVX512, &gatherStencilsAVX512 },
+#endif
+	};
+	static const ESimdLevel best = detect();
+
+	const int32 index = int32(FMath::Min(level, best));
+	return kernels[FMath::Min(index, int32(UE_ARRAY_COUNT(kernels)) - 1)];
+}
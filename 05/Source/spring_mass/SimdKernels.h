@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "MassPoints.h"
+#include "Spring.h"
+
+// instruction sets the kernels are available for, in ascending order
+enum class ESimdLevel : uint8
+{
+	Scalar,
+	SSE2,
+	AVX2,
+	AVX512,
+};
+
+/**
+ * Vectorized inner loops of the explicit solver and the render subdivision,
+ * 4 (SSE2), 8 (AVX2) or 16 (AVX-512) springs, mass points or vertices per
+ * instruction. The instruction set is picked at runtime from the CPU, other
+ * platforms use the scalar loops.
+ */
+struct SPRING_MASS_API SimdKernels
+{
+	// accumulate spring and damper forces of springs [first, last) like Spring::Tick,
+	// no two springs of the range may share a mass point
+	void (*springForces)(const Spring* springs, int32 first, int32 last, MassPoints& points, float stiffness, float damper);
+
+	// symplectic Euler update of mass points [first, last): v += a h, x += v h, F = 0
+	void (*integrate)(MassPoints& points, int32 first, int32 last, const FVector3f& gravity, float deltaT);
+
+	// forces of count springs of one rest length from p[i] to q[i] like Spring::Tick, into f[i].
+	// Structure of arrays with the components stride floats apart: p and q hold the
+	// position x, y, z and velocity x, y, z, f the force x, y, z
+	void (*stencilSprings)(const float* p, const float* q, int32 stride, int32 count, float rest, float stiffness, float damper, float* f);
+
+	// weighted sums of positions, StencilSlice vertices at a time. Vertex StencilSlice * s + j
+	// of slices [first, last) is the sum of x[points[k + j] + c] * weights[k + j] for
+	// k = sliceOffsets[s], sliceOffsets[s] + StencilSlice, ... below sliceOffsets[s + 1];
+	// points are float offsets into x, vertices from count on are not written
+	void (*gatherStencils)(const float* x, const int32* points, const float* weights, const int32* sliceOffsets, int32 first, int32 last, int32 count, float* vertices);
+
+	// vertices per slice of gatherStencils
+	static constexpr int32 StencilSlice = 16;
+
+	// best level supported by this CPU and OS
+	static ESimdLevel detect();
+	// kernels of the given level, clamped to what the CPU supports
+	static const SimdKernels& get(ESimdLevel level);
+};
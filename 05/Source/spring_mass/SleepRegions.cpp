@@ -0,0 +1,541 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SleepRegions.h"
+#include "spring_mass.h"
+#include "SpringMassSystem.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+
+
+// the color groups and the overflow tail, which also covers an uncolored system
+static TArray<int32>
+groupBounds(const TArray<Spring>& springs, const TArray<int32>& colorOffsets)
+{
+	TArray<int32> bounds;
+	for (int32 c = 0; c + 1 < colorOffsets.Num(); c++)
+	{
+		bounds.Add(colorOffsets[c]);
+	}
+	bounds.Add(colorOffsets.Num() > 0 ? colorOffsets.Last() : 0);
+	bounds.Add(springs.Num());
+	return bounds;
+}
+
+static FIntPoint
+regionPair(const Spring& s)
+{
+	const int32 a = s.m_m1 / SleepRegions::RegionSize;
+	const int32 b = s.m_m2 / SleepRegions::RegionSize;
+	return FIntPoint(FMath::Min(a, b), FMath::Max(a, b));
+}
+
+void
+SleepRegions::sortSprings(TArray<Spring>& springs, const TArray<int32>& colorOffsets)
+{
+	const TArray<int32> bounds = groupBounds(springs, colorOffsets);
+
+	// sort each group by region pair and then by first mass point, so the
+	// gather walks the points in order, ties by index to keep the order deterministic
+	TArray<int32> order;
+	order.SetNumUninitialized(springs.Num());
+	for (int32 i = 0; i < springs.Num(); i++)
+	{
+		order[i] = i;
+	}
+	for (int32 g = 0; g + 1 < bounds.Num(); g++)
+	{
+		Algo::Sort(MakeArrayView(order.GetData() + bounds[g], bounds[g + 1] - bounds[g]), [&springs](int32 a, int32 b)
+		{
+			const FIntPoint pa = regionPair(springs[a]);
+			const FIntPoint pb = regionPair(springs[b]);
+			if (pa.X != pb.X)
+			{
+				return pa.X < pb.X;
+			}
+			if (pa.Y != pb.Y)
+			{
+				return pa.Y < pb.Y;
+			}
+			const uint32 firstA = FMath::Min(springs[a].m_m1, springs[a].m_m2);
+			const uint32 firstB = FMath::Min(springs[b].m_m1, springs[b].m_m2);
+			return firstA != firstB ? firstA < firstB : a < b;
+		});
+	}
+	TArray<Spring> sorted;
+	sorted.Reserve(springs.Num());
+	for (int32 i : order)
+	{
+		sorted.Add(springs[i]);
+	}
+	springs = MoveTemp(sorted);
+}
+
+void
+SleepRegions::init(SpringMassSystem& system)
+{
+	const TArray<Spring>& springs = system.getSprings();
+	const TArray<int32> bounds = groupBounds(springs, system.getColorOffsets());
+	const int32 numGroups = bounds.Num() - 1;
+	const MassPoints& points = system.massPoints;
+	const int32 n = points.num();
+	const int32 regions = FMath::DivideAndRoundUp(n, RegionSize);
+
+	// runs of equal region pairs
+	m_segments.Reset();
+	m_segmentOffsets.Reset(numGroups + 1);
+	for (int32 g = 0; g < numGroups; g++)
+	{
+		m_segmentOffsets.Add(m_segments.Num());
+		for (int32 i = bounds[g]; i < bounds[g + 1]; i++)
+		{
+			const FIntPoint pair = regionPair(springs[i]);
+			if (m_segments.Num() > m_segmentOffsets.Last() && m_segments.Last().regionA == pair.X && m_segments.Last().regionB == pair.Y)
+			{
+				m_segments.Last().last = i + 1;
+				continue;
+			}
+			m_segments.Add({ pair.X, pair.Y, i, i + 1 });
+		}
+	}
+	m_segmentOffsets.Add(m_segments.Num());
+	// a stencil spring runs at most to the next row of the next column
+	m_gridReach = springs.Num() == 0 && system.m_grid.isInitialized() ? system.m_grid.numRows() + 1 : 0;
+	buildNeighbours(regions);
+
+	m_regionMass.Init(0.0f, regions);
+	for (int32 i = 0; i < n; i++)
+	{
+		if (points.invMasses[i] > 0.0f)
+		{
+			m_regionMass[i / RegionSize] += 1.0f / points.invMasses[i];
+		}
+	}
+	m_energy.Init(0.0, regions);
+	m_restTime.Init(0.0f, regions);
+	m_moving.Init(0, regions);
+	m_asleep.Init(0, regions);
+	m_numAsleep = 0;
+
+	m_batchesDirty = true;
+	updateBatches(system);
+}
+
+void
+SleepRegions::buildNeighbours(int32 regions)
+{
+	// region adjacency in CSR form, links repeat across color groups
+	TArray<FIntPoint> links;
+	for (const Segment& segment : m_segments)
+	{
+		if (segment.regionA != segment.regionB)
+		{
+			links.Add(FIntPoint(segment.regionA, segment.regionB));
+			links.Add(FIntPoint(segment.regionB, segment.regionA));
+		}
+	}
+	for (int32 r = 0; m_gridReach > 0 && r < regions; r++)
+	{
+		const int32 last = FMath::Min(regions - 1, ((r + 1) * RegionSize - 1 + m_gridReach) / RegionSize);
+		for (int32 q = r + 1; q <= last; q++)
+		{
+			links.Add(FIntPoint(r, q));
+			links.Add(FIntPoint(q, r));
+		}
+	}
+	Algo::Sort(links, [](const FIntPoint& a, const FIntPoint& b)
+	{
+		return a.X != b.X ? a.X < b.X : a.Y < b.Y;
+	});
+	m_neighbourOffsets.Init(0, regions + 1);
+	m_neighbours.Reset();
+	for (int32 i = 0; i < links.Num(); i++)
+	{
+		if (i > 0 && links[i] == links[i - 1])
+		{
+			continue;
+		}
+		m_neighbours.Add(links[i].Y);
+		m_neighbourOffsets[links[i].X + 1]++;
+	}
+	for (int32 r = 0; r < regions; r++)
+	{
+		m_neighbourOffsets[r + 1] += m_neighbourOffsets[r];
+	}
+}
+
+int32
+SleepRegions::findSegment(int32 index) const
+{
+	// the last segment starting at or before index, empty ones may start there too
+	int32 low = 0;
+	int32 high = m_segments.Num();
+	while (high - low > 1)
+	{
+		const int32 middle = (low + high) / 2;
+		if (m_segments[middle].first <= index)
+		{
+			low = middle;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	while (low > 0 && m_segments[low].last <= index)
+	{
+		low--;
+	}
+	return low;
+}
+
+int32
+SleepRegions::groupOf(const SpringMassSystem& system, int32 index) const
+{
+	const TArray<int32>& colorOffsets = system.getColorOffsets();
+	int32 group = 0;
+	while (group + 1 < colorOffsets.Num() && colorOffsets[group + 1] <= index)
+	{
+		group++;
+	}
+	return group;
+}
+
+void
+SleepRegions::removeSpring(SpringMassSystem& system, int32 index)
+{
+	SpringMassTopology& topology = system.editTopology();
+	TArray<Spring>& springs = topology.springs;
+	const int32 first = findSegment(index);
+	const int32 group = groupOf(system, index);
+
+	// the last spring of the segment fills the gap, then every later segment
+	// hands its last spring to the gap in front of it
+	int32 gap = index;
+	for (int32 s = first; s < m_segments.Num(); s++)
+	{
+		Segment& segment = m_segments[s];
+		if (segment.last > segment.first)
+		{
+			springs[gap] = springs[segment.last - 1];
+			gap = segment.last - 1;
+		}
+		if (s > first)
+		{
+			segment.first--;
+		}
+		segment.last--;
+	}
+	springs.Pop();
+
+	for (int32 c = group + 1; c < topology.colorOffsets.Num(); c++)
+	{
+		topology.colorOffsets[c]--;
+	}
+	m_batchesDirty = true;
+}
+
+void
+SleepRegions::addSpring(SpringMassSystem& system, const Spring& spring, int32 group)
+{
+	SpringMassTopology& topology = system.editTopology();
+	TArray<Spring>& springs = topology.springs;
+	const int32 regionA = FMath::Min(spring.m_m1, spring.m_m2) / RegionSize;
+	const int32 regionB = FMath::Max(spring.m_m1, spring.m_m2) / RegionSize;
+
+	// the segment of the region pair, a new one where the sort order puts it
+	int32 target = m_segmentOffsets[group];
+	while (target < m_segmentOffsets[group + 1] && (m_segments[target].regionA < regionA || (m_segments[target].regionA == regionA && m_segments[target].regionB < regionB)))
+	{
+		target++;
+	}
+	if (target == m_segmentOffsets[group + 1] || m_segments[target].regionA != regionA || m_segments[target].regionB != regionB)
+	{
+		const int32 at = target < m_segments.Num() ? m_segments[target].first : springs.Num();
+		m_segments.Insert({ regionA, regionB, at, at }, target);
+		for (int32 g = group + 1; g < m_segmentOffsets.Num(); g++)
+		{
+			m_segmentOffsets[g]++;
+		}
+		buildNeighbours(numRegions());
+	}
+
+	// every later segment moves its first spring past its end, which opens
+	// a gap at the end of the target segment
+	springs.Add(spring);
+	int32 gap = springs.Num() - 1;
+	for (int32 s = m_segments.Num() - 1; s > target; s--)
+	{
+		Segment& segment = m_segments[s];
+		if (segment.last > segment.first)
+		{
+			springs[gap] = springs[segment.first];
+			gap = segment.first;
+		}
+		segment.first++;
+		segment.last++;
+	}
+	springs[gap] = spring;
+	m_segments[target].last++;
+
+	for (int32 c = group + 1; c < topology.colorOffsets.Num(); c++)
+	{
+		topology.colorOffsets[c]++;
+	}
+	m_batchesDirty = true;
+}
+
+void
+SleepRegions::updatePoints(SpringMassSystem& system, IntegratorState& state)
+{
+	const MassPoints& points = system.massPoints;
+	const int32 n = points.num();
+	const int32 regions = FMath::DivideAndRoundUp(n, RegionSize);
+
+	// new points lie in awake regions past the old ones
+	wakeAll(system, state);
+	m_energy.SetNumZeroed(regions);
+	m_restTime.SetNumZeroed(regions);
+	m_moving.SetNumZeroed(regions);
+	m_asleep.SetNumZeroed(regions);
+	buildNeighbours(regions);
+
+	m_regionMass.Init(0.0f, regions);
+	for (int32 i = 0; i < n; i++)
+	{
+		if (points.invMasses[i] > 0.0f)
+		{
+			m_regionMass[i / RegionSize] += 1.0f / points.invMasses[i];
+		}
+	}
+	m_batchesDirty = true;
+}
+
+void
+SleepRegions::update(SpringMassSystem& system, IntegratorState& state, float deltaT)
+{
+	const MassPoints& points = system.massPoints;
+	const int32 n = points.num();
+	const int32 regions = numRegions();
+
+	// kinetic energy of the awake regions
+	auto measure = [this, &points, n](int32 region)
+	{
+		if (m_asleep[region])
+		{
+			return;
+		}
+		double energy = 0.0;
+		const int32 last = FMath::Min(n, (region + 1) * RegionSize);
+		for (int32 i = region * RegionSize; i < last; i++)
+		{
+			if (points.invMasses[i] > 0.0f)
+			{
+				energy += points.velocities[i].SizeSquared() / points.invMasses[i];
+			}
+		}
+		m_energy[region] = 0.5 * energy;
+	};
+	if (system.m_parallel)
+	{
+		ParallelFor(regions, measure);
+	}
+	else
+	{
+		for (int32 r = 0; r < regions; r++)
+		{
+			measure(r);
+		}
+	}
+
+	// compare with the energy of the whole region moving at the thresholds
+	for (int32 r = 0; r < regions; r++)
+	{
+		if (m_asleep[r])
+		{
+			continue;
+		}
+		const double halfMass = 0.5 * m_regionMass[r];
+		m_moving[r] = m_energy[r] > halfMass * m_wakeSpeed * m_wakeSpeed;
+		m_restTime[r] = m_energy[r] <= halfMass * m_sleepSpeed * m_sleepSpeed ? m_restTime[r] + deltaT : 0.0f;
+	}
+
+	// wake the neighbours of moving regions, the forces of the springs between
+	// them were dropped while they slept and are incomplete for this step
+	for (int32 r = 0; r < regions; r++)
+	{
+		if (m_asleep[r] && hasMovingNeighbour(r))
+		{
+			wakeRegion(system, state, r, true);
+		}
+	}
+
+	// freeze regions that rested long enough, unless they would be woken right away
+	for (int32 r = 0; r < regions; r++)
+	{
+		if (!m_asleep[r] && m_restTime[r] >= m_sleepDelay && !hasMovingNeighbour(r))
+		{
+			sleepRegion(system, r);
+		}
+	}
+
+	// springs to awake regions keep adding forces to sleeping points
+	for (int32 r = 0; r < regions; r++)
+	{
+		if (m_asleep[r])
+		{
+			const int32 first = r * RegionSize;
+			FMemory::Memzero(&system.massPoints.forces[first], (FMath::Min(n, first + RegionSize) - first) * sizeof(FVector3f));
+		}
+	}
+}
+
+void
+SleepRegions::wakePoint(SpringMassSystem& system, IntegratorState& state, uint32 id)
+{
+	const int32 region = id / RegionSize;
+	if (m_asleep.IsValidIndex(region) && m_asleep[region])
+	{
+		wakeRegion(system, state, region, false);
+	}
+}
+
+void
+SleepRegions::wakeAll(SpringMassSystem& system, IntegratorState& state)
+{
+	for (int32 r = 0; m_numAsleep > 0 && r < numRegions(); r++)
+	{
+		if (m_asleep[r])
+		{
+			wakeRegion(system, state, r, false);
+		}
+	}
+}
+
+void
+SleepRegions::updateBatches(const SpringMassSystem& system)
+{
+	if (!m_batchesDirty)
+	{
+		return;
+	}
+	m_batchesDirty = false;
+
+	// runs of awake regions, split into batches
+	const int32 n = system.massPoints.num();
+	const int32 regions = numRegions();
+	m_pointBatches.Reset();
+	for (int32 r = 0; r < regions;)
+	{
+		if (m_asleep[r])
+		{
+			r++;
+			continue;
+		}
+		int32 end = r + 1;
+		while (end < regions && !m_asleep[end])
+		{
+			end++;
+		}
+		const int32 last = FMath::Min(n, end * RegionSize);
+		for (int32 first = r * RegionSize; first < last; first += SpringMassSystem::PointBatchSize)
+		{
+			m_pointBatches.Add(FIntPoint(first, FMath::Min(last, first + SpringMassSystem::PointBatchSize)));
+		}
+		r = end;
+	}
+
+	// adjacent segments with an awake end merged into ranges, split into
+	// batches except in the overflow tail, which runs serially anyway
+	const int32 numGroups = m_segmentOffsets.Num() - 1;
+	m_springBatches.Reset();
+	m_groupOffsets.Reset(numGroups + 1);
+	for (int32 g = 0; g < numGroups; g++)
+	{
+		m_groupOffsets.Add(m_springBatches.Num());
+		const bool bTail = g == numGroups - 1;
+		int32 rangeFirst = 0;
+		int32 rangeLast = 0;
+		auto flush = [this, bTail, &rangeFirst, &rangeLast]()
+		{
+			const int32 size = bTail ? rangeLast - rangeFirst : SpringMassSystem::SpringBatchSize;
+			for (int32 first = rangeFirst; first < rangeLast; first += size)
+			{
+				m_springBatches.Add(FIntPoint(first, FMath::Min(rangeLast, first + size)));
+			}
+		};
+		for (int32 s = m_segmentOffsets[g]; s < m_segmentOffsets[g + 1]; s++)
+		{
+			const Segment& segment = m_segments[s];
+			if (m_asleep[segment.regionA] && m_asleep[segment.regionB])
+			{
+				continue;
+			}
+			if (segment.first != rangeLast)
+			{
+				flush();
+				rangeFirst = segment.first;
+			}
+			rangeLast = segment.last;
+		}
+		flush();
+	}
+	m_groupOffsets.Add(m_springBatches.Num());
+}
+
+void
+SleepRegions::wakeRegion(SpringMassSystem& system, IntegratorState& state, int32 region, bool clearForces)
+{
+	MassPoints& points = system.massPoints;
+	const int32 n = points.num();
+	const int32 first = region * RegionSize;
+	const int32 last = FMath::Min(n, first + RegionSize);
+
+	m_asleep[region] = 0;
+	m_restTime[region] = 0.0f;
+	m_numAsleep--;
+	m_batchesDirty = true;
+
+	if (clearForces)
+	{
+		FMemory::Memzero(&points.forces[first], (last - first) * sizeof(FVector3f));
+	}
+
+	// the integrator history of the region is from before it fell asleep, restart it at rest
+	if (state.prevPositions.Num() == n)
+	{
+		FMemory::Memcpy(&state.prevPositions[first], &points.positions[first], (last - first) * sizeof(FVector3f));
+	}
+	if (state.accelerations.Num() == n)
+	{
+		FMemory::Memzero(&state.accelerations[first], (last - first) * sizeof(FVector3f));
+	}
+}
+
+void
+SleepRegions::sleepRegion(SpringMassSystem& system, int32 region)
+{
+	MassPoints& points = system.massPoints;
+	const int32 first = region * RegionSize;
+	const int32 count = FMath::Min(points.num(), first + RegionSize) - first;
+
+	m_asleep[region] = 1;
+	m_moving[region] = 0;
+	m_numAsleep++;
+	m_batchesDirty = true;
+
+	FMemory::Memzero(&points.velocities[first], count * sizeof(FVector3f));
+	FMemory::Memzero(&points.forces[first], count * sizeof(FVector3f));
+}
+
+bool
+SleepRegions::hasMovingNeighbour(int32 region) const
+{
+	for (int32 k = m_neighbourOffsets[region]; k < m_neighbourOffsets[region + 1]; k++)
+	{
+		if (m_moving[m_neighbours[k]])
+		{
+			return true;
+		}
+	}
+	return false;
+}
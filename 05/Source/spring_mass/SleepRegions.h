@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class SpringMassSystem;
+class Spring;
+struct IntegratorState;
+
+/**
+ * Deactivation of resting parts of a spring-mass system.
+ *
+ * Mass points are grouped into regions of RegionSize consecutive indices. A
+ * region falls asleep once its kinetic energy stayed below that of its mass
+ * moving at m_sleepSpeed for m_sleepDelay seconds. Its points are frozen and
+ * springs between two sleeping regions are skipped. It wakes when a force is
+ * added to one of its points or when a region it shares a spring with moves
+ * faster than m_wakeSpeed.
+ *
+ * Within each color group the springs are sorted by the pair of regions they
+ * connect, so the springs to evaluate form a few ranges. The batches of
+ * awake mass points and springs are rebuilt only when a region changes state.
+ *
+ * Springs removed or added while the cloth tears keep the springs dense and
+ * sorted: every later segment moves one spring from its end to its start or
+ * the other way round, which costs one move per segment instead of a sort.
+ */
+class SPRING_MASS_API SleepRegions
+{
+public:
+	// consecutive mass points that sleep and wake together
+	static constexpr int32 RegionSize = 256;
+
+	// let resting regions sleep, only used by the explicit solver
+	bool m_enabled = true;
+	// mass weighted rms speed a region has to stay below to fall asleep
+	float m_sleepSpeed = 0.05f;
+	// rms speed of a neighbour region that wakes a sleeping one
+	float m_wakeSpeed = 0.2f;
+	// seconds a region has to rest before it falls asleep
+	float m_sleepDelay = 1.0f;
+
+	// sort the springs of each color group by region pair, call after they are colored
+	static void sortSprings(TArray<Spring>& springs, const TArray<int32>& colorOffsets);
+
+	// find the runs of springs between two regions and wake all regions, the
+	// springs have to be sorted
+	void init(SpringMassSystem& system);
+
+	// after a step: measure the regions, wake the neighbours of moving ones
+	// and put the ones that rested long enough to sleep
+	void update(SpringMassSystem& system, IntegratorState& state, float deltaT);
+
+	// wake the region of a mass point, e.g. before a force is added to it
+	void wakePoint(SpringMassSystem& system, IntegratorState& state, uint32 id);
+	// wake every region
+	void wakeAll(SpringMassSystem& system, IntegratorState& state);
+
+	// rebuild the batches if regions changed state since the last call
+	void updateBatches(const SpringMassSystem& system);
+
+	// color group of a spring, the overflow tail is the last group
+	int32 groupOf(const SpringMassSystem& system, int32 index) const;
+	// remove a spring, springs before it keep their index
+	void removeSpring(SpringMassSystem& system, int32 index);
+	// add a spring to a color group, none of its springs may share a mass point with it
+	void addSpring(SpringMassSystem& system, const Spring& spring, int32 group);
+	// mass points were appended or their masses changed, wakes every region
+	void updatePoints(SpringMassSystem& system, IntegratorState& state);
+
+	int32 numRegions() const { return m_asleep.Num(); }
+	int32 numAsleep() const { return m_numAsleep; }
+	bool isAsleep(int32 region) const { return m_asleep[region] != 0; }
+
+	// mass point batches [X, Y) of awake regions
+	const TArray<FIntPoint>& getPointBatches() const { return m_pointBatches; }
+	// spring batches [X, Y) with an awake end, group g spans
+	// getSpringBatches()[getGroupOffsets()[g] .. getGroupOffsets()[g + 1]),
+	// the last group holds the springs that did not fit into a color
+	const TArray<FIntPoint>& getSpringBatches() const { return m_springBatches; }
+	const TArray<int32>& getGroupOffsets() const { return m_groupOffsets; }
+
+protected:
+	// springs [first, last) of a group connect regionA and regionB
+	struct Segment
+	{
+		int32 regionA;
+		int32 regionB;
+		int32 first;
+		int32 last;
+	};
+	// segments of group g are m_segments[m_segmentOffsets[g] .. m_segmentOffsets[g + 1])
+	TArray<Segment> m_segments;
+	TArray<int32> m_segmentOffsets;
+
+	// regions sharing a spring with region r are
+	// m_neighbours[m_neighbourOffsets[r] .. m_neighbourOffsets[r + 1])
+	TArray<int32> m_neighbourOffsets;
+	TArray<int32> m_neighbours;
+	// index distance the springs of a lattice without spring list span, 0 otherwise
+	int32 m_gridReach = 0;
+
+	// per region state
+	TArray<float> m_regionMass;
+	TArray<double> m_energy;
+	TArray<float> m_restTime;
+	TArray<uint8> m_moving;
+	TArray<uint8> m_asleep;
+	int32 m_numAsleep = 0;
+
+	bool m_batchesDirty = true;
+	TArray<FIntPoint> m_pointBatches;
+	TArray<FIntPoint> m_springBatches;
+	TArray<int32> m_groupOffsets;
+
+	void wakeRegion(SpringMassSystem& system, IntegratorState& state, int32 region, bool clearForces);
+	void sleepRegion(SpringMassSystem& system, int32 region);
+	bool hasMovingNeighbour(int32 region) const;
+	// region adjacency from the segments and m_gridReach
+	void buildNeighbours(int32 regions);
+	// the segment spring index lies in
+	int32 findSegment(int32 index) const;
+};
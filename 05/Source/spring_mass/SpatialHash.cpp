@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpatialHash.h"
+#include "spring_mass.h"
+#include "Async/ParallelFor.h"
+
+
+void
+SpatialHash::build(const TArray<FVector3f>& positions, float cellSize, bool bParallel)
+{
+	const int32 n = positions.Num();
+	m_cellSize = FMath::Max(cellSize, KINDA_SMALL_NUMBER);
+	m_invCellSize = 1.0f / m_cellSize;
+
+	// about two buckets per point keeps the chains short
+	const uint32 buckets = FMath::RoundUpToPowerOfTwo(FMath::Max(2 * n, 16));
+	m_bucketMask = buckets - 1;
+
+	m_bucketOffsets.SetNumUninitialized(buckets + 1, false);
+	FMemory::Memzero(m_bucketOffsets.GetData(), m_bucketOffsets.Num() * sizeof(int32));
+	m_pointCells.SetNumUninitialized(n, false);
+	m_bucketPoints.SetNumUninitialized(n, false);
+
+	if (!bParallel)
+	{
+		for (int32 i = 0; i < n; i++)
+		{
+			m_pointCells[i] = cellOf(positions[i]);
+			m_bucketOffsets[bucketOf(m_pointCells[i]) + 1]++;
+		}
+		for (uint32 b = 0; b < buckets; b++)
+		{
+			m_bucketOffsets[b + 1] += m_bucketOffsets[b];
+		}
+		m_cursors = m_bucketOffsets;
+		for (int32 i = 0; i < n; i++)
+		{
+			m_bucketPoints[m_cursors[bucketOf(m_pointCells[i])]++] = i;
+		}
+		return;
+	}
+
+	// keys and counts
+	const int32 batches = FMath::DivideAndRoundUp(n, BuildBatchSize);
+	ParallelFor(batches, [this, &positions, n](int32 batch)
+	{
+		const int32 last = FMath::Min(n, (batch + 1) * BuildBatchSize);
+		for (int32 i = batch * BuildBatchSize; i < last; i++)
+		{
+			m_pointCells[i] = cellOf(positions[i]);
+			FPlatformAtomics::InterlockedIncrement(&m_bucketOffsets[bucketOf(m_pointCells[i]) + 1]);
+		}
+	});
+
+	for (uint32 b = 0; b < buckets; b++)
+	{
+		m_bucketOffsets[b + 1] += m_bucketOffsets[b];
+	}
+
+	// scatter, the order within a bucket depends on the thread timing
+	m_cursors = m_bucketOffsets;
+	ParallelFor(batches, [this, n](int32 batch)
+	{
+		const int32 last = FMath::Min(n, (batch + 1) * BuildBatchSize);
+		for (int32 i = batch * BuildBatchSize; i < last; i++)
+		{
+			m_bucketPoints[FPlatformAtomics::InterlockedIncrement(&m_cursors[bucketOf(m_pointCells[i])]) - 1] = i;
+		}
+	});
+
+	// so put it back in index order, buckets hold a handful of points
+	const int32 bucketBatches = FMath::DivideAndRoundUp(int32(buckets), BuildBatchSize);
+	ParallelFor(bucketBatches, [this, buckets](int32 batch)
+	{
+		const uint32 last = FMath::Min(buckets, uint32(batch + 1) * BuildBatchSize);
+		for (uint32 b = batch * BuildBatchSize; b < last; b++)
+		{
+			int32* points = &m_bucketPoints[m_bucketOffsets[b]];
+			const int32 count = m_bucketOffsets[b + 1] - m_bucketOffsets[b];
+			for (int32 k = 1; k < count; k++)
+			{
+				const int32 point = points[k];
+				int32 j = k - 1;
+				for (; j >= 0 && points[j] > point; j--)
+				{
+					points[j + 1] = points[j];
+				}
+				points[j + 1] = point;
+			}
+		}
+	});
+}
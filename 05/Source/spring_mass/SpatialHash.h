@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Uniform grid over a point set, hashed into a fixed number of buckets.
+ *
+ * build sorts the point indices by bucket with a counting sort: bucket keys
+ * and counts are computed in parallel, a prefix sum places the buckets and
+ * the points are scattered with atomic cursors. The arrays keep their
+ * allocations, so rebuilding every step allocates nothing once the point
+ * count settled. Within a bucket the points are in index order, queries give
+ * the same results in the same order with and without threads.
+ *
+ * Different cells can share a bucket, queries skip the points of other cells
+ * so every point is reported at most once.
+ */
+class SPRING_MASS_API SpatialHash
+{
+public:
+	// points handled by one task of the parallel build
+	static constexpr int32 BuildBatchSize = 2048;
+
+	// sort the points into cells of the given edge length
+	void build(const TArray<FVector3f>& positions, float cellSize, bool bParallel);
+
+	float getCellSize() const { return m_cellSize; }
+	// cell of point i when the hash was built
+	const FIntVector& getPointCell(int32 i) const { return m_pointCells[i]; }
+
+	FIntVector cellOf(const FVector3f& p) const
+	{
+		return FIntVector(FMath::FloorToInt(p.X * m_invCellSize), FMath::FloorToInt(p.Y * m_invCellSize), FMath::FloorToInt(p.Z * m_invCellSize));
+	}
+
+	uint32 bucketOf(const FIntVector& cell) const
+	{
+		// Teschner et al., optimized spatial hashing for collision detection of deformable objects
+		return (uint32(cell.X) * 73856093u ^ uint32(cell.Y) * 19349663u ^ uint32(cell.Z) * 83492791u) & m_bucketMask;
+	}
+
+	// run fn(i) for the points in the cells overlapping [lower, upper]
+	template<typename Fn>
+	void forEachPointNear(const FVector3f& lower, const FVector3f& upper, Fn&& fn) const
+	{
+		const FIntVector first = cellOf(lower);
+		const FIntVector last = cellOf(upper);
+		for (int32 x = first.X; x <= last.X; x++)
+		{
+			for (int32 y = first.Y; y <= last.Y; y++)
+			{
+				for (int32 z = first.Z; z <= last.Z; z++)
+				{
+					const FIntVector cell(x, y, z);
+					const uint32 bucket = bucketOf(cell);
+					for (int32 k = m_bucketOffsets[bucket]; k < m_bucketOffsets[bucket + 1]; k++)
+					{
+						if (m_pointCells[m_bucketPoints[k]] == cell)
+						{
+							fn(m_bucketPoints[k]);
+						}
+					}
+				}
+			}
+		}
+	}
+
+protected:
+	float m_cellSize = 1.0f;
+	float m_invCellSize = 1.0f;
+	uint32 m_bucketMask = 0;
+
+	// points of bucket b are m_bucketPoints[m_bucketOffsets[b] .. m_bucketOffsets[b + 1])
+	TArray<int32> m_bucketOffsets;
+	TArray<int32> m_bucketPoints;
+	// cell of every point and the scatter cursors of the buckets
+	TArray<FIntVector> m_pointCells;
+	TArray<int32> m_cursors;
+};
@@ -3,35 +3,34 @@
 #include "Spring.h"
 #include "spring_mass.h"
 
-Spring::Spring(MassPoint* m1, MassPoint* m2, float length) :
-m_m1(m1), m_m2(m2), 
-m_spring_length_init(length),
-m_stiffness(0.1),
-m_damper(0.001)
-{
-}
-
-Spring::~Spring()
+Spring::Spring(uint32 m1, uint32 m2, float length) :
+m_m1(m1), m_m2(m2),
+m_spring_length_init(length)
 {
 }
 
 
 void
-Spring::Tick()
-{	
+Spring::Tick(MassPoints& points, float stiffness, float damper) const
+{
 	//01 Normalize the vector: Dist_m1m2_nor = (m2 - m1) / |m2 - m1|
-	FVector m1m2 = m_m2-> m_currPos - m_m1->m_currPos;
-	float Dist_m1m2 = FVector::Dist(m_m2->m_currPos, m_m1->m_currPos);
-	FVector Dist_m1m2_nor = m1m2 / Dist_m1m2;
+	FVector3f m1m2 = points.positions[m_m2] - points.positions[m_m1];
+	float Dist_m1m2 = m1m2.Size();
+	if (Dist_m1m2 <= SMALL_NUMBER)
+	{
+		return;
+	}
+	FVector3f Dist_m1m2_nor = m1m2 / Dist_m1m2;
 
 	//02 Calculate the spring force：F_s = -k_s * (Dist_m1m2 - L) * Dist_m1m2_nor
-	FVector F_s = m_stiffness * (Dist_m1m2 - m_spring_length_init) * Dist_m1m2_nor;
+	FVector3f F_s = stiffness * (Dist_m1m2 - m_spring_length_init) * Dist_m1m2_nor;
 
 	//03 Calculate the dramper force: F_d = -k_d * (dotProduct((v1 - v2),Dist_m1m2_nor)) * Dist_m1m2_nor
-	FVector Vel = m_m1->m_velocity - m_m2->m_velocity;
-	FVector F_d = -m_damper * (FVector::DotProduct( Vel, Dist_m1m2_nor)) * Dist_m1m2_nor;
-
-	//04 Calculate the total force: F = F_s + F_d
-	FVector F_toltal = F_s + F_d;
+	FVector3f Vel = points.velocities[m_m1] - points.velocities[m_m2];
+	FVector3f F_d = -damper * (FVector3f::DotProduct( Vel, Dist_m1m2_nor)) * Dist_m1m2_nor;
 
+	//04 Calculate the total force: F = F_s + F_d, pulling m1 towards m2 and vice versa
+	FVector3f F_toltal = F_s + F_d;
+	points.forces[m_m1] += F_toltal;
+	points.forces[m_m2] -= F_toltal;
 }
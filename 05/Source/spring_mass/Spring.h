@@ -2,26 +2,22 @@
 
 #pragma once
 
-#include "MassPoint.h"
+#include "MassPoints.h"
 
 /**
- * 
+ * Spring between two mass points, referenced by their index in MassPoints.
  */
 class SPRING_MASS_API Spring
 {
-protected:
+public:
 	// mass points connected by spring
-	MassPoint *m_m1;
-	MassPoint *m_m2;
+	uint32 m_m1;
+	uint32 m_m2;
 
 	// length of the springs
 	float m_spring_length_init;
 
-	float m_stiffness;
-	float m_damper;
-
-public:
-	Spring(MassPoint* m1, MassPoint* m2, float length);
-	~Spring();
-	void Tick();
+	Spring(uint32 m1, uint32 m2, float length);
+	// accumulate spring and damper force on both mass points
+	void Tick(MassPoints& points, float stiffness, float damper) const;
 };
@@ -2,10 +2,18 @@
 
 #include "SpringMassActor.h"
 #include "spring_mass.h"
+#include "SpringMassSubsystem.h"
+#include "SpringMassStats.h"
+#include "RestState.h"
+#include "Components/CapsuleComponent.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 
 
 // Sets default values
-ASpringMassActor::ASpringMassActor() : m_deltaTimeRemaining(0.0f)
+ASpringMassActor::ASpringMassActor()
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
@@ -15,7 +23,7 @@ ASpringMassActor::ASpringMassActor() : m_deltaTimeRemaining(0.0f)
 	RootComponent = SphereComponent;
 
 	// mesh for visualization
-	mesh = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("GeneratedMesh"));
+	mesh = CreateDefaultSubobject<USpringMassMeshComponent>(TEXT("GeneratedMesh"));
 
 	// create mesh and spring system
 	initSpringSystem();
@@ -23,131 +31,387 @@ ASpringMassActor::ASpringMassActor() : m_deltaTimeRemaining(0.0f)
 	mesh->SetupAttachment(RootComponent);
 }
 
+void ASpringMassActor::OnConstruction(const FTransform& Transform)
+{
+	Super::OnConstruction(Transform);
+
+	// the network or the rest state may have been rebuilt, so always reload them
+	if (SpringNetwork || builtNetwork || !RestStateFile.FilePath.IsEmpty() || SubdivisionLevels != builtSubdivisionLevels) {
+		initSpringSystem();
+	}
+}
+
 // Called when the game starts or when spawned
 void ASpringMassActor::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// loaded actors were constructed before their properties
+	if (SpringNetwork != builtNetwork || RestStateFile.FilePath != builtRestState || SubdivisionLevels != builtSubdivisionLevels) {
+		initSpringSystem();
+	}
+
+	// simulated together with the other spring-mass actors of the world
+	if (USpringMassSubsystem* subsystem = GetWorld()->GetSubsystem<USpringMassSubsystem>()) {
+		subsystem->registerActor(this);
+		SetActorTickEnabled(false);
+	}
 }
 
-// Called every frame
+void ASpringMassActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	asyncSimulation.stop();
+
+	if (USpringMassSubsystem* subsystem = GetWorld()->GetSubsystem<USpringMassSubsystem>()) {
+		subsystem->unregisterActor(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called every frame, unless the subsystem simulates this actor
 void ASpringMassActor::Tick( float DeltaTime )
 {
 	Super::Tick( DeltaTime );
 
-	// use a fixed timestep
-	float step = 1 / 200.0f;
-	// time we did not simulate from last step
-	DeltaTime += m_deltaTimeRemaining;
-	while (DeltaTime >= step) {
-		DeltaTime -= step;
+	updateLod(DeltaTime);
+	applySimulationSettings(true);
+	updateColliders();
+	simulate(DeltaTime);
+	updateMesh();
+}
+
+SpringMassSettings ASpringMassActor::makeSimulationSettings(bool bAllowParallel) const
+{
+	SpringMassSettings settings;
+	settings.parallel = bParallelSimulation && bAllowParallel;
+	settings.simdLevel = bVectorizedKernels ? ESimdLevel::AVX512 : ESimdLevel::Scalar;
+	settings.solver = Solver;
+	settings.integrator = Integrator;
+	settings.xpbdIterations = XPBDIterations;
+	settings.strainLimiting = bStrainLimiting;
+	settings.maxStrain = MaxStrain;
+	settings.sleeping = bAllowSleeping;
+	settings.sleepSpeed = SleepSpeed;
+	settings.wakeSpeed = 4.0f * SleepSpeed;
+	settings.collisionThickness = CollisionThickness;
+	settings.collisionFriction = CollisionFriction;
+	settings.selfCollision = bSelfCollision;
+	settings.selfCollisionThickness = SelfCollisionThickness;
+	// the async thread and the subdivision keep the number of mass points fixed
+	settings.tearing = bTearing && !bAsyncSimulation && !subdivision.IsValid();
+	settings.tearStrain = TearStrain;
+	return settings;
+}
+
+void ASpringMassActor::applySimulationSettings(bool bAllowParallel)
+{
+	SpringMassSettings settings = makeSimulationSettings(bAllowParallel);
+
+	// the step rate is fixed while the thread runs, restart it to change it
+	if (asyncSimulation.isRunning() && (!bAsyncSimulation || AsyncStepRate != asyncStepRate || MaxTimeStep != asyncMaxStep)) {
+		asyncSimulation.stop();
+	}
+
+	if (!bAsyncSimulation) {
+		springSystem.applySettings(settings);
+		lod.applySettings(settings);
+	}
+	else if (!asyncSimulation.isRunning()) {
+		asyncSimulation.start(settings, AsyncStepRate, MaxTimeStep);
+		asyncSettings = settings;
+		asyncStepRate = AsyncStepRate;
+		asyncMaxStep = MaxTimeStep;
+	}
+	else if (settings != asyncSettings) {
+		// only send changes, the queue allocates per command
+		asyncSimulation.applySettings(settings);
+		asyncSettings = settings;
+	}
+
+	scheduler.m_maxSubsteps = MaxSubstepsPerFrame;
+	scheduler.m_budget = SimulationBudgetMs * 0.001f;
+}
+
+void ASpringMassActor::updateColliders()
+{
+	// the simulation runs in the space of the mesh, radii assume uniform scale
+	const FTransform& toWorld = mesh->GetComponentTransform();
+	const float invScale = 1.0f / toWorld.GetMaximumAxisScale();
+	colliders.reset();
 
-		// calculate force between mass points
-		for (Spring& s : springs){
-			s.Tick();
+	for (AActor* actor : ColliderActors) {
+		if (!actor) {
+			continue;
 		}
+		actor->ForEachComponent<USphereComponent>(false, [&](const USphereComponent* sphere) {
+			FVector3f center(toWorld.InverseTransformPosition(sphere->GetComponentLocation()));
+			colliders.spheres.Add({ center, sphere->GetScaledSphereRadius() * invScale });
+		});
+		actor->ForEachComponent<UCapsuleComponent>(false, [&](const UCapsuleComponent* capsule) {
+			FVector axis = capsule->GetUpVector() * capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+			FVector3f a(toWorld.InverseTransformPosition(capsule->GetComponentLocation() - axis));
+			FVector3f b(toWorld.InverseTransformPosition(capsule->GetComponentLocation() + axis));
+			colliders.capsules.Add({ a, b, capsule->GetScaledCapsuleRadius() * invScale });
+		});
+	}
 
-		// update positions
-		for (MassPoint& m : massPoints) {
-			// add gravity
-			m.updateGravity();
-			m.updateCurPos(step);
+	for (const FPlane& plane : CollisionPlanes) {
+		FVector origin(toWorld.InverseTransformPosition(plane.GetNormal() * plane.W));
+		FVector normal(toWorld.InverseTransformVectorNoScale(plane.GetNormal()));
+		colliders.planes.Add(FPlane4f(FVector3f(origin), FVector3f(normal)));
+	}
+
+	if (asyncSimulation.isRunning()) {
+		asyncSimulation.setColliders(colliders);
+	}
+	else {
+		activeSystem().m_collision.m_colliders = colliders;
+	}
+}
+
+void ASpringMassActor::updateLod(float DeltaTime)
+{
+	ESpringMassLod target = ESpringMassLod::Full;
+	hiddenTime = mesh->WasRecentlyRendered(0.1f) ? 0.0f : hiddenTime + DeltaTime;
+
+	// the async simulation always runs the full lattice, and so does tearing
+	// cloth: the coarse lattice cannot follow its cuts
+	APlayerController* player = GetWorld() ? GetWorld()->GetFirstPlayerController() : nullptr;
+	if (bEnableLod && !bAsyncSimulation && !bTearing && lod.isInitialized() && player && player->PlayerCameraManager) {
+		const FVector view = player->PlayerCameraManager->GetCameraLocation();
+		const float tanHalfFov = FMath::Tan(FMath::DegreesToRadians(0.5f * player->PlayerCameraManager->GetFOVAngle()));
+
+		// bounds diameter over screen height, as the engine measures screen size
+		const double distance = FMath::Max(1.0, FVector::Dist(view, mesh->Bounds.Origin));
+		const float screenSize = float(mesh->Bounds.SphereRadius / (distance * tanHalfFov));
+
+		// a margin on the way back keeps it from flickering at the threshold
+		const float threshold = simulatedLod == ESpringMassLod::Coarse ? 1.2f * CoarseScreenSize : CoarseScreenSize;
+		if (hiddenTime > FreezeDelay) {
+			target = ESpringMassLod::Frozen;
+		}
+		else if (screenSize < threshold) {
+			target = ESpringMassLod::Coarse;
 		}
 	}
-	// save remaining time for next tick
-	m_deltaTimeRemaining = DeltaTime;
 
-	// update vertices in mesh
-	for (MassPoint& m : massPoints) {
-		vertices[m.getVertexId()] = m.getCurrPos();
+	// a frozen cloth keeps its level and continues where it stopped
+	bLodFrozen = target == ESpringMassLod::Frozen;
+	if (bLodFrozen || target == simulatedLod) {
+		return;
+	}
+	if (target == ESpringMassLod::Coarse) {
+		lod.beginCoarse(springSystem, LodBlendTime);
 	}
-	mesh->UpdateMeshSection(1, vertices, TArray<FVector>(), TArray<FVector2D>(), TArray<FColor>(), TArray<FProcMeshTangent>());
+	else {
+		lod.endCoarse(springSystem);
+	}
+	simulatedLod = target;
 }
 
-void ASpringMassActor::initSpringSystem()
+void ASpringMassActor::simulate(float DeltaTime)
 {
-	TArray<int32> Triangles;
+	if (asyncSimulation.isRunning() || bLodFrozen) {
+		return;
+	}
 
-	// Set up vertices and mass points
-	for (uint16 x = 0; x < cols; x++) {
-		for (uint16 z = 0; z < rows; z++) {
-			auto v = FVector(size * x, 0, size * z);
-			vertices.Add(v);
+	SCOPE_CYCLE_COUNTER(STAT_SpringMassSimulate);
+	TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassSimulate);
+	SpringMassSystem& system = activeSystem();
+	if (simulatedLod == ESpringMassLod::Coarse) {
+		lod.advanceBlend(DeltaTime);
+	}
 
-			// mass points
-			uint32 id = x * rows + z;
-			// upper row ist fixed
-			bool movable = z != rows - 1;
-			// only corners
-			//bool movable = z != rows - 1 || (x != 0 && x != cols - 1);
-			massPoints.Add(MassPoint(id, movable, v));
+	double start = FPlatformTime::Seconds();
+	int32 substeps = 1;
+	if (Solver != ESpringMassSolver::Explicit) {
+		// stable for large steps, one step per frame is enough
+		// but don't let a hitch turn into one huge overdamped step
+		float maxStep = 1 / 30.0f;
+		float step = scheduler.beginFrameSingleStep(DeltaTime, maxStep);
+		substeps = step > 0.0f ? 1 : 0;
+		if (step > 0.0f) {
+			system.step(step);
+		}
+	}
+	else {
+		// use a fixed timestep, as large as the springs allow
+		float maxStep = simulatedLod == ESpringMassLod::Coarse ? CoarseStepScale * MaxTimeStep : MaxTimeStep;
+		float step = FMath::Min(maxStep, system.estimateStableStep());
+		substeps = scheduler.beginFrame(DeltaTime, step);
+		for (int32 i = 0; i < substeps; i++) {
+			// calculate force between mass points and update positions
+			system.step(step);
 		}
 	}
+	scheduler.endFrame(FPlatformTime::Seconds() - start, substeps);
+
+	INC_DWORD_STAT_BY(STAT_SpringMassSubsteps, substeps);
+	INC_DWORD_STAT_BY(STAT_SpringMassPoints, system.massPoints.num());
+	INC_DWORD_STAT_BY(STAT_SpringMassSprings, system.numSprings());
+	INC_FLOAT_STAT_BY(STAT_SpringMassCarriedTime, scheduler.getRemaining() * 1000.0f);
+	INC_FLOAT_STAT_BY(STAT_SpringMassDroppedTime, scheduler.getDroppedLastFrame() * 1000.0f);
+}
+
+void ASpringMassActor::sendPositions(const TArray<FVector3f>& positions)
+{
+	if (subdivision.IsValid()) {
+		SCOPE_CYCLE_COUNTER(STAT_SpringMassSubdivision);
+		TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassSubdivision);
+		subdivision->evaluate(positions, subdividedPositions, SimdKernels::get(bVectorizedKernels ? ESimdLevel::AVX512 : ESimdLevel::Scalar), bParallelSimulation);
+		mesh->updatePositions(subdividedPositions);
+	}
+	else {
+		mesh->updatePositions(positions);
+	}
+}
 
-	// Set up indices
-	for (uint16 x = 0; x < cols-1; x++)
-	{
-		for (uint16 z = 0; z < rows-1; z++)
-		{
-			// quad: tri 1
-			uint32 offset = x * rows + z;
-			Triangles.Add(offset + 0);
-			Triangles.Add(offset + 1);
-			Triangles.Add(offset + rows);
-			// tri 2
-			Triangles.Add(offset + 1);
-			Triangles.Add(offset + rows+1);
-			Triangles.Add(offset + rows);
+void ASpringMassActor::updateMesh()
+{
+	// update vertices in mesh, only the blocks that moved are uploaded
+	if (asyncSimulation.isRunning()) {
+		if (asyncSimulation.interpolate(interpolatedPositions)) {
+			sendPositions(interpolatedPositions);
 		}
 	}
+	else if (bLodFrozen) {
+		return;
+	}
+	else if (simulatedLod == ESpringMassLod::Coarse) {
+		lod.interpolate(interpolatedPositions);
+		sendPositions(interpolatedPositions);
+	}
+	else {
+		// vertices split since the last frame, before their positions are sent
+		ClothTearing& tearing = springSystem.m_tearing;
+		if (tearing.hasChanges()) {
+			mesh->splitVertices(springSystem.massPoints.positions, tearing.getIndices(), tearing.getNewPointSources(), tearing.getChangedTriangles());
+			tearing.clearChanges();
+			// the coarse lattice no longer matches the torn cloth
+			lod.reset();
+		}
+		sendPositions(springSystem.massPoints.positions);
+	}
+}
 
-	// add springs for each vertice v
-	//  nw  n  ne
-	//      | / 
-	//  w   v - e
-	//        \
-	// sw   s  se
-	for (uint16 x = 0; x < cols; x++)
-	{
-		for (uint16 z = 0; z < rows; z++)
-		{
-			// current vertice
-			uint32 id = x * rows + z;
-			FVector v = vertices[id];
-			// we are not at the east edge
-			if (x < cols - 1) {
-				uint32 id_e = (x + 1) * rows + z;
-				FVector v_e = vertices[id_e];
-				springs.Add(Spring(&massPoints[id], &massPoints[id_e], FVector::Dist(v, v_e)));
-				// we are not in the south east corner -> add spring
-				if (z > 0) {
-					uint32 id_se = (x + 1) * rows + (z - 1);
-					FVector v_se = vertices[id_se];
-					springs.Add(Spring(&massPoints[id], &massPoints[id_se], FVector::Dist(v, v_se)));
-				}
-				// we are not in the north east corner -> add spring
-				if (z < rows - 1) {
-					uint32 id_ne = (x + 1) * rows + (z + 1);
-					FVector v_ne = vertices[id_ne];
-					springs.Add(Spring(&massPoints[id], &massPoints[id_ne], FVector::Dist(v, v_ne)));
-				}
-			}
+void ASpringMassActor::initSpringSystem(bool bRestState)
+{
+	simulatedLod = ESpringMassLod::Full;
+	bLodFrozen = false;
+	builtNetwork = SpringNetwork && SpringNetwork->isBuilt() ? SpringNetwork : nullptr;
 
-			// we are not at the north edge
-			if (z < rows - 1){
-				uint32 id_n = x * rows + (z + 1);
-				FVector v_n = vertices[id_n];
-				springs.Add(Spring(&massPoints[id], &massPoints[id_n], FVector::Dist(v, v_n)));
+	// springs and triangles are shared with the other actors of the same shape,
+	// the lattice evaluates its springs from the stencil
+	if (builtNetwork) {
+		springSystem.setTopology(builtNetwork->getTopology());
+
+		// push the mass point closest to the center
+		const TArray<FVector3f>& positions = springSystem.massPoints.positions;
+		const FVector3f center = FBox3f(positions).GetCenter();
+		float closest = MAX_flt;
+		for (int32 i = 0; i < positions.Num(); i++) {
+			float distance = FVector3f::DistSquared(positions[i], center);
+			if (distance < closest) {
+				closest = distance;
+				touchPoint = i;
 			}
 		}
 	}
-	
-	// instanciate mesh
-	mesh->CreateMeshSection(1, vertices, Triangles, TArray<FVector>(), TArray<FVector2D>(), TArray<FColor>(), TArray<FProcMeshTangent>(), false);
+	else {
+		springSystem.setLattice(rows, cols, size);
+		touchPoint = (cols / 2) * rows + (rows / 2);
+	}
+	SpringMassTopologyRef topology = springSystem.getSharedTopology();
+
+	if (builtNetwork) {
+		lod.reset();
+	}
+	else {
+		lod.init(springSystem, rows, cols, size, LodStride);
+	}
+
+	// start at rest, after the coarse level took the rest shape
+	builtRestState = RestStateFile.FilePath;
+	if (bRestState && !builtRestState.IsEmpty()) {
+		loadRestState();
+	}
+
+	// instanciate mesh, the subdivided surface or the mass points with room for the vertices tearing splits off
+	builtSubdivisionLevels = SubdivisionLevels;
+	if (SubdivisionLevels > 0 && !bTearing) {
+		subdivision = MeshSubdivision::get(topology, SubdivisionLevels);
+		subdivision->evaluate(springSystem.massPoints.positions, subdividedPositions, SimdKernels::get(bVectorizedKernels ? ESimdLevel::AVX512 : ESimdLevel::Scalar), bParallelSimulation);
+		mesh->setTopology(subdividedPositions, subdivision->getIndices(), subdivision->getUVs());
+	}
+	else {
+		subdivision.Reset();
+		const int32 spareVertices = bTearing ? springSystem.massPoints.num() / 8 : 0;
+		mesh->setTopology(springSystem.massPoints.positions, topology->indices, topology->uvs, spareVertices);
+	}
+}
+
+bool ASpringMassActor::loadRestState()
+{
+	const FString path = FPaths::ProjectContentDir() / RestStateFile.FilePath;
+
+	// mapped where the platform can, the settled state is copied straight from the file pages
+	IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TUniquePtr<IMappedFileHandle> handle(platformFile.OpenMapped(*path));
+	TUniquePtr<IMappedFileRegion> region(handle ? handle->MapRegion() : nullptr);
+	if (region) {
+		return RestStateCache::read(springSystem, MakeArrayView(region->GetMappedPtr(), int32(region->GetMappedSize())));
+	}
+
+	TArray<uint8> cache;
+	return FFileHelper::LoadFileToArray(cache, *path, FILEREAD_Silent) && RestStateCache::read(springSystem, MakeArrayView(cache.GetData(), cache.Num()));
+}
+
+void ASpringMassActor::BakeRestState()
+{
+	asyncSimulation.stop();
+	const FString file = RestStateFile.FilePath.IsEmpty() ? FString::Printf(TEXT("SpringMass/%s.smrest"), *GetName()) : RestStateFile.FilePath;
+
+	// from the rest shape, with the colliders where they are now
+	initSpringSystem(false);
+	springSystem.applySettings(makeSimulationSettings(true));
+	updateColliders();
+
+	// a failed bake keeps the file there is and goes back to it
+	RestStateBaker baker;
+	baker.m_maxStep = MaxTimeStep;
+	TArray<uint8> cache;
+	if (!baker.bake(springSystem, cache)) {
+		UE_LOG(LogSpringMass, Warning, TEXT("%s: the cloth did not come to rest within %.0f simulated seconds, %s was not baked"), *GetName(), baker.m_maxTime, *file);
+		initSpringSystem();
+		return;
+	}
+	if (!FFileHelper::SaveArrayToFile(cache, *(FPaths::ProjectContentDir() / file))) {
+		UE_LOG(LogSpringMass, Error, TEXT("%s: could not write the rest state to %s"), *GetName(), *file);
+		initSpringSystem();
+		return;
+	}
+
+	if (RestStateFile.FilePath != file) {
+		Modify();
+		RestStateFile.FilePath = file;
+	}
+	builtRestState = file;
+	sendPositions(springSystem.massPoints.positions);
 }
 
 void ASpringMassActor::Touch()
 {
 	// add force to the center
-	uint32 id = (cols / 2) * rows + (rows / 2);
-	massPoints[id].addForce(FVector(0, 20, 0));
+	uint32 id = touchPoint;
+	FVector3f force(0, 20, 0);
+	if (asyncSimulation.isRunning()) {
+		asyncSimulation.addForce(id, force);
+	}
+	else if (simulatedLod == ESpringMassLod::Coarse) {
+		lod.getCoarse().addForce(lod.coarsePointOf(id), force);
+	}
+	else {
+		springSystem.addForce(id, force);
+	}
 }
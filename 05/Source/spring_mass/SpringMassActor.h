@@ -2,10 +2,14 @@
 
 #pragma once
 
-#include "MassPoint.h"
-#include "Spring.h"
+#include "SpringMassSystem.h"
+#include "SubstepScheduler.h"
+#include "AsyncSimulation.h"
+#include "SpringMassLod.h"
+#include "SpringMassMeshComponent.h"
+#include "MeshSubdivision.h"
+#include "SpringNetworkAsset.h"
 
-#include "ProceduralMeshComponent.h"
 #include "GameFramework/Actor.h"
 #include "SpringMassActor.generated.h"
 
@@ -14,18 +18,53 @@ class SPRING_MASS_API ASpringMassActor : public AActor
 {
 	GENERATED_BODY()
 
-	// vertex data for visualization
-	TArray<FVector> vertices;
-
 	// mass-spring system data
-	TArray<MassPoint> massPoints;
-	TArray<Spring> springs;
+	SpringMassSystem springSystem;
+
+	// create mesh and mass-spring system, from SpringNetwork if it is built,
+	// in the state of RestStateFile if bRestState and it fits
+	void initSpringSystem(bool bRestState = true);
+	// network the system was last built from, only compared
+	const USpringNetworkAsset* builtNetwork = nullptr;
+	// mass point Touch pushes
+	uint32 touchPoint = 0;
+	// start from the settled state in RestStateFile, false if there is none for this system
+	bool loadRestState();
+	// RestStateFile the system was last built with, only compared
+	FString builtRestState;
+
+	// substeps per frame, carries the time not simulated in last tick
+	SubstepScheduler scheduler;
+
+	// simulation on its own thread, owns springSystem while running
+	AsyncSimulation asyncSimulation{ springSystem };
+	// what the running thread was started or last updated with
+	SpringMassSettings asyncSettings;
+	float asyncStepRate = 0;
+	float asyncMaxStep = 0;
+	// interpolated positions of the async simulation
+	TArray<FVector3f> interpolatedPositions;
+
+	// smooth surface rendered over the mass points, if SubdivisionLevels
+	TSharedPtr<const MeshSubdivision, ESPMode::ThreadSafe> subdivision;
+	TArray<FVector3f> subdividedPositions;
+	// SubdivisionLevels the mesh was last built with, only compared
+	int32 builtSubdivisionLevels = 0;
+	// hand positions of the mass points to the mesh, subdivided if it is
+	void sendPositions(const TArray<FVector3f>& positions);
+
+	// colliders gathered in the space of the mesh this frame
+	SpringMassColliders colliders;
 
-	// create mesh and mass-spring system
-	void initSpringSystem();
+	// coarse lattice for distant cloth, the level simulated and whether it is paused
+	SpringMassLod lod;
+	ESpringMassLod simulatedLod = ESpringMassLod::Full;
+	bool bLodFrozen = false;
+	// seconds the mesh was not rendered
+	float hiddenTime = 0;
 
-	// time not simulated in last tick, used for fixed delta time updates
-	float m_deltaTimeRemaining;
+	// the system currently simulated, fine or coarse
+	SpringMassSystem& activeSystem() { return simulatedLod == ESpringMassLod::Coarse ? lod.getCoarse() : springSystem; }
 
 	// shape of the mesh
 	uint16 rows = 20;
@@ -33,18 +72,188 @@ class SPRING_MASS_API ASpringMassActor : public AActor
 	float size = 10;
 
 public:	
+	// rows and columns of the lattice kept by the coarse level
+	static constexpr int32 LodStride = 2;
+	// the coarse level takes substeps this many times longer
+	static constexpr float CoarseStepScale = 2.0f;
+
 	// Sets default values for this actor's properties
 	ASpringMassActor();
 
+	// Called when the actor is placed, spawned or its properties change in the editor
+	virtual void OnConstruction(const FTransform& Transform) override;
+
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+
+	// Called when the actor leaves the game
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	// Called every frame
 	virtual void Tick( float DeltaSeconds ) override;
 
+	// the simulation properties, inner parallelism only if bAllowParallel
+	SpringMassSettings makeSimulationSettings(bool bAllowParallel) const;
+
+	// copy the simulation properties onto the spring system and the scheduler,
+	// inner parallelism only if bAllowParallel
+	void applySimulationSettings(bool bAllowParallel);
+
+	// pick the simulation level from visibility and screen size seen from the
+	// player camera, which follows the HMD, game thread only
+	void updateLod(float DeltaTime);
+
+	// gather the shapes of ColliderActors and the CollisionPlanes for the
+	// simulation, game thread only
+	void updateColliders();
+
+	// run the substeps of one frame. Touches only this actor's simulation
+	// data, so the subsystem advances several actors at once. Does nothing
+	// while the simulation runs on its own thread.
+	void simulate(float DeltaTime);
+
+	// send the simulated positions to the mesh, game thread only
+	void updateMesh();
+
+	// mass points of the simulation at its current level
+	int32 getNumMassPoints() const { return simulatedLod == ESpringMassLod::Coarse ? lod.getCoarse().massPoints.num() : springSystem.massPoints.num(); }
+
 	// Export mesh so we can apply a material in the editor
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	UProceduralMeshComponent* mesh;
+	USpringMassMeshComponent* mesh;
+
+	// Spring network built from a mesh, the generated lattice if none
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Main")
+	USpringNetworkAsset* SpringNetwork = nullptr;
+
+	// Evaluate springs and integrate mass points on worker threads
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	bool bParallelSimulation = true;
+
+	// Use the SSE/AVX2/AVX-512 spring and integration kernels the CPU supports
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	bool bVectorizedKernels = true;
+
+	// Time integration scheme, the implicit and XPBD solvers take one step per frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	ESpringMassSolver Solver = ESpringMassSolver::Explicit;
+
+	// Integrator of the explicit solver
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	ESpringMassIntegrator Integrator = ESpringMassIntegrator::SymplecticEuler;
+
+	// Largest timestep of the explicit solver in seconds, lowered to the estimated stable step
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation", meta = (ClampMin = "0.0005", ClampMax = "0.05"))
+	float MaxTimeStep = 1 / 200.0f;
+
+	// Most explicit substeps per frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation", meta = (ClampMin = "1"))
+	int32 MaxSubstepsPerFrame = 16;
+
+	// Milliseconds the substeps of one frame may take, time beyond that is dropped
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation", meta = (ClampMin = "0.1"))
+	float SimulationBudgetMs = 2.0f;
+
+	// Constraint projection sweeps per step of the XPBD solver
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation", meta = (ClampMin = "1"))
+	int32 XPBDIterations = 10;
+
+	// Pull springs stretched past MaxStrain back after every step, so soft springs
+	// with a large stable timestep still give stiff cloth
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	bool bStrainLimiting = false;
+
+	// Stretch the springs are limited to, 0.1 allows 10% over the rest length
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation", meta = (ClampMin = "0.0", EditCondition = "bStrainLimiting"))
+	float MaxStrain = 0.1f;
+
+	// Freeze resting regions of the cloth until a force or a moving neighbour wakes them, explicit solver only
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	bool bAllowSleeping = true;
+
+	// Speed a region has to stay below for a second to fall asleep, neighbours four times as fast wake it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation", meta = (ClampMin = "0.0", EditCondition = "bAllowSleeping"))
+	float SleepSpeed = 0.05f;
+
+	// Actors whose sphere and capsule components push the cloth, e.g. VR hands or the player pawn
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Collision")
+	TArray<AActor*> ColliderActors;
+
+	// Planes in world space the cloth stays above, e.g. the floor
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Collision")
+	TArray<FPlane> CollisionPlanes;
+
+	// Distance the mass points keep from the colliders
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Collision", meta = (ClampMin = "0.0"))
+	float CollisionThickness = 1.0f;
+
+	// Coulomb friction coefficient between the cloth and the colliders
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Collision", meta = (ClampMin = "0.0"))
+	float CollisionFriction = 0.3f;
+
+	// Keep folds of the cloth from passing through each other
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Collision")
+	bool bSelfCollision = false;
+
+	// Distance the cloth keeps from itself
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Collision", meta = (ClampMin = "0.01", EditCondition = "bSelfCollision"))
+	float SelfCollisionThickness = 2.0f;
+
+	// Break springs stretched past TearStrain and split the cloth along them, not with async simulation,
+	// the coarse level is dropped after the first tear
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tearing")
+	bool bTearing = false;
+
+	// Strain at which a spring breaks, 1 breaks it at twice its rest length
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tearing", meta = (ClampMin = "0.01", EditCondition = "bTearing"))
+	float TearStrain = 1.0f;
+
+	// Render the cloth Loop subdivided this many times, four times the triangles per level, so a coarse
+	// lattice looks smooth; not with tearing
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Rendering", meta = (ClampMin = "0", ClampMax = "3"))
+	int32 SubdivisionLevels = 0;
+
+	// Simulate a coarser lattice when the cloth is small on screen and pause it when hidden, not with async simulation,
+	// only the generated lattice has a coarse level
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD")
+	bool bEnableLod = true;
+
+	// Bounds diameter over screen height below which the coarse lattice is simulated
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (ClampMin = "0.0", EditCondition = "bEnableLod"))
+	float CoarseScreenSize = 0.25f;
+
+	// Seconds the cloth has to be off screen before its simulation pauses
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (ClampMin = "0.0", EditCondition = "bEnableLod"))
+	float FreezeDelay = 2.0f;
+
+	// Seconds over which the wrinkles of the full lattice fade out when switching to the coarse one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (ClampMin = "0.0", EditCondition = "bEnableLod"))
+	float LodBlendTime = 0.5f;
+
+	// Settled state the cloth starts in, relative to the content folder. Packaged games need its folder
+	// in Additional Non-Asset Directories to Package
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Rest State", meta = (RelativeToGameContentDir, FilePathFilter = "smrest"))
+	FFilePath RestStateFile;
+
+	// Simulate the cloth until it comes to rest and save its state to RestStateFile
+	UFUNCTION(CallInEditor, Category = "Rest State")
+	void BakeRestState();
+
+	// Step the simulation on a dedicated thread at a fixed rate, the mesh interpolates between steps
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	bool bAsyncSimulation = false;
+
+	// Steps per second of the asynchronous simulation, explicit steps are split into substeps of at most MaxTimeStep
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation", meta = (ClampMin = "10", ClampMax = "2000", EditCondition = "bAsyncSimulation"))
+	float AsyncStepRate = 200.0f;
+
+	// Simulation time dropped because of the substep limits, in seconds since the start
+	UFUNCTION(BlueprintCallable, Category = "Simulation")
+	float GetDroppedSimulationTime() const { return float(scheduler.getDroppedTotal()); }
+
+	// Level the simulation runs at
+	UFUNCTION(BlueprintCallable, Category = "LOD")
+	ESpringMassLod GetSimulationLod() const { return bLodFrozen ? ESpringMassLod::Frozen : simulatedLod; }
 
 	// Add a force to our system
 	UFUNCTION(BlueprintCallable, Category = "Main")
@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassLod.h"
+#include "spring_mass.h"
+
+
+// segment [lines[k], lines[k + 1]] containing i and the position within it
+static void
+locate(const TArray<int32>& lines, int32 i, int32& segment, float& t)
+{
+	segment = 0;
+	while (segment + 2 < lines.Num() && lines[segment + 1] <= i)
+	{
+		segment++;
+	}
+	t = float(i - lines[segment]) / float(lines[segment + 1] - lines[segment]);
+}
+
+template<typename Fn>
+FVector3f
+SpringMassLod::interpolateAt(int32 i, Fn&& value) const
+{
+	const Weights& w = m_weights[i];
+	const FVector3f low = FMath::Lerp(value(w.corner), value(w.corner + 1), w.v);
+	const FVector3f high = FMath::Lerp(value(w.corner + m_coarseRows), value(w.corner + m_coarseRows + 1), w.v);
+	return FMath::Lerp(low, high, w.u);
+}
+
+void
+SpringMassLod::init(const SpringMassSystem& fine, int32 rows, int32 cols, float spacing, int32 stride)
+{
+	const TArray<int32> columns = SpringMassTopology::latticeLines(cols, stride);
+	const TArray<int32> lines = SpringMassTopology::latticeLines(rows, stride);
+	m_coarseRows = lines.Num();
+	const int32 coarseCols = columns.Num();
+	if (m_coarseRows < 2 || coarseCols < 2)
+	{
+		m_weights.Reset();
+		return;
+	}
+
+	m_coarse.m_mass = fine.m_mass;
+	m_coarse.m_stiffness = fine.m_stiffness;
+	m_coarse.m_damper = fine.m_damper;
+	m_coarse.m_gravity = fine.m_gravity;
+
+	// stretch and shear springs of the coarse lattice, shared by the coarse levels of one shape
+	m_coarse.setTopology(SpringMassTopology::getLattice(rows, cols, spacing, stride));
+	MassPoints& points = m_coarse.massPoints;
+	m_coarseToFine.Reset(coarseCols * m_coarseRows);
+	for (int32 a = 0; a < coarseCols; a++)
+	{
+		for (int32 b = 0; b < m_coarseRows; b++)
+		{
+			m_coarseToFine.Add(columns[a] * rows + lines[b]);
+		}
+	}
+
+	// bilinear weights, the same ones lump the fine masses onto the coarse points
+	TArray<float> masses;
+	masses.Init(0.0f, points.num());
+	m_weights.SetNumUninitialized(rows * cols);
+	for (int32 x = 0; x < cols; x++)
+	{
+		for (int32 z = 0; z < rows; z++)
+		{
+			int32 a, b;
+			float u, v;
+			locate(columns, x, a, u);
+			locate(lines, z, b, v);
+			const int32 corner = a * m_coarseRows + b;
+			m_weights[x * rows + z] = { corner, u, v };
+
+			const float invMass = fine.massPoints.invMasses[x * rows + z];
+			const float mass = invMass > 0.0f ? 1.0f / invMass : fine.m_mass;
+			masses[corner] += mass * (1.0f - u) * (1.0f - v);
+			masses[corner + 1] += mass * (1.0f - u) * v;
+			masses[corner + m_coarseRows] += mass * u * (1.0f - v);
+			masses[corner + m_coarseRows + 1] += mass * u * v;
+		}
+	}
+	for (int32 i = 0; i < points.num(); i++)
+	{
+		points.invMasses[i] = points.pinned[i] ? 0.0f : 1.0f / masses[i];
+	}
+	m_coarse.updateMasses();
+
+	m_details.Init(FVector3f::ZeroVector, rows * cols);
+	m_blend = 0.0f;
+}
+
+void
+SpringMassLod::reset()
+{
+	m_weights.Reset();
+	m_coarseToFine.Reset();
+	m_details.Reset();
+	m_coarse.setTopology(SpringMassTopology::getEmpty());
+	m_blend = 0.0f;
+}
+
+void
+SpringMassLod::applySettings(const SpringMassSettings& settings)
+{
+	SpringMassSettings coarse = settings;
+	coarse.tearing = false;
+	m_coarse.applySettings(coarse);
+}
+
+void
+SpringMassLod::beginCoarse(const SpringMassSystem& fine, float blendTime)
+{
+	checkSizes(fine);
+	MassPoints& points = m_coarse.massPoints;
+	for (int32 c = 0; c < m_coarseToFine.Num(); c++)
+	{
+		points.positions[c] = fine.massPoints.positions[m_coarseToFine[c]];
+		points.velocities[c] = fine.massPoints.velocities[m_coarseToFine[c]];
+		points.forces[c] = FVector3f::ZeroVector;
+	}
+	m_coarse.restart();
+
+	for (int32 i = 0; i < m_weights.Num(); i++)
+	{
+		m_details[i] = fine.massPoints.positions[i] - interpolateAt(i, [&points](int32 c) { return points.positions[c]; });
+	}
+	m_blend = 1.0f;
+	m_blendTime = blendTime;
+}
+
+void
+SpringMassLod::endCoarse(SpringMassSystem& fine) const
+{
+	checkSizes(fine);
+	// from the shape that was rendered last
+	const MassPoints& points = m_coarse.massPoints;
+	MassPoints& finePoints = fine.massPoints;
+	for (int32 i = 0; i < m_weights.Num(); i++)
+	{
+		if (!finePoints.pinned[i])
+		{
+			finePoints.positions[i] = interpolateAt(i, [&points](int32 c) { return points.positions[c]; }) + m_details[i] * m_blend;
+			finePoints.velocities[i] = interpolateAt(i, [&points](int32 c) { return points.velocities[c]; });
+		}
+		finePoints.forces[i] = FVector3f::ZeroVector;
+	}
+	fine.restart();
+}
+
+void
+SpringMassLod::checkSizes(const SpringMassSystem& fine) const
+{
+	check(m_coarse.massPoints.num() == m_coarseToFine.Num());
+	check(fine.massPoints.num() == m_weights.Num());
+}
+
+void
+SpringMassLod::advanceBlend(float deltaT)
+{
+	m_blend = m_blendTime > 0.0f ? FMath::Max(0.0f, m_blend - deltaT / m_blendTime) : 0.0f;
+}
+
+void
+SpringMassLod::interpolate(TArray<FVector3f>& positions) const
+{
+	const TArray<FVector3f>& coarse = m_coarse.massPoints.positions;
+	check(coarse.Num() == m_coarseToFine.Num());
+	positions.SetNumUninitialized(m_weights.Num(), false);
+	for (int32 i = 0; i < m_weights.Num(); i++)
+	{
+		positions[i] = interpolateAt(i, [&coarse](int32 c) { return coarse[c]; }) + m_details[i] * m_blend;
+	}
+}
+
+uint32
+SpringMassLod::coarsePointOf(uint32 fine) const
+{
+	const Weights& w = m_weights[fine];
+	return w.corner + (w.u > 0.5f ? m_coarseRows : 0) + (w.v > 0.5f ? 1 : 0);
+}
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SpringMassSystem.h"
+
+#include "SpringMassLod.generated.h"
+
+UENUM(BlueprintType)
+enum class ESpringMassLod : uint8
+{
+	// every mass point of the lattice
+	Full,
+	// every other row and column, with longer substeps
+	Coarse,
+	// not simulated
+	Frozen,
+};
+
+/**
+ * Coarse version of a cloth lattice and the maps between the two.
+ *
+ * The lattice point in column x and row z has index x * rows + z, as laid out
+ * by ASpringMassActor. The coarse system keeps every stride-th column and row
+ * and the last ones, connected by the same stretch and shear springs with the
+ * same stiffness, so the sheet keeps its stiffness and weight per area. The
+ * masses of the fine points are lumped onto the coarse ones with the bilinear
+ * weights that interpolate the fine points back for rendering.
+ *
+ * When the coarse system takes over, the difference between the fine shape
+ * and its interpolation is kept as an offset that fades out over the blend
+ * time, so the wrinkles flatten instead of popping. When the fine system takes
+ * over again it starts from the interpolated shape.
+ */
+class SPRING_MASS_API SpringMassLod
+{
+public:
+	// build the coarse system of a lattice from SpringMassTopology::getLattice
+	// with the masses of the fine system
+	void init(const SpringMassSystem& fine, int32 rows, int32 cols, float spacing, int32 stride);
+	bool isInitialized() const { return m_weights.Num() > 0; }
+	// drop the coarse system, for cloth that is not a lattice
+	void reset();
+
+	// the settings of the fine system for the coarse one, which never tears:
+	// its points have to stay the ones of the maps
+	void applySettings(const SpringMassSettings& settings);
+
+	SpringMassSystem& getCoarse() { return m_coarse; }
+	const SpringMassSystem& getCoarse() const { return m_coarse; }
+
+	// continue the fine state on the coarse system and start fading out its details
+	void beginCoarse(const SpringMassSystem& fine, float blendTime);
+	// continue the coarse state on the fine system
+	void endCoarse(SpringMassSystem& fine) const;
+
+	// advance the fade of the details
+	void advanceBlend(float deltaT);
+
+	// fine positions interpolated from the coarse system with the fading details
+	void interpolate(TArray<FVector3f>& positions) const;
+
+	// coarse point closest to a fine one
+	uint32 coarsePointOf(uint32 fine) const;
+
+protected:
+	// a fine point is interpolated between the coarse points c, c + 1 (next row),
+	// c + coarse rows (next column) and c + coarse rows + 1
+	struct Weights
+	{
+		int32 corner;
+		float u;
+		float v;
+	};
+	TArray<Weights> m_weights;
+	int32 m_coarseRows = 0;
+
+	SpringMassSystem m_coarse;
+	// fine index of every coarse point
+	TArray<int32> m_coarseToFine;
+
+	// fine details relative to the interpolation, scaled by m_blend
+	TArray<FVector3f> m_details;
+	float m_blend = 0.0f;
+	float m_blendTime = 0.0f;
+
+	// the maps were built for the point counts of both systems, a topology
+	// change has to reset or init them again
+	void checkSizes(const SpringMassSystem& fine) const;
+
+	template<typename Fn>
+	FVector3f interpolateAt(int32 i, Fn&& value) const;
+};
@@ -0,0 +1,601 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassMeshComponent.h"
+#include "spring_mass.h"
+#include "SpringMassStats.h"
+#include "Algo/Sort.h"
+
+#include "DynamicMeshBuilder.h"
+#include "LocalVertexFactory.h"
+#include "MaterialDomain.h"
+#include "Materials/Material.h"
+#include "PrimitiveSceneProxy.h"
+#include "PrimitiveViewRelevance.h"
+#include "SceneInterface.h"
+#include "StaticMeshResources.h"
+#include "Async/ParallelFor.h"
+
+// the snapshots are copied into the tangent buffer as is
+static_assert(sizeof(SpringMassMeshTangent) == 2 * sizeof(FPackedNormal), "tangent frames must match the low precision tangent layout");
+
+
+/**
+ * Render thread side of USpringMassMeshComponent. None of the vertex buffers
+ * keeps a CPU copy, positions and tangent frames are copied from the
+ * snapshots into the locked position and tangent buffers.
+ */
+class SpringMassMeshSceneProxy final : public FPrimitiveSceneProxy
+{
+public:
+	SpringMassMeshSceneProxy(USpringMassMeshComponent* component)
+		: FPrimitiveSceneProxy(component)
+		, m_vertexFactory(GetScene().GetFeatureLevel(), "SpringMassMeshSceneProxy")
+		, m_materialRelevance(component->GetMaterialRelevance(GetScene().GetFeatureLevel()))
+	{
+		const SpringMassMeshSnapshot& snapshot = component->getLatest();
+		const TArray<FVector2f>& uvs = component->getUVs();
+		const int32 numVertices = snapshot.positions.Num();
+
+		m_vertexBuffers.PositionVertexBuffer.Init(snapshot.positions, false);
+		m_vertexBuffers.StaticMeshVertexBuffer.Init(numVertices, 1, false);
+		FMemory::Memcpy(m_vertexBuffers.StaticMeshVertexBuffer.GetTangentData(), snapshot.tangents.GetData(), numVertices * sizeof(SpringMassMeshTangent));
+		for (int32 i = 0; i < numVertices && i < uvs.Num(); i++)
+		{
+			m_vertexBuffers.StaticMeshVertexBuffer.SetVertexUV(i, 0, uvs[i]);
+		}
+		m_vertexBuffers.ColorVertexBuffer.InitFromSingleColor(FColor::White, numVertices, false);
+		m_indexBuffer.Indices = component->getIndices();
+
+		BeginInitResource(&m_vertexBuffers.PositionVertexBuffer);
+		BeginInitResource(&m_vertexBuffers.StaticMeshVertexBuffer);
+		BeginInitResource(&m_vertexBuffers.ColorVertexBuffer);
+		BeginInitResource(&m_indexBuffer);
+
+		// bind after the buffers are initialized, the binding needs their views
+		FStaticMeshVertexBuffers* vertexBuffers = &m_vertexBuffers;
+		FLocalVertexFactory* vertexFactory = &m_vertexFactory;
+		ENQUEUE_RENDER_COMMAND(InitSpringMassMeshVertexFactory)(
+			[vertexBuffers, vertexFactory](FRHICommandListImmediate& RHICmdList)
+		{
+			FLocalVertexFactory::FDataType data;
+			vertexBuffers->PositionVertexBuffer.BindPositionVertexBuffer(vertexFactory, data);
+			vertexBuffers->StaticMeshVertexBuffer.BindTangentVertexBuffer(vertexFactory, data);
+			vertexBuffers->StaticMeshVertexBuffer.BindPackedTexCoordVertexBuffer(vertexFactory, data);
+			vertexBuffers->StaticMeshVertexBuffer.BindLightMapVertexBuffer(vertexFactory, data, 0);
+			vertexBuffers->ColorVertexBuffer.BindColorVertexBuffer(vertexFactory, data);
+			vertexFactory->SetData(data);
+		});
+		BeginInitResource(&m_vertexFactory);
+
+		m_material = component->GetMaterial(0);
+		if (m_material == nullptr)
+		{
+			m_material = UMaterial::GetDefaultMaterial(MD_Surface);
+		}
+	}
+
+	virtual ~SpringMassMeshSceneProxy()
+	{
+		m_vertexBuffers.PositionVertexBuffer.ReleaseResource();
+		m_vertexBuffers.StaticMeshVertexBuffer.ReleaseResource();
+		m_vertexBuffers.ColorVertexBuffer.ReleaseResource();
+		m_indexBuffer.ReleaseResource();
+		m_vertexFactory.ReleaseResource();
+	}
+
+	// copy the changed vertex ranges of a snapshot into the position and tangent buffers
+	void updatePositions_RenderThread(FRHICommandListImmediate& RHICmdList, const SpringMassMeshSnapshot& snapshot)
+	{
+		if (snapshot.positions.Num() != int32(m_vertexBuffers.PositionVertexBuffer.GetNumVertices()))
+		{
+			return;
+		}
+
+		SCOPE_CYCLE_COUNTER(STAT_SpringMassUpload);
+		TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassUpload);
+		for (const FIntPoint& span : snapshot.dirtySpans)
+		{
+			INC_DWORD_STAT_BY(STAT_SpringMassUploadedVertices, span.Y);
+			copySpan(RHICmdList, m_vertexBuffers.PositionVertexBuffer.VertexBufferRHI, snapshot.positions.GetData(), span);
+			copySpan(RHICmdList, m_vertexBuffers.StaticMeshVertexBuffer.TangentsVertexBuffer.VertexBufferRHI, snapshot.tangents.GetData(), span);
+		}
+	}
+
+	// write the triangle spans (first triangle, count) into the index buffer
+	// and the UVs of the vertices from firstVertex on into the texture coordinates
+	void updateTopology_RenderThread(FRHICommandListImmediate& RHICmdList, const TArray<FIntPoint>& triangleSpans, const TArray<uint32>& indices, int32 firstVertex, const TArray<FVector2f>& uvs)
+	{
+		const uint32* source = indices.GetData();
+		for (const FIntPoint& span : triangleSpans)
+		{
+			FMemory::Memcpy(&m_indexBuffer.Indices[3 * span.X], source, 3 * span.Y * sizeof(uint32));
+			source += 3 * span.Y;
+			copySpan(RHICmdList, m_indexBuffer.IndexBufferRHI, m_indexBuffer.Indices.GetData(), FIntPoint(3 * span.X, 3 * span.Y));
+		}
+
+		FStaticMeshVertexBuffer& buffer = m_vertexBuffers.StaticMeshVertexBuffer;
+		if (uvs.Num() == 0)
+		{
+			return;
+		}
+		if (buffer.GetUseFullPrecisionUVs())
+		{
+			copyUVs<FVector2f>(RHICmdList, buffer.TexCoordVertexBuffer.VertexBufferRHI, firstVertex, uvs);
+		}
+		else
+		{
+			copyUVs<FVector2DHalf>(RHICmdList, buffer.TexCoordVertexBuffer.VertexBufferRHI, firstVertex, uvs);
+		}
+	}
+
+	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+	{
+		const bool bWireframe = AllowDebugViewmodes() && ViewFamily.EngineShowFlags.Wireframe;
+
+		FMaterialRenderProxy* materialProxy = m_material->GetRenderProxy();
+		if (bWireframe)
+		{
+			FColoredMaterialRenderProxy* wireframeMaterial = new FColoredMaterialRenderProxy(
+				GEngine->WireframeMaterial ? GEngine->WireframeMaterial->GetRenderProxy() : nullptr,
+				FLinearColor(0, 0.5f, 1.f));
+			Collector.RegisterOneFrameMaterialProxy(wireframeMaterial);
+			materialProxy = wireframeMaterial;
+		}
+
+		for (int32 viewIndex = 0; viewIndex < Views.Num(); viewIndex++)
+		{
+			if ((VisibilityMap & (1 << viewIndex)) == 0)
+			{
+				continue;
+			}
+
+			FMeshBatch& mesh = Collector.AllocateMesh();
+			mesh.bWireframe = bWireframe;
+			mesh.VertexFactory = &m_vertexFactory;
+			mesh.MaterialRenderProxy = materialProxy;
+			mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
+			mesh.Type = PT_TriangleList;
+			mesh.DepthPriorityGroup = SDPG_World;
+			mesh.bCanApplyViewModeOverrides = false;
+
+			FMeshBatchElement& element = mesh.Elements[0];
+			element.IndexBuffer = &m_indexBuffer;
+			element.PrimitiveUniformBuffer = GetUniformBuffer();
+			element.FirstIndex = 0;
+			element.NumPrimitives = m_indexBuffer.Indices.Num() / 3;
+			element.MinVertexIndex = 0;
+			element.MaxVertexIndex = m_vertexBuffers.PositionVertexBuffer.GetNumVertices() - 1;
+
+			Collector.AddMesh(viewIndex, mesh);
+		}
+	}
+
+	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+	{
+		FPrimitiveViewRelevance result;
+		result.bDrawRelevance = IsShown(View);
+		result.bShadowRelevance = IsShadowCast(View);
+		result.bDynamicRelevance = true;
+		result.bRenderInMainPass = ShouldRenderInMainPass();
+		result.bUsesLightingChannels = GetLightingChannelMask() != GetDefaultLightingChannelMask();
+		result.bRenderCustomDepth = ShouldRenderCustomDepth();
+		m_materialRelevance.SetPrimitiveViewRelevance(result);
+		return result;
+	}
+
+	virtual bool CanBeOccluded() const override
+	{
+		return !m_materialRelevance.bDisableDepthTest;
+	}
+
+	virtual uint32 GetMemoryFootprint() const override
+	{
+		return sizeof(*this) + GetAllocatedSize();
+	}
+
+	virtual SIZE_T GetTypeHash() const override
+	{
+		static size_t uniquePointer;
+		return reinterpret_cast<size_t>(&uniquePointer);
+	}
+
+private:
+	FStaticMeshVertexBuffers m_vertexBuffers;
+	FDynamicMeshIndexBuffer32 m_indexBuffer;
+	FLocalVertexFactory m_vertexFactory;
+
+	UMaterialInterface* m_material = nullptr;
+	FMaterialRelevance m_materialRelevance;
+
+	// copy vertices [span.X, span.X + span.Y) of a per vertex array into a vertex buffer
+	template<typename T>
+	static void copySpan(FRHICommandListImmediate& RHICmdList, FRHIBuffer* buffer, const T* source, const FIntPoint& span)
+	{
+		const uint32 bytes = span.Y * sizeof(T);
+		void* data = RHICmdList.LockBuffer(buffer, span.X * sizeof(T), bytes, RLM_WriteOnly);
+		FMemory::Memcpy(data, source + span.X, bytes);
+		RHICmdList.UnlockBuffer(buffer);
+	}
+
+	// convert uvs to the texture coordinate layout T and write them from vertex first on
+	template<typename T>
+	static void copyUVs(FRHICommandListImmediate& RHICmdList, FRHIBuffer* buffer, int32 first, const TArray<FVector2f>& uvs)
+	{
+		T* data = static_cast<T*>(RHICmdList.LockBuffer(buffer, first * sizeof(T), uvs.Num() * sizeof(T), RLM_WriteOnly));
+		for (int32 i = 0; i < uvs.Num(); i++)
+		{
+			data[i] = T(uvs[i]);
+		}
+		RHICmdList.UnlockBuffer(buffer);
+	}
+};
+
+
+void
+USpringMassMeshComponent::buildBlockDependents()
+{
+	const TArray<uint32>& indices = m_tangentFrames.getIndices();
+	const int32 n = m_numVertices;
+	const int32 numBlocks = FMath::DivideAndRoundUp(n, BlockSize);
+
+	// a block depends on every block its vertices share a triangle with,
+	// collect (read block, dependent block) once per pair and sort by read block
+	TArray<FIntPoint> pairs;
+	TArray<int32> seen;
+	seen.Init(INDEX_NONE, numBlocks);
+	for (int32 block = 0; block < numBlocks; block++)
+	{
+		const int32 last = FMath::Min(n, (block + 1) * BlockSize);
+		for (int32 v = block * BlockSize; v < last; v++)
+		{
+			for (int32 t : m_tangentFrames.getVertexTriangles(v))
+			{
+				for (int32 corner = 0; corner < 3; corner++)
+				{
+					const int32 read = indices[3 * t + corner] / BlockSize;
+					if (seen[read] != block)
+					{
+						seen[read] = block;
+						pairs.Add(FIntPoint(read, block));
+					}
+				}
+			}
+		}
+		// the positions of a block are uploaded with it, even without triangles
+		if (seen[block] != block)
+		{
+			seen[block] = block;
+			pairs.Add(FIntPoint(block, block));
+		}
+	}
+
+	m_blockDependentOffsets.Init(0, numBlocks + 1);
+	for (const FIntPoint& pair : pairs)
+	{
+		m_blockDependentOffsets[pair.X + 1]++;
+	}
+	for (int32 block = 0; block < numBlocks; block++)
+	{
+		m_blockDependentOffsets[block + 1] += m_blockDependentOffsets[block];
+	}
+	TArray<int32> cursor = m_blockDependentOffsets;
+	m_blockDependents.SetNumUninitialized(pairs.Num());
+	for (const FIntPoint& pair : pairs)
+	{
+		m_blockDependents[cursor[pair.X]++] = pair.Y;
+	}
+	m_updateBlocks.Reset(numBlocks);
+}
+
+void
+USpringMassMeshComponent::addBlockDependents(const TArray<int32>& triangles)
+{
+	const TArray<uint32>& indices = m_tangentFrames.getIndices();
+	const int32 oldBlocks = m_blockDependentOffsets.Num() - 1;
+	const int32 numBlocks = FMath::DivideAndRoundUp(m_numVertices, BlockSize);
+
+	// the blocks of the corners of a changed triangle read each other, new
+	// blocks read themselves. Dependencies the triangles lost are kept, they
+	// only cost a recomputed block
+	TArray<FIntPoint> pairs;
+	for (int32 t : triangles)
+	{
+		for (int32 a = 0; a < 3; a++)
+		{
+			for (int32 b = 0; b < 3; b++)
+			{
+				pairs.Add(FIntPoint(indices[3 * t + a] / BlockSize, indices[3 * t + b] / BlockSize));
+			}
+		}
+	}
+	for (int32 block = oldBlocks; block < numBlocks; block++)
+	{
+		pairs.Add(FIntPoint(block, block));
+	}
+	Algo::Sort(pairs, [](const FIntPoint& a, const FIntPoint& b)
+	{
+		return a.X != b.X ? a.X < b.X : a.Y < b.Y;
+	});
+
+	// merged into the rows of their read blocks, the other rows are copied
+	TArray<int32> offsets;
+	TArray<int32> dependents;
+	offsets.SetNumUninitialized(numBlocks + 1);
+	dependents.Reserve(m_blockDependents.Num() + pairs.Num());
+	int32 next = 0;
+	for (int32 block = 0; block < numBlocks; block++)
+	{
+		offsets[block] = dependents.Num();
+		if (block < oldBlocks)
+		{
+			dependents.Append(m_blockDependents.GetData() + m_blockDependentOffsets[block], m_blockDependentOffsets[block + 1] - m_blockDependentOffsets[block]);
+		}
+		for (; next < pairs.Num() && pairs[next].X == block; next++)
+		{
+			bool bKnown = false;
+			for (int32 k = offsets[block]; k < dependents.Num() && !bKnown; k++)
+			{
+				bKnown = dependents[k] == pairs[next].Y;
+			}
+			if (!bKnown)
+			{
+				dependents.Add(pairs[next].Y);
+			}
+		}
+	}
+	offsets[numBlocks] = dependents.Num();
+	m_blockDependentOffsets = MoveTemp(offsets);
+	m_blockDependents = MoveTemp(dependents);
+	m_updateBlocks.Reset(numBlocks);
+}
+
+void
+USpringMassMeshComponent::setTopology(const TArray<FVector3f>& positions, const TArray<uint32>& indices, const TArray<FVector2f>& uvs, int32 spareVertices)
+{
+	const int32 n = positions.Num();
+	const int32 capacity = n + spareVertices;
+	const int32 numBlocks = FMath::DivideAndRoundUp(n, BlockSize);
+	m_numVertices = n;
+	m_spareVertices = spareVertices;
+	m_tangentFrames.init(indices, uvs, n);
+	m_tangents.SetNumZeroed(capacity);
+	m_tangentFrames.compute(positions, 0, n, m_tangents.GetData());
+	buildBlockDependents();
+	m_pendingBlocks.Reset();
+
+	// fresh snapshots, commands still in flight keep the old ones alive
+	for (int32 i = 0; i < SnapshotCount; i++)
+	{
+		m_snapshots[i] = MakeShared<SpringMassMeshSnapshot, ESPMode::ThreadSafe>();
+		m_snapshots[i]->positions = positions;
+		m_snapshots[i]->positions.SetNumZeroed(capacity);
+		m_snapshots[i]->tangents = m_tangents;
+		m_snapshots[i]->dirtySpans.Reserve(FMath::DivideAndRoundUp(capacity, BlockSize));
+	}
+	m_latest = 0;
+	m_blockChanged.Init(0, numBlocks);
+
+	m_localBox = FBox3f(ForceInit);
+	for (const FVector3f& position : positions)
+	{
+		m_localBox += position;
+	}
+
+	UpdateBounds();
+	MarkRenderStateDirty();
+}
+
+void
+USpringMassMeshComponent::splitVertices(const TArray<FVector3f>& positions, const TArray<uint32>& indices, const TArray<uint32>& sources, const TArray<int32>& triangles)
+{
+	if (!m_snapshots[m_latest].IsValid())
+	{
+		return;
+	}
+
+	const int32 first = m_numVertices;
+	const int32 n = positions.Num();
+	check(n == first + sources.Num());
+
+	// out of spare vertices, recreate the buffers with room for more tears,
+	// the copies take the UVs of the vertex they were split from
+	if (n > getLatest().positions.Num())
+	{
+		TArray<FVector2f> uvs = getUVs();
+		for (uint32 source : sources)
+		{
+			uvs.Add(uvs[source]);
+		}
+		setTopology(positions, indices, uvs, FMath::Max(m_spareVertices, n - first) * 2);
+		return;
+	}
+
+	// only the rows of the split and the new vertices change
+	m_tangentFrames.splitVertices(indices, sources, triangles);
+	m_numVertices = n;
+	addBlockDependents(triangles);
+	m_blockChanged.SetNumZeroed(FMath::DivideAndRoundUp(n, BlockSize));
+
+	// only the split vertices lost or gained triangles, the new ones also
+	// differ from the zeros in the snapshots
+	for (uint32 source : sources)
+	{
+		m_pendingBlocks.Add(source / BlockSize);
+	}
+	for (int32 v = first; v < n; v += BlockSize)
+	{
+		m_pendingBlocks.Add(v / BlockSize);
+	}
+	m_pendingBlocks.Add((n - 1) / BlockSize);
+
+	if (SceneProxy != nullptr)
+	{
+		// changed triangles merged into spans of the index buffer
+		TArray<FIntPoint> triangleSpans;
+		TArray<uint32> spanIndices;
+		for (int32 t : triangles)
+		{
+			if (triangleSpans.Num() > 0 && triangleSpans.Last().X + triangleSpans.Last().Y == t)
+			{
+				triangleSpans.Last().Y++;
+			}
+			else
+			{
+				triangleSpans.Add(FIntPoint(t, 1));
+			}
+			spanIndices.Add(indices[3 * t]);
+			spanIndices.Add(indices[3 * t + 1]);
+			spanIndices.Add(indices[3 * t + 2]);
+		}
+		TArray<FVector2f> newUVs(getUVs().GetData() + first, n - first);
+
+		SpringMassMeshSceneProxy* proxy = static_cast<SpringMassMeshSceneProxy*>(SceneProxy);
+		ENQUEUE_RENDER_COMMAND(UpdateSpringMassMeshTopology)(
+			[proxy, triangleSpans = MoveTemp(triangleSpans), spanIndices = MoveTemp(spanIndices), first, newUVs = MoveTemp(newUVs)](FRHICommandListImmediate& RHICmdList)
+		{
+			proxy->updateTopology_RenderThread(RHICmdList, triangleSpans, spanIndices, first, newUVs);
+		});
+	}
+}
+
+void
+USpringMassMeshComponent::updatePositions(const TArray<FVector3f>& positions)
+{
+	if (!m_snapshots[m_latest].IsValid())
+	{
+		return;
+	}
+
+	const SpringMassMeshSnapshot& latest = *m_snapshots[m_latest];
+	const int32 n = m_numVertices;
+	const int32 numBlocks = m_blockChanged.Num();
+	check(positions.Num() == n);
+
+	// latest is what the render thread has, the blocks that differ moved and
+	// every block sharing a triangle with them needs new tangent frames
+	const uint64 update = latest.update + 1;
+	bool moved = m_pendingBlocks.Num() > 0;
+	for (int32 block : m_pendingBlocks)
+	{
+		m_blockChanged[block] = update;
+	}
+	m_pendingBlocks.Reset();
+	for (int32 block = 0; block < numBlocks; block++)
+	{
+		const int32 first = block * BlockSize;
+		const SIZE_T bytes = FMath::Min(BlockSize, n - first) * sizeof(FVector3f);
+		if (FMemory::Memcmp(&positions[first], &latest.positions[first], bytes) != 0)
+		{
+			for (int32 k = m_blockDependentOffsets[block]; k < m_blockDependentOffsets[block + 1]; k++)
+			{
+				m_blockChanged[m_blockDependents[k]] = update;
+			}
+			moved = true;
+		}
+	}
+
+	// nothing moved, keep the current snapshot and bounds
+	if (!moved)
+	{
+		return;
+	}
+
+	const int32 nextIndex = (m_latest + 1) % SnapshotCount;
+	SpringMassMeshSnapshot& next = *m_snapshots[nextIndex];
+	// passed long ago unless the render thread is more than a frame behind
+	next.fence.Wait();
+
+	// blocks of this update in ascending order, merged into spans for the upload
+	m_updateBlocks.Reset();
+	next.dirtySpans.Reset();
+	for (int32 block = 0; block < numBlocks; block++)
+	{
+		if (m_blockChanged[block] != update)
+		{
+			continue;
+		}
+		const int32 first = block * BlockSize;
+		const int32 count = FMath::Min(BlockSize, n - first);
+		m_updateBlocks.Add(block);
+		if (next.dirtySpans.Num() > 0 && next.dirtySpans.Last().X + next.dirtySpans.Last().Y == first)
+		{
+			next.dirtySpans.Last().Y += count;
+		}
+		else
+		{
+			next.dirtySpans.Add(FIntPoint(first, count));
+		}
+	}
+
+	// gather the tangent frames, tasks write disjoint vertex ranges
+	const int32 numTasks = FMath::DivideAndRoundUp(m_updateBlocks.Num(), BlocksPerTask);
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpringMassTangents);
+		TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassTangents);
+		ParallelFor(numTasks, [this, &positions, n](int32 task)
+		{
+			const int32 end = FMath::Min(m_updateBlocks.Num(), (task + 1) * BlocksPerTask);
+			for (int32 i = task * BlocksPerTask; i < end; i++)
+			{
+				const int32 first = m_updateBlocks[i] * BlockSize;
+				m_tangentFrames.compute(positions, first, FMath::Min(n, first + BlockSize), m_tangents.GetData());
+			}
+		});
+	}
+
+	// bring the blocks that changed since next was sent up to date
+	SCOPE_CYCLE_COUNTER(STAT_SpringMassVertexCopy);
+	TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassVertexCopy);
+	for (int32 block = 0; block < numBlocks; block++)
+	{
+		if (m_blockChanged[block] > next.update)
+		{
+			const int32 first = block * BlockSize;
+			const int32 count = FMath::Min(BlockSize, n - first);
+			FMemory::Memcpy(&next.positions[first], &positions[first], count * sizeof(FVector3f));
+			FMemory::Memcpy(&next.tangents[first], &m_tangents[first], count * sizeof(SpringMassMeshTangent));
+		}
+	}
+	next.update = update;
+	m_latest = nextIndex;
+
+	m_localBox = FBox3f(ForceInit);
+	for (const FVector3f& position : positions)
+	{
+		m_localBox += position;
+	}
+	UpdateBounds();
+	MarkRenderTransformDirty();
+
+	if (SceneProxy != nullptr)
+	{
+		SpringMassMeshSceneProxy* proxy = static_cast<SpringMassMeshSceneProxy*>(SceneProxy);
+		TSharedPtr<SpringMassMeshSnapshot, ESPMode::ThreadSafe> snapshot = m_snapshots[nextIndex];
+		ENQUEUE_RENDER_COMMAND(UpdateSpringMassMeshPositions)(
+			[proxy, snapshot](FRHICommandListImmediate& RHICmdList)
+		{
+			proxy->updatePositions_RenderThread(RHICmdList, *snapshot);
+		});
+		next.fence.BeginFence();
+	}
+}
+
+FPrimitiveSceneProxy*
+USpringMassMeshComponent::CreateSceneProxy()
+{
+	if (!m_snapshots[m_latest].IsValid() || getIndices().Num() == 0 || getLatest().positions.Num() == 0)
+	{
+		return nullptr;
+	}
+	return new SpringMassMeshSceneProxy(this);
+}
+
+FBoxSphereBounds
+USpringMassMeshComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (!m_localBox.IsValid)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0);
+	}
+	return FBoxSphereBounds(FBox(m_localBox)).TransformBy(LocalToWorld);
+}
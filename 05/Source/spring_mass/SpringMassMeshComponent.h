@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "MeshTangents.h"
+
+#include "Components/MeshComponent.h"
+#include "RenderCommandFence.h"
+
+#include "SpringMassMeshComponent.generated.h"
+
+/**
+ * Positions and tangent frames handed to the render thread, with the vertex
+ * ranges that changed since the previous snapshot. Ranges are
+ * (first vertex, vertex count).
+ */
+struct SpringMassMeshSnapshot
+{
+	TArray<FVector3f> positions;
+	TArray<SpringMassMeshTangent> tangents;
+	TArray<FIntPoint> dirtySpans;
+	// number of the update the positions are current for
+	uint64 update = 0;
+	// passed once the render thread no longer reads this snapshot
+	FRenderCommandFence fence;
+};
+
+/**
+ * Triangle mesh whose vertices follow the mass points of a spring-mass system.
+ *
+ * The index, UV and color buffers are built once by setTopology. Per frame
+ * updatePositions compares the positions block wise with the last snapshot,
+ * recomputes the tangent frames of the changed blocks and of the blocks
+ * sharing triangles with them in parallel, and copies those blocks into the
+ * next one of a small ring of persistent snapshots. The render thread copies
+ * them straight into the position and tangent buffers. Nothing is allocated
+ * per frame and blocks that did not move are not uploaded.
+ *
+ * Vertex buffers can be created with spare vertices past the used ones, so a
+ * tearing cloth can split vertices without recreating the render resources:
+ * splitVertices only writes the changed triangles into the index buffer and
+ * the UVs of the new vertices into the texture coordinate buffer.
+ */
+UCLASS(ClassGroup = Rendering, meta = (BlueprintSpawnableComponent))
+class SPRING_MASS_API USpringMassMeshComponent : public UMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	// vertices per block of the change detection and upload
+	static constexpr int32 BlockSize = 64;
+	// snapshots in flight, the render thread lags at most one frame behind
+	static constexpr int32 SnapshotCount = 3;
+
+	// blocks of tangent frames computed by one parallel task
+	static constexpr int32 BlocksPerTask = 16;
+
+	// set up vertices, triangles and texture coordinates, recreates the render
+	// resources with room for spareVertices more vertices
+	void setTopology(const TArray<FVector3f>& positions, const TArray<uint32>& indices, const TArray<FVector2f>& uvs, int32 spareVertices = 0);
+
+	// vertices were appended as copies of sources and the given triangles,
+	// sorted, now use them; recreates the render resources only once the
+	// spare vertices run out
+	void splitVertices(const TArray<FVector3f>& positions, const TArray<uint32>& indices, const TArray<uint32>& sources, const TArray<int32>& triangles);
+
+	// send new vertex positions, must have as many entries as the vertices in use
+	void updatePositions(const TArray<FVector3f>& positions);
+
+	// latest positions, what the render thread has or is about to get,
+	// including the spare vertices
+	const SpringMassMeshSnapshot& getLatest() const { return *m_snapshots[m_latest]; }
+	int32 numVertices() const { return m_numVertices; }
+	const TArray<uint32>& getIndices() const { return m_tangentFrames.getIndices(); }
+	const TArray<FVector2f>& getUVs() const { return m_tangentFrames.getUVs(); }
+
+	//~ Begin UPrimitiveComponent Interface
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual int32 GetNumMaterials() const override { return 1; }
+	//~ End UPrimitiveComponent Interface
+
+	//~ Begin USceneComponent Interface
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	//~ End USceneComponent Interface
+
+protected:
+	// triangles, UVs and the normal and tangent computation
+	MeshTangents m_tangentFrames;
+	// tangent frames of the current positions
+	TArray<SpringMassMeshTangent> m_tangents;
+	// vertices in use, the buffers have m_spareVertices more
+	int32 m_numVertices = 0;
+	int32 m_spareVertices = 0;
+
+	// blocks whose tangent frames read positions of block b are
+	// m_blockDependents[m_blockDependentOffsets[b] .. m_blockDependentOffsets[b + 1])
+	TArray<int32> m_blockDependentOffsets;
+	TArray<int32> m_blockDependents;
+	// blocks to recompute and upload in the current update
+	TArray<int32> m_updateBlocks;
+	// blocks whose triangles changed, updated by the next updatePositions
+	TArray<int32> m_pendingBlocks;
+
+	// ring of snapshots, shared with the render commands reading them
+	TSharedPtr<SpringMassMeshSnapshot, ESPMode::ThreadSafe> m_snapshots[SnapshotCount];
+	int32 m_latest = 0;
+
+	// number of the update each block last changed in
+	TArray<uint64> m_blockChanged;
+
+	FBox3f m_localBox = FBox3f(ForceInit);
+
+	// m_blockDependents from the triangles of m_tangentFrames
+	void buildBlockDependents();
+	// add the dependencies through changed triangles and of new vertices
+	void addBlockDependents(const TArray<int32>& triangles);
+};
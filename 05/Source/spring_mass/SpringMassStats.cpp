@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassStats.h"
+#include "spring_mass.h"
+
+
+DEFINE_STAT(STAT_SpringMassSimulate);
+DEFINE_STAT(STAT_SpringMassSpringForces);
+DEFINE_STAT(STAT_SpringMassIntegrate);
+DEFINE_STAT(STAT_SpringMassImplicitSolve);
+DEFINE_STAT(STAT_SpringMassXPBDSolve);
+DEFINE_STAT(STAT_SpringMassStrainLimit);
+DEFINE_STAT(STAT_SpringMassSelfCollision);
+DEFINE_STAT(STAT_SpringMassCollision);
+DEFINE_STAT(STAT_SpringMassSleep);
+DEFINE_STAT(STAT_SpringMassTearing);
+DEFINE_STAT(STAT_SpringMassSubdivision);
+DEFINE_STAT(STAT_SpringMassVertexCopy);
+DEFINE_STAT(STAT_SpringMassTangents);
+DEFINE_STAT(STAT_SpringMassUpload);
+
+DEFINE_STAT(STAT_SpringMassSubsteps);
+DEFINE_STAT(STAT_SpringMassCarriedTime);
+DEFINE_STAT(STAT_SpringMassDroppedTime);
+DEFINE_STAT(STAT_SpringMassPoints);
+DEFINE_STAT(STAT_SpringMassSprings);
+DEFINE_STAT(STAT_SpringMassUploadedVertices);
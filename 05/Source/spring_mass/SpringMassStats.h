@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// "stat SpringMass" in the console. Cycle stats are compiled out of Test and
+// Shipping builds, so every cycle counter scope comes with a trace scope of
+// the same name for Unreal Insights
+DECLARE_STATS_GROUP(TEXT("SpringMass"), STATGROUP_SpringMass, STATCAT_Advanced);
+
+// phases, timed on whichever thread runs them
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Simulate"), STAT_SpringMassSimulate, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spring forces"), STAT_SpringMassSpringForces, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gravity and integration"), STAT_SpringMassIntegrate, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Implicit solve"), STAT_SpringMassImplicitSolve, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XPBD solve"), STAT_SpringMassXPBDSolve, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Strain limiting"), STAT_SpringMassStrainLimit, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Self collision"), STAT_SpringMassSelfCollision, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Collision"), STAT_SpringMassCollision, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Sleeping"), STAT_SpringMassSleep, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tearing"), STAT_SpringMassTearing, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Subdivision"), STAT_SpringMassSubdivision, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Vertex copy"), STAT_SpringMassVertexCopy, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tangent frames"), STAT_SpringMassTangents, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Vertex upload"), STAT_SpringMassUpload, STATGROUP_SpringMass, SPRING_MASS_API);
+
+// per frame, summed over all spring-mass actors
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Substeps"), STAT_SpringMassSubsteps, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Time carried over (ms)"), STAT_SpringMassCarriedTime, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Time dropped (ms)"), STAT_SpringMassDroppedTime, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mass points simulated"), STAT_SpringMassPoints, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Springs simulated"), STAT_SpringMassSprings, STATGROUP_SpringMass, SPRING_MASS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Vertices uploaded"), STAT_SpringMassUploadedVertices, STATGROUP_SpringMass, SPRING_MASS_API);
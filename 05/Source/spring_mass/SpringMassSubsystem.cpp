@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassSubsystem.h"
+#include "spring_mass.h"
+#include "SpringMassActor.h"
+#include "Async/ParallelFor.h"
+
+
+void
+USpringMassSubsystem::registerActor(ASpringMassActor* actor)
+{
+	actors.AddUnique(actor);
+}
+
+void
+USpringMassSubsystem::unregisterActor(ASpringMassActor* actor)
+{
+	actors.Remove(actor);
+}
+
+bool
+USpringMassSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	// editor worlds don't tick the actors either
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void
+USpringMassSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// levels of detail follow the view, settings may have changed from
+	// blueprints or the details panel and colliders move every frame
+	const bool bAlone = actors.Num() == 1;
+	for (ASpringMassActor* actor : actors)
+	{
+		actor->updateLod(DeltaTime);
+		actor->applySimulationSettings(bAlone || actor->getNumMassPoints() >= LargeSystemPoints);
+		actor->updateColliders();
+	}
+
+	// one task per actor, the substep loops share no data
+	ParallelFor(actors.Num(), [this, DeltaTime](int32 i)
+	{
+		ASpringMassActor* actor = actors[i];
+		actor->simulate(DeltaTime * actor->CustomTimeDilation);
+	});
+
+	// render state is only touched from the game thread
+	for (ASpringMassActor* actor : actors)
+	{
+		actor->updateMesh();
+	}
+}
+
+TStatId
+USpringMassSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USpringMassSubsystem, STATGROUP_Tickables);
+}
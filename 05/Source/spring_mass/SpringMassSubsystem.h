@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+
+#include "SpringMassSubsystem.generated.h"
+
+class ASpringMassActor;
+
+/**
+ * Advances every spring-mass actor of a game world in one pass per frame.
+ *
+ * Registered actors stop ticking themselves. Each frame the subsystem copies
+ * their settings, runs the substep loops of all actors in parallel, one actor
+ * per task, and then sends the meshes on the game thread. Actors only
+ * parallelize their own springs and mass points if they are simulated alone
+ * or are large enough to keep several workers busy.
+ */
+UCLASS()
+class SPRING_MASS_API USpringMassSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// mass points from which an actor still splits its own work across workers
+	static constexpr int32 LargeSystemPoints = 16384;
+
+	void registerActor(ASpringMassActor* actor);
+	void unregisterActor(ASpringMassActor* actor);
+
+	//~ Begin UWorldSubsystem Interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	//~ End UWorldSubsystem Interface
+
+	//~ Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject Interface
+
+protected:
+	UPROPERTY()
+	TArray<ASpringMassActor*> actors;
+};
@@ -0,0 +1,378 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassSystem.h"
+#include "spring_mass.h"
+#include "SpringMassStats.h"
+#include "Async/ParallelFor.h"
+
+
+void
+SpringMassSystem::setTopology(const SpringMassTopologyRef& topology)
+{
+	m_grid.reset();
+	initTopology(topology);
+}
+
+void
+SpringMassSystem::setLattice(int32 rows, int32 cols, float spacing)
+{
+	// before the sleep regions look for their neighbours
+	m_grid.init(rows, cols, spacing);
+	initTopology(SpringMassTopology::getLattice(rows, cols, spacing, 1, needsSpringList()));
+}
+
+void
+SpringMassSystem::initTopology(const SpringMassTopologyRef& topology)
+{
+	m_topology = topology;
+	m_ownTopology.Reset();
+
+	massPoints.reset(topology->positions.Num());
+	for (int32 p = 0; p < topology->positions.Num(); p++)
+	{
+		massPoints.add(topology->positions[p], m_mass, !topology->pinned[p]);
+	}
+	m_sleep.init(*this);
+	updateMaxInvMass();
+
+	m_implicit.reset();
+	m_xpbd.reset();
+	m_selfCollision.reset();
+	m_tearing.reset();
+	m_integratorState.reset();
+}
+
+bool
+SpringMassSystem::needsSpringList() const
+{
+	return m_solver != ESpringMassSolver::Explicit || m_strainLimiter.m_enabled || m_selfCollision.m_enabled || m_tearing.m_enabled;
+}
+
+void
+SpringMassSystem::listLatticeSprings(bool bSprings)
+{
+	// the sleep regions start over with the new springs
+	m_sleep.wakeAll(*this, m_integratorState);
+	m_topology = SpringMassTopology::getLattice(m_grid.numRows(), m_grid.numCols(), m_grid.getSpacing(), 1, bSprings);
+	m_ownTopology.Reset();
+	m_sleep.init(*this);
+
+	m_implicit.reset();
+	m_xpbd.reset();
+	m_selfCollision.reset();
+}
+
+int32
+SpringMassSystem::numSprings() const
+{
+	return m_grid.isInitialized() ? m_grid.numSprings() : getSprings().Num();
+}
+
+SpringMassTopology&
+SpringMassSystem::editTopology()
+{
+	// the shared one stays as the other systems see it
+	if (!m_ownTopology.IsValid())
+	{
+		TSharedRef<SpringMassTopology, ESPMode::ThreadSafe> copy = MakeShared<SpringMassTopology, ESPMode::ThreadSafe>(*m_topology);
+		m_ownTopology = copy;
+		m_topology = copy;
+	}
+	return *m_ownTopology;
+}
+
+void
+SpringMassSystem::updateMaxInvMass()
+{
+	m_maxInvMass = 0.0f;
+	for (float invMass : massPoints.invMasses)
+	{
+		m_maxInvMass = FMath::Max(m_maxInvMass, invMass);
+	}
+}
+
+void
+SpringMassSystem::updateMasses()
+{
+	updateMaxInvMass();
+	m_sleep.updatePoints(*this, m_integratorState);
+	m_implicit.reset();
+	m_xpbd.reset();
+}
+
+void
+SpringMassSystem::applySettings(const SpringMassSettings& settings)
+{
+	m_parallel = settings.parallel;
+	m_simdLevel = settings.simdLevel;
+	m_solver = settings.solver;
+	m_integrator = settings.integrator;
+	m_xpbd.m_iterations = settings.xpbdIterations;
+	m_sleep.m_enabled = settings.sleeping;
+	m_sleep.m_sleepSpeed = settings.sleepSpeed;
+	m_sleep.m_wakeSpeed = settings.wakeSpeed;
+	m_collision.m_thickness = settings.collisionThickness;
+	m_collision.m_friction = settings.collisionFriction;
+	m_selfCollision.m_enabled = settings.selfCollision;
+	m_selfCollision.m_thickness = settings.selfCollisionThickness;
+	m_tearing.m_enabled = settings.tearing;
+	m_tearing.m_maxStrain = settings.tearStrain;
+	m_strainLimiter.m_enabled = settings.strainLimiting;
+	m_strainLimiter.m_maxStrain = settings.maxStrain;
+
+	// an untorn lattice lists its springs only while something walks them
+	if (m_grid.isInitialized() && needsSpringList() != (getSprings().Num() > 0))
+	{
+		listLatticeSprings(needsSpringList());
+	}
+}
+
+void
+SpringMassSystem::step(float deltaT)
+{
+	// the integrator history is only valid for the integrator that wrote it
+	if (m_solver != ESpringMassSolver::Explicit || m_integrator != m_stateIntegrator)
+	{
+		m_integratorState.primed = false;
+		m_stateIntegrator = m_integrator;
+	}
+
+	// the implicit and XPBD solvers move every point
+	if (m_solver != ESpringMassSolver::Explicit || !m_sleep.m_enabled)
+	{
+		m_sleep.wakeAll(*this, m_integratorState);
+	}
+	m_sleep.updateBatches(*this);
+
+	switch (m_solver)
+	{
+	case ESpringMassSolver::Implicit:
+		if (!m_implicit.isInitialized())
+		{
+			m_implicit.init(*this);
+		}
+		{
+			SCOPE_CYCLE_COUNTER(STAT_SpringMassImplicitSolve);
+			TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassImplicitSolve);
+			m_implicit.step(*this, deltaT);
+		}
+		break;
+
+	case ESpringMassSolver::XPBD:
+		if (!m_xpbd.isInitialized())
+		{
+			m_xpbd.init(*this);
+		}
+		{
+			SCOPE_CYCLE_COUNTER(STAT_SpringMassXPBDSolve);
+			TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassXPBDSolve);
+			m_xpbd.step(*this, deltaT);
+		}
+		break;
+
+	default:
+		// pick the instantiation once per step, the point loops have no dispatch
+		switch (m_integrator)
+		{
+		case ESpringMassIntegrator::PositionVerlet:
+			stepExplicit<PositionVerletIntegrator>(deltaT);
+			break;
+		case ESpringMassIntegrator::VelocityVerlet:
+			stepExplicit<VelocityVerletIntegrator>(deltaT);
+			break;
+		case ESpringMassIntegrator::RK4:
+			stepExplicit<RK4Integrator>(deltaT);
+			break;
+		default:
+			stepExplicit<SymplecticEulerIntegrator>(deltaT);
+			break;
+		}
+		break;
+	}
+
+	if (m_strainLimiter.m_enabled)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpringMassStrainLimit);
+		TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassStrainLimit);
+		m_strainLimiter.apply(*this, deltaT);
+	}
+
+	// the colliders go last and win over the cloth's own contacts
+	if (m_selfCollision.m_enabled)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpringMassSelfCollision);
+		TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassSelfCollision);
+		if (!m_selfCollision.isInitialized())
+		{
+			m_selfCollision.init(*this, getTriangles());
+		}
+		m_selfCollision.resolve(*this, m_integratorState);
+	}
+	if (!m_collision.m_colliders.isEmpty())
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpringMassCollision);
+		TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassCollision);
+		m_collision.resolve(*this, m_integratorState);
+	}
+
+	if (m_tearing.m_enabled && !m_tearing.isInitialized())
+	{
+		m_tearing.init(*this, m_topology->indices);
+	}
+	// the solvers and self collision hold per spring and per point data of
+	// the old topology, self collision starts over on the next step
+	if (m_tearing.m_enabled && m_tearing.update(*this, m_integratorState))
+	{
+		m_implicit.reset();
+		m_xpbd.reset();
+		// a torn lattice no longer has every stencil spring
+		m_grid.reset();
+		m_selfCollision.reset();
+		m_integratorState.primed = false;
+		updateMaxInvMass();
+	}
+
+	// after the collisions, points resting on a collider may fall asleep
+	if (m_solver == ESpringMassSolver::Explicit && m_sleep.m_enabled)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpringMassSleep);
+		TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassSleep);
+		m_sleep.update(*this, m_integratorState, deltaT);
+	}
+}
+
+void
+SpringMassSystem::restart()
+{
+	m_sleep.wakeAll(*this, m_integratorState);
+	m_integratorState.primed = false;
+}
+
+void
+SpringMassSystem::addForce(uint32 id, const FVector3f& f)
+{
+	m_sleep.wakePoint(*this, m_integratorState, id);
+	massPoints.addForce(id, f);
+}
+
+float
+SpringMassSystem::estimateStableStep() const
+{
+	// Gershgorin bounds of the stiffest and most damped mode of the network:
+	// omega^2 <= 2 k d / m and gamma <= 2 kd d / m for d springs at a point
+	const float scale = 2.0f * m_topology->maxDegree * m_maxInvMass;
+	const float omega2 = scale * m_stiffness;
+	const float gamma = scale * m_damper;
+	if (omega2 <= 0.0f)
+	{
+		return MAX_flt;
+	}
+
+	// symplectic Euler on x'' = -omega^2 x - gamma x' is stable for
+	// h^2 omega^2 + 2 h gamma < 4
+	const float step = (FMath::Sqrt(gamma * gamma + 4.0f * omega2) - gamma) / omega2;
+
+	// RK4 reaches 2.83 / omega on the imaginary axis instead of 2 / omega
+	return m_integrator == ESpringMassIntegrator::RK4 ? step * 1.41f : step;
+}
+
+void
+SpringMassSystem::forEachSpringBatch(TFunctionRef<void(int32, int32)> fn) const
+{
+	const TArray<FIntPoint>& batches = m_sleep.getSpringBatches();
+	const TArray<int32>& groups = m_sleep.getGroupOffsets();
+	if (groups.Num() < 2)
+	{
+		// no topology set yet, no colors and no batches
+		fn(0, getSprings().Num());
+		return;
+	}
+
+	// springs of one color never touch the same mass point, so the batches of
+	// a group can run without synchronising the writes
+	const int32 numColors = groups.Num() - 2;
+	for (int32 c = 0; c < numColors; c++)
+	{
+		const int32 begin = groups[c];
+		const int32 count = groups[c + 1] - begin;
+		if (!m_parallel)
+		{
+			for (int32 i = begin; i < begin + count; i++)
+			{
+				fn(batches[i].X, batches[i].Y);
+			}
+			continue;
+		}
+		ParallelFor(count, [&fn, &batches, begin](int32 i)
+		{
+			fn(batches[begin + i].X, batches[begin + i].Y);
+		});
+	}
+
+	// springs that did not fit into a color group, also covers an uncolored system
+	for (int32 i = groups[numColors]; i < groups[numColors + 1]; i++)
+	{
+		fn(batches[i].X, batches[i].Y);
+	}
+}
+
+void
+SpringMassSystem::forEachPointBatch(TFunctionRef<void(int32, int32)> fn) const
+{
+	const TArray<FIntPoint>& batches = m_sleep.getPointBatches();
+	if (m_sleep.numRegions() == 0)
+	{
+		// no topology set yet
+		fn(0, massPoints.num());
+		return;
+	}
+
+	if (!m_parallel)
+	{
+		for (const FIntPoint& batch : batches)
+		{
+			fn(batch.X, batch.Y);
+		}
+		return;
+	}
+
+	ParallelFor(batches.Num(), [&fn, &batches](int32 i)
+	{
+		fn(batches[i].X, batches[i].Y);
+	});
+}
+
+void
+SpringMassSystem::updateSprings()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpringMassSpringForces);
+	TRACE_CPUPROFILER_EVENT_SCOPE(SpringMassSpringForces);
+
+	const SimdKernels& kernels = SimdKernels::get(m_simdLevel);
+
+	// the stencil covers every spring at once
+	if (m_grid.isInitialized())
+	{
+		m_grid.springForces(massPoints, m_stiffness, m_damper, m_parallel, kernels, m_sleep);
+		return;
+	}
+
+	const TArray<Spring>& springs = getSprings();
+	const TArray<int32>& colorOffsets = getColorOffsets();
+	const int32 tail = colorOffsets.Num() > 0 ? colorOffsets.Last() : 0;
+	forEachSpringBatch([this, &springs, &kernels, tail](int32 first, int32 last)
+	{
+		// the vector kernels need springs without shared mass points
+		if (first >= tail)
+		{
+			for (int32 i = first; i < last; i++)
+			{
+				springs[i].Tick(massPoints, m_stiffness, m_damper);
+			}
+		}
+		else
+		{
+			kernels.springForces(springs.GetData(), first, last, massPoints, m_stiffness, m_damper);
+		}
+	});
+}
@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "MassPoints.h"
+#include "Spring.h"
+#include "SpringMassTopology.h"
+#include "ImplicitSolver.h"
+#include "XPBDSolver.h"
+#include "Integrators.h"
+#include "SimdKernels.h"
+#include "SleepRegions.h"
+#include "ClothCollision.h"
+#include "SelfCollision.h"
+#include "ClothTearing.h"
+#include "StrainLimiter.h"
+#include "GridStencil.h"
+
+#include "SpringMassSystem.generated.h"
+
+UENUM(BlueprintType)
+enum class ESpringMassSolver : uint8
+{
+	// explicit spring forces, needs small fixed timesteps
+	Explicit UMETA(DisplayName = "Explicit Euler"),
+	// backward Euler solved with conjugate gradient, stable for large timesteps
+	Implicit UMETA(DisplayName = "Implicit Euler"),
+	// springs as compliant distance constraints, stable for large timesteps
+	XPBD UMETA(DisplayName = "XPBD"),
+};
+
+UENUM(BlueprintType)
+enum class ESpringMassIntegrator : uint8
+{
+	SymplecticEuler UMETA(DisplayName = "Symplectic Euler"),
+	PositionVerlet UMETA(DisplayName = "Position Verlet"),
+	VelocityVerlet UMETA(DisplayName = "Velocity Verlet"),
+	RK4 UMETA(DisplayName = "Runge-Kutta 4"),
+};
+
+/**
+ * Settings that can change from frame to frame, copied as a whole so they can
+ * be handed to a simulation running on another thread.
+ */
+struct SpringMassSettings
+{
+	bool parallel = true;
+	ESimdLevel simdLevel = ESimdLevel::AVX512;
+	ESpringMassSolver solver = ESpringMassSolver::Explicit;
+	ESpringMassIntegrator integrator = ESpringMassIntegrator::SymplecticEuler;
+	int32 xpbdIterations = 10;
+	bool sleeping = true;
+	float sleepSpeed = 0.05f;
+	float wakeSpeed = 0.2f;
+	float collisionThickness = 1.0f;
+	float collisionFriction = 0.3f;
+	bool selfCollision = false;
+	float selfCollisionThickness = 2.0f;
+	bool tearing = false;
+	float tearStrain = 1.0f;
+	bool strainLimiting = false;
+	float maxStrain = 0.1f;
+
+	bool operator==(const SpringMassSettings& other) const = default;
+};
+
+/**
+ * Mass points, springs and parameters of one spring-mass system together
+ * with the fixed timestep update used by ASpringMassActor. The springs belong
+ * to a SpringMassTopology that systems of the same shape share.
+ */
+class SPRING_MASS_API SpringMassSystem
+{
+public:
+	// mass-spring system data
+	MassPoints massPoints;
+
+	// springs, their colors and the triangles, see SpringMassTopology
+	const SpringMassTopology& getTopology() const { return *m_topology; }
+	// the topology as shared, for what is built from it
+	const SpringMassTopologyRef& getSharedTopology() const { return m_topology; }
+	const TArray<Spring>& getSprings() const { return m_topology->springs; }
+	const TArray<int32>& getColorOffsets() const { return m_topology->colorOffsets; }
+	// springs simulated, also those the stencil evaluates without listing them
+	int32 numSprings() const;
+	// triangles of the cloth, with the corners tearing moved to split points
+	const TArray<uint32>& getTriangles() const { return m_tearing.isInitialized() ? m_tearing.getIndices() : m_topology->indices; }
+
+	// mass-spring system parameters
+	float m_mass = 0.00005f;
+	float m_stiffness = 0.1f;
+	float m_damper = 0.001f;
+	FVector3f m_gravity = FVector3f(0, 0, -9.81f);
+
+	// run the spring and integration passes on worker threads
+	bool m_parallel = true;
+	// instruction set of the explicit spring and integration kernels, clamped to what the CPU supports
+	ESimdLevel m_simdLevel = ESimdLevel::AVX512;
+
+	// time integration scheme used by step
+	ESpringMassSolver m_solver = ESpringMassSolver::Explicit;
+	// integrator of the explicit solver
+	ESpringMassIntegrator m_integrator = ESpringMassIntegrator::SymplecticEuler;
+	ImplicitSolver m_implicit;
+	XPBDSolver m_xpbd;
+	// deactivation of resting regions, explicit solver only
+	SleepRegions m_sleep;
+	// sphere, capsule and plane colliders, resolved after every step
+	ClothCollision m_collision;
+	// repulsion between close parts of the cloth, set up on the first step it is enabled for
+	SelfCollision m_selfCollision;
+	// breaks overstretched springs and splits the cloth, set up on the first step it is enabled for
+	ClothTearing m_tearing;
+	// pulls overstretched springs back after the solver step
+	StrainLimiter m_strainLimiter;
+	// spring forces of a regular lattice without the spring list, set up by
+	// setLattice; the other solvers and features walk the springs, which the
+	// lattice only lists while one of them is enabled
+	GridStencil m_grid;
+
+	// copy the solver settings
+	void applySettings(const SpringMassSettings& settings);
+
+	// use a finalized topology and start from its rest shape, every mass point
+	// with m_mass, then set up the solver data
+	void setTopology(const SpringMassTopologyRef& topology);
+	// the lattice of SpringMassTopology::getLattice with the springs on m_grid
+	void setLattice(int32 rows, int32 cols, float spacing);
+	// topology of this system alone, copied from the shared one on the first
+	// call after setTopology
+	SpringMassTopology& editTopology();
+
+	// the masses were changed from outside, after setTopology
+	void updateMasses();
+
+	// advance the system by one timestep
+	void step(float deltaT);
+
+	// the positions and velocities were replaced from outside: wake every
+	// region and drop the integrator history
+	void restart();
+
+	// add an external force to a mass point and wake its region
+	void addForce(uint32 id, const FVector3f& f);
+
+	// largest timestep the explicit integrator stays stable with for the
+	// current stiffness, damping and masses
+	float estimateStableStep() const;
+
+	// advance the explicit solver by one timestep with a fixed integrator policy
+	template<typename Integrator>
+	void stepExplicit(float deltaT)
+	{
+		Integrator::step(*this, m_integratorState, deltaT);
+	}
+
+	// calculate force between mass points
+	void updateSprings();
+
+	// spring and mass point counts processed by one parallel task
+	static constexpr int32 SpringBatchSize = 512;
+	static constexpr int32 PointBatchSize = 1024;
+
+	// run fn(first, last) over batches of springs, color group by color group.
+	// Batches of one group run in parallel; springs of one batch never share a
+	// mass point, except in batches from colorOffsets.Last() on. Springs
+	// between two sleeping regions are left out.
+	void forEachSpringBatch(TFunctionRef<void(int32, int32)> fn) const;
+	// run fn(first, last) over batches of awake mass points
+	void forEachPointBatch(TFunctionRef<void(int32, int32)> fn) const;
+
+protected:
+	SpringMassTopologyRef m_topology = SpringMassTopology::getEmpty();
+	// m_topology once this system has a copy of its own
+	TSharedPtr<SpringMassTopology, ESPMode::ThreadSafe> m_ownTopology;
+
+	// the lightest mass point, set with the masses
+	float m_maxInvMass = 0.0f;
+	void updateMaxInvMass();
+
+	void initTopology(const SpringMassTopologyRef& topology);
+	// the solver or a feature walks the spring list
+	bool needsSpringList() const;
+	// swap the lattice for the one with or without the spring list, the mass points stay
+	void listLatticeSprings(bool bSprings);
+
+	// history of the explicit integrators and the integrator it belongs to
+	IntegratorState m_integratorState;
+	ESpringMassIntegrator m_stateIntegrator = ESpringMassIntegrator::SymplecticEuler;
+};
@@ -0,0 +1,237 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTopology.h"
+#include "spring_mass.h"
+#include "SleepRegions.h"
+#include "Misc/ScopeLock.h"
+
+
+// shape of a lattice, compared exactly
+struct LatticeKey
+{
+	int32 rows;
+	int32 cols;
+	float spacing;
+	int32 stride;
+	bool bSprings;
+
+	bool operator==(const LatticeKey& other) const
+	{
+		return rows == other.rows && cols == other.cols && spacing == other.spacing && stride == other.stride && bSprings == other.bSprings;
+	}
+};
+
+static uint32
+GetTypeHash(const LatticeKey& key)
+{
+	uint32 bits;
+	FMemory::Memcpy(&bits, &key.spacing, sizeof(bits));
+	return HashCombine(HashCombine(uint32(key.rows), uint32(key.cols)), HashCombine(bits, uint32(key.stride) * 2 + key.bSprings));
+}
+
+static void
+buildLattice(SpringMassTopology& topology, int32 rows, int32 cols, float spacing, int32 stride, bool bSprings)
+{
+	const TArray<int32> columns = SpringMassTopology::latticeLines(cols, stride);
+	const TArray<int32> lines = SpringMassTopology::latticeLines(rows, stride);
+	const int32 numColumns = columns.Num();
+	const int32 numLines = lines.Num();
+
+	// upper row is fixed, the texture spans the whole cloth and v runs downwards
+	for (int32 x : columns)
+	{
+		for (int32 z : lines)
+		{
+			topology.positions.Add(FVector3f(spacing * x, 0, spacing * z));
+			topology.pinned.Add(z == rows - 1);
+			topology.uvs.Add(FVector2f(float(x) / (cols - 1), 1.0f - float(z) / (rows - 1)));
+		}
+	}
+
+	// two triangles per quad
+	for (int32 a = 0; a < numColumns - 1; a++)
+	{
+		for (int32 b = 0; b < numLines - 1; b++)
+		{
+			const uint32 offset = a * numLines + b;
+			topology.indices.Append({ offset, offset + 1, offset + numLines, offset + 1, offset + numLines + 1, offset + numLines });
+		}
+	}
+
+	// the stencil springs reach the eight neighbours of a point
+	if (!bSprings)
+	{
+		const int32 columnDegree = FMath::Min(numLines - 1, 2);
+		topology.maxDegree = FMath::Min(numColumns - 1, 2) * (columnDegree + 1) + columnDegree;
+		return;
+	}
+
+	// east, south east, north east and north of every point, rest lengths from the positions
+	const TArray<FVector3f>& positions = topology.positions;
+	auto connect = [&topology, &positions](int32 p, int32 q)
+	{
+		topology.springs.Add(Spring(p, q, FVector3f::Dist(positions[p], positions[q])));
+	};
+	for (int32 a = 0; a < numColumns; a++)
+	{
+		for (int32 b = 0; b < numLines; b++)
+		{
+			const int32 id = a * numLines + b;
+			if (a < numColumns - 1)
+			{
+				connect(id, id + numLines);
+				if (b > 0)
+				{
+					connect(id, id + numLines - 1);
+				}
+				if (b < numLines - 1)
+				{
+					connect(id, id + numLines + 1);
+				}
+			}
+			if (b < numLines - 1)
+			{
+				connect(id, id + 1);
+			}
+		}
+	}
+	topology.finalize();
+}
+
+void
+SpringMassTopology::colorSprings()
+{
+	// greedy coloring: every spring takes the lowest color not yet used at
+	// either of its mass points, the used colors are kept as a bit mask per point
+	constexpr int32 MaxColors = 64;
+	TArray<uint64> usedColors;
+	usedColors.SetNumZeroed(positions.Num());
+
+	TArray<int32> springColors;
+	springColors.SetNumUninitialized(springs.Num());
+	TArray<int32> counts;
+	counts.SetNumZeroed(MaxColors + 1);
+
+	for (int32 i = 0; i < springs.Num(); i++)
+	{
+		const Spring& s = springs[i];
+		const uint64 used = usedColors[s.m_m1] | usedColors[s.m_m2];
+		// springs at points with more than 64 neighbours end up in the serial tail
+		int32 color = MaxColors;
+		if (~used != 0)
+		{
+			color = (int32)FMath::CountTrailingZeros64(~used);
+			usedColors[s.m_m1] |= uint64(1) << color;
+			usedColors[s.m_m2] |= uint64(1) << color;
+		}
+		springColors[i] = color;
+		counts[color]++;
+	}
+
+	// colors are handed out lowest first, so the used ones are 0 .. numColors - 1
+	int32 numColors = 0;
+	while (numColors < MaxColors && counts[numColors] > 0)
+	{
+		numColors++;
+	}
+
+	// counting sort of the springs by color, the overflow group goes last
+	TArray<int32> cursor;
+	cursor.SetNumUninitialized(MaxColors + 1);
+	int32 offset = 0;
+	for (int32 c = 0; c <= MaxColors; c++)
+	{
+		cursor[c] = offset;
+		offset += counts[c];
+	}
+	colorOffsets.SetNumUninitialized(numColors + 1);
+	for (int32 c = 0; c < numColors; c++)
+	{
+		colorOffsets[c] = cursor[c];
+	}
+	colorOffsets[numColors] = cursor[MaxColors];
+
+	TArray<int32> order;
+	order.SetNumUninitialized(springs.Num());
+	for (int32 i = 0; i < springs.Num(); i++)
+	{
+		order[cursor[springColors[i]]++] = i;
+	}
+	TArray<Spring> sorted;
+	sorted.Reserve(springs.Num());
+	for (int32 i : order)
+	{
+		sorted.Add(springs[i]);
+	}
+	springs = MoveTemp(sorted);
+}
+
+void
+SpringMassTopology::finalize()
+{
+	colorSprings();
+	SleepRegions::sortSprings(springs, colorOffsets);
+
+	TArray<int32> degrees;
+	degrees.SetNumZeroed(positions.Num());
+	maxDegree = 0;
+	for (const Spring& s : springs)
+	{
+		maxDegree = FMath::Max(maxDegree, FMath::Max(++degrees[s.m_m1], ++degrees[s.m_m2]));
+	}
+}
+
+TArray<int32>
+SpringMassTopology::latticeLines(int32 count, int32 stride)
+{
+	TArray<int32> lines;
+	for (int32 i = 0; i < count; i += stride)
+	{
+		lines.Add(i);
+	}
+	if (lines.Num() > 0 && lines.Last() != count - 1)
+	{
+		lines.Add(count - 1);
+	}
+	return lines;
+}
+
+SpringMassTopologyRef
+SpringMassTopology::getLattice(int32 rows, int32 cols, float spacing, int32 stride, bool bSprings)
+{
+	// actors are constructed on the loading threads too. The map only holds
+	// weak pointers, a lattice goes away with the last system using it
+	static FCriticalSection lock;
+	static TMap<LatticeKey, TWeakPtr<const SpringMassTopology, ESPMode::ThreadSafe>> lattices;
+	FScopeLock scope(&lock);
+
+	TArray<LatticeKey> expired;
+	for (const auto& lattice : lattices)
+	{
+		if (!lattice.Value.IsValid())
+		{
+			expired.Add(lattice.Key);
+		}
+	}
+	for (const LatticeKey& key : expired)
+	{
+		lattices.Remove(key);
+	}
+
+	TWeakPtr<const SpringMassTopology, ESPMode::ThreadSafe>& cached = lattices.FindOrAdd(LatticeKey{ rows, cols, spacing, stride, bSprings });
+	if (TSharedPtr<const SpringMassTopology, ESPMode::ThreadSafe> shared = cached.Pin())
+	{
+		return shared.ToSharedRef();
+	}
+	TSharedRef<SpringMassTopology, ESPMode::ThreadSafe> topology = MakeShared<SpringMassTopology, ESPMode::ThreadSafe>();
+	buildLattice(*topology, rows, cols, spacing, stride, bSprings);
+	cached = topology;
+	return topology;
+}
+
+SpringMassTopologyRef
+SpringMassTopology::getEmpty()
+{
+	static const SpringMassTopologyRef empty = MakeShared<SpringMassTopology, ESPMode::ThreadSafe>();
+	return empty;
+}
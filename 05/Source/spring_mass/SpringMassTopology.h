@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Spring.h"
+
+class SpringMassTopology;
+// topologies are read only once shared
+typedef TSharedRef<const SpringMassTopology, ESPMode::ThreadSafe> SpringMassTopologyRef;
+
+/**
+ * What spring-mass systems of the same shape have in common: the rest
+ * positions and pinned points, the springs with their rest lengths sorted by
+ * color, and the triangles and texture coordinates of the mesh.
+ *
+ * Built once and shared read only, so a level full of identical flags keeps
+ * one copy and every SpringMassSystem only holds the state of its mass
+ * points. Lattices of the same shape find each other through getLattice while
+ * any system still uses theirs. A system that edits its springs, e.g. while
+ * it tears, takes a copy of its own first.
+ */
+class SPRING_MASS_API SpringMassTopology
+{
+public:
+	// rest shape, pinned points do not move
+	TArray<FVector3f> positions;
+	TArray<uint8> pinned;
+
+	// springs are sorted by color, color c spans [colorOffsets[c], colorOffsets[c + 1]),
+	// no two springs of one color share a mass point. Within a color they are
+	// sorted by the sleep regions they connect
+	TArray<Spring> springs;
+	TArray<int32> colorOffsets;
+	// most springs at one mass point
+	int32 maxDegree = 0;
+
+	// triangles and texture coordinates of the mesh
+	TArray<uint32> indices;
+	TArray<FVector2f> uvs;
+
+	// color and sort the springs, call after all springs are added
+	void finalize();
+
+	// partition springs into conflict-free color groups
+	void colorSprings();
+
+	// the lattice of ASpringMassActor: mass point x * rows + z in column x and
+	// row z, spacing apart, with stretch and shear springs and the top row
+	// pinned. A stride above 1 keeps every stride-th column and row and the
+	// last ones, like the coarse level of SpringMassLod. Without bSprings the
+	// springs are left to GridStencil and not listed
+	static SpringMassTopologyRef getLattice(int32 rows, int32 cols, float spacing, int32 stride = 1, bool bSprings = true);
+
+	// every stride-th of count lines and the last one
+	static TArray<int32> latticeLines(int32 count, int32 stride);
+
+	// no points, springs or triangles
+	static SpringMassTopologyRef getEmpty();
+};
@@ -0,0 +1,383 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringNetwork.h"
+#include "spring_mass.h"
+#include "SpatialHash.h"
+#include "Algo/Sort.h"
+
+
+// both orders of a pair give the same key
+static uint64
+pairKey(int32 a, int32 b)
+{
+	return a < b ? (uint64(a) << 32) | uint32(b) : (uint64(b) << 32) | uint32(a);
+}
+
+// the triangles on both sides of an edge
+struct EdgeSides
+{
+	// corners opposite to the edge in its first two triangles
+	int32 opposite[2] = { INDEX_NONE, INDEX_NONE };
+	int32 triangles = 0;
+	// clearly the longest edge of all its triangles
+	bool bLongest = true;
+};
+
+// an edge this much longer than the other two of its triangle is a quad diagonal
+static constexpr float DiagonalRatio = 1.1f;
+
+// the low 21 bits of v moved to every third bit
+static uint64
+spreadBits(uint32 v)
+{
+	uint64 x = v & 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffffull;
+	x = (x | x << 16) & 0x1f0000ff0000ffull;
+	x = (x | x << 8) & 0x100f00f00f00f00full;
+	x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+	x = (x | x << 2) & 0x1249249249249249ull;
+	return x;
+}
+
+int32
+SpringNetworkBuilder::weld(const TArray<FVector3f>& positions, TArray<int32>& remap) const
+{
+	SpatialHash hash;
+	hash.build(positions, FMath::Max(m_weldDistance, KINDA_SMALL_NUMBER), true);
+
+	// greedy, a vertex takes the unwelded vertices around it
+	const float distance2 = m_weldDistance * m_weldDistance;
+	const FVector3f range(m_weldDistance);
+	remap.Init(INDEX_NONE, positions.Num());
+	int32 count = 0;
+	for (int32 i = 0; i < positions.Num(); i++)
+	{
+		if (remap[i] != INDEX_NONE)
+		{
+			continue;
+		}
+		remap[i] = count;
+		const FVector3f& p = positions[i];
+		hash.forEachPointNear(p - range, p + range, [&](int32 j)
+		{
+			if (j > i && remap[j] == INDEX_NONE && FVector3f::DistSquared(p, positions[j]) <= distance2)
+			{
+				remap[j] = count;
+			}
+		});
+		count++;
+	}
+	return count;
+}
+
+void
+SpringNetworkBuilder::build(const TArray<FVector3f>& positions, const TArray<uint32>& indices, const TArray<FVector2f>& uvs, SpringNetwork& network) const
+{
+	TArray<int32> remap;
+	const int32 numPoints = weld(positions, remap);
+
+	// the first vertex of every point gives its position and UV
+	network.positions.SetNumUninitialized(numPoints);
+	network.uvs.SetNumUninitialized(numPoints);
+	TBitArray<> placed(false, numPoints);
+	for (int32 v = 0; v < positions.Num(); v++)
+	{
+		const int32 p = remap[v];
+		if (!placed[p])
+		{
+			placed[p] = true;
+			network.positions[p] = positions[v];
+			network.uvs[p] = uvs.IsValidIndex(v) ? uvs[v] : FVector2f::ZeroVector;
+		}
+	}
+
+	// triangles between the welded points, without the collapsed ones and
+	// the back faces of double sided meshes
+	network.indices.Reset(indices.Num());
+	TSet<FIntVector> faces;
+	faces.Reserve(indices.Num() / 3);
+	TMap<uint64, EdgeSides> edges;
+	edges.Reserve(indices.Num() / 2 + 1);
+	for (int32 k = 0; k + 2 < indices.Num(); k += 3)
+	{
+		int32 corners[3] = { remap[indices[k]], remap[indices[k + 1]], remap[indices[k + 2]] };
+		if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0])
+		{
+			continue;
+		}
+		int32 sorted[3] = { corners[0], corners[1], corners[2] };
+		Algo::Sort(sorted);
+		bool bAlreadyInSet = false;
+		faces.Add(FIntVector(sorted[0], sorted[1], sorted[2]), &bAlreadyInSet);
+		if (bAlreadyInSet)
+		{
+			continue;
+		}
+		network.indices.Append({ uint32(corners[0]), uint32(corners[1]), uint32(corners[2]) });
+
+		float lengths[3];
+		for (int32 e = 0; e < 3; e++)
+		{
+			lengths[e] = FVector3f::Dist(network.positions[corners[e]], network.positions[corners[(e + 1) % 3]]);
+		}
+		for (int32 e = 0; e < 3; e++)
+		{
+			EdgeSides& sides = edges.FindOrAdd(pairKey(corners[e], corners[(e + 1) % 3]));
+			if (sides.triangles < 2)
+			{
+				sides.opposite[sides.triangles] = corners[(e + 2) % 3];
+			}
+			sides.triangles++;
+			sides.bLongest &= lengths[e] > DiagonalRatio * FMath::Max(lengths[(e + 1) % 3], lengths[(e + 2) % 3]);
+		}
+	}
+
+	// springs by kind, edges are unique already, the pairs of opposite
+	// corners may repeat an edge or each other
+	network.springs.Reset(edges.Num() * 2);
+	TSet<uint64> opposites;
+	opposites.Reserve(edges.Num());
+	auto connect = [&network](int32 a, int32 b)
+	{
+		network.springs.Add(Spring(a, b, FVector3f::Dist(network.positions[a], network.positions[b])));
+	};
+	auto connectOpposite = [&](const EdgeSides& sides)
+	{
+		const uint64 key = pairKey(sides.opposite[0], sides.opposite[1]);
+		bool bAlreadyInSet = false;
+		opposites.Add(key, &bAlreadyInSet);
+		if (!bAlreadyInSet && !edges.Contains(key))
+		{
+			connect(sides.opposite[0], sides.opposite[1]);
+		}
+	};
+	auto isDiagonal = [](const EdgeSides& sides)
+	{
+		return sides.triangles == 2 && sides.bLongest;
+	};
+
+	for (const TPair<uint64, EdgeSides>& edge : edges)
+	{
+		if (!isDiagonal(edge.Value))
+		{
+			connect(int32(edge.Key >> 32), int32(edge.Key & 0xffffffffu));
+		}
+	}
+	network.numStructural = network.springs.Num();
+
+	if (m_shear)
+	{
+		for (const TPair<uint64, EdgeSides>& edge : edges)
+		{
+			if (isDiagonal(edge.Value))
+			{
+				connect(int32(edge.Key >> 32), int32(edge.Key & 0xffffffffu));
+				connectOpposite(edge.Value);
+			}
+		}
+	}
+	network.numShear = network.springs.Num() - network.numStructural;
+
+	if (m_bending)
+	{
+		for (const TPair<uint64, EdgeSides>& edge : edges)
+		{
+			if (edge.Value.triangles == 2 && !isDiagonal(edge.Value))
+			{
+				connectOpposite(edge.Value);
+			}
+		}
+	}
+	network.numBending = network.springs.Num() - network.numStructural - network.numShear;
+
+	// pinned along the pin direction
+	network.pinned.Reset();
+	const FVector3f direction = m_pinDirection.GetSafeNormal();
+	if (!direction.IsZero() && numPoints > 0)
+	{
+		float extreme = -MAX_flt;
+		for (const FVector3f& p : network.positions)
+		{
+			extreme = FMath::Max(extreme, p | direction);
+		}
+		for (int32 p = 0; p < numPoints; p++)
+		{
+			if ((network.positions[p] | direction) >= extreme - m_pinDistance)
+			{
+				network.pinned.Add(p);
+			}
+		}
+	}
+
+	if (m_order != ESpringNetworkOrder::None)
+	{
+		TArray<int32> newToOld;
+		order(network, newToOld);
+		TArray<int32> oldToNew;
+		oldToNew.SetNumUninitialized(numPoints);
+		for (int32 i = 0; i < numPoints; i++)
+		{
+			oldToNew[newToOld[i]] = i;
+		}
+		renumber(oldToNew, network);
+	}
+}
+
+void
+SpringNetworkBuilder::order(const SpringNetwork& network, TArray<int32>& newToOld) const
+{
+	const int32 n = network.positions.Num();
+	newToOld.Reset(n);
+
+	if (m_order == ESpringNetworkOrder::Morton)
+	{
+		// 21 bits per axis, the same scale on all of them keeps the curve square
+		const FBox3f bounds(network.positions);
+		const float scale = 2097151.0f / FMath::Max(bounds.GetSize().GetMax(), KINDA_SMALL_NUMBER);
+		TArray<uint64> codes;
+		codes.SetNumUninitialized(n);
+		for (int32 p = 0; p < n; p++)
+		{
+			const FVector3f cell = (network.positions[p] - bounds.Min) * scale;
+			codes[p] = spreadBits(uint32(cell.X)) | spreadBits(uint32(cell.Y)) << 1 | spreadBits(uint32(cell.Z)) << 2;
+			newToOld.Add(p);
+		}
+		Algo::Sort(newToOld, [&codes](int32 a, int32 b)
+		{
+			return codes[a] != codes[b] ? codes[a] < codes[b] : a < b;
+		});
+		return;
+	}
+
+	// neighbours through the springs in CSR form
+	TArray<int32> offsets;
+	offsets.Init(0, n + 1);
+	for (const Spring& s : network.springs)
+	{
+		offsets[s.m_m1 + 1]++;
+		offsets[s.m_m2 + 1]++;
+	}
+	for (int32 p = 0; p < n; p++)
+	{
+		offsets[p + 1] += offsets[p];
+	}
+	TArray<int32> cursor = offsets;
+	TArray<int32> neighbours;
+	neighbours.SetNumUninitialized(offsets[n]);
+	for (const Spring& s : network.springs)
+	{
+		neighbours[cursor[s.m_m1]++] = s.m_m2;
+		neighbours[cursor[s.m_m2]++] = s.m_m1;
+	}
+	auto degree = [&offsets](int32 p)
+	{
+		return offsets[p + 1] - offsets[p];
+	};
+
+	// breadth first through the component of start, returns the lowest degree
+	// point of the last level
+	TArray<int32> stamps;
+	stamps.Init(INDEX_NONE, n);
+	int32 search = 0;
+	TArray<int32> queue;
+	queue.Reserve(n);
+	auto farthest = [&](int32 start)
+	{
+		search++;
+		queue.Reset();
+		queue.Add(start);
+		stamps[start] = search;
+		int32 level = 0;
+		for (int32 head = 0; head < queue.Num();)
+		{
+			level = head;
+			for (const int32 end = queue.Num(); head < end; head++)
+			{
+				for (int32 k = offsets[queue[head]]; k < offsets[queue[head] + 1]; k++)
+				{
+					if (stamps[neighbours[k]] != search)
+					{
+						stamps[neighbours[k]] = search;
+						queue.Add(neighbours[k]);
+					}
+				}
+			}
+		}
+		int32 best = queue[level];
+		for (int32 i = level; i < queue.Num(); i++)
+		{
+			best = degree(queue[i]) < degree(best) ? queue[i] : best;
+		}
+		return best;
+	};
+
+	// Cuthill-McKee from a point at the rim of every component, each point
+	// appends its unplaced neighbours by ascending degree
+	TBitArray<> placed(false, n);
+	for (int32 p = 0; p < n; p++)
+	{
+		if (placed[p])
+		{
+			continue;
+		}
+		// two sweeps of George and Liu find a point of nearly the largest eccentricity
+		const int32 start = farthest(farthest(p));
+		placed[start] = true;
+		newToOld.Add(start);
+		for (int32 head = newToOld.Num() - 1; head < newToOld.Num(); head++)
+		{
+			const int32 q = newToOld[head];
+			const int32 begin = newToOld.Num();
+			for (int32 k = offsets[q]; k < offsets[q + 1]; k++)
+			{
+				if (!placed[neighbours[k]])
+				{
+					placed[neighbours[k]] = true;
+					newToOld.Add(neighbours[k]);
+				}
+			}
+			Algo::Sort(MakeArrayView(newToOld.GetData() + begin, newToOld.Num() - begin), [&degree](int32 a, int32 b)
+			{
+				return degree(a) != degree(b) ? degree(a) < degree(b) : a < b;
+			});
+		}
+	}
+
+	// reversed, the same bandwidth with a smaller profile
+	for (int32 i = 0, j = n - 1; i < j; i++, j--)
+	{
+		Swap(newToOld[i], newToOld[j]);
+	}
+}
+
+void
+SpringNetworkBuilder::renumber(const TArray<int32>& oldToNew, SpringNetwork& network)
+{
+	const int32 n = network.positions.Num();
+	TArray<FVector3f> positions;
+	TArray<FVector2f> uvs;
+	positions.SetNumUninitialized(n);
+	uvs.SetNumUninitialized(n);
+	for (int32 p = 0; p < n; p++)
+	{
+		positions[oldToNew[p]] = network.positions[p];
+		uvs[oldToNew[p]] = network.uvs[p];
+	}
+	network.positions = MoveTemp(positions);
+	network.uvs = MoveTemp(uvs);
+
+	for (uint32& index : network.indices)
+	{
+		index = oldToNew[index];
+	}
+	for (Spring& s : network.springs)
+	{
+		s.m_m1 = oldToNew[s.m_m1];
+		s.m_m2 = oldToNew[s.m_m2];
+	}
+	for (uint32& p : network.pinned)
+	{
+		p = oldToNew[p];
+	}
+	Algo::Sort(network.pinned);
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Spring.h"
+
+#include "SpringNetwork.generated.h"
+
+UENUM(BlueprintType)
+enum class ESpringNetworkOrder : uint8
+{
+	// points in the order their first vertex appears in the mesh
+	None UMETA(DisplayName = "Mesh Order"),
+	// reverse Cuthill-McKee, springs connect points with close indices
+	ReverseCuthillMcKee UMETA(DisplayName = "Reverse Cuthill-McKee"),
+	// Z-order curve through the bounds, close points have close indices
+	Morton UMETA(DisplayName = "Morton"),
+};
+
+/**
+ * Mass points, springs and render triangles built from a triangle mesh.
+ * The springs are ordered by kind: structural, then shear, then bending.
+ */
+struct SPRING_MASS_API SpringNetwork
+{
+	TArray<FVector3f> positions;
+	TArray<FVector2f> uvs;
+	TArray<uint32> indices;
+	TArray<Spring> springs;
+	// mass points that do not move
+	TArray<uint32> pinned;
+
+	int32 numStructural = 0;
+	int32 numShear = 0;
+	int32 numBending = 0;
+};
+
+/**
+ * Turns any triangle mesh into a spring network.
+ *
+ * Vertices closer than m_weldDistance are welded into one mass point, so
+ * vertices split at UV seams or hard edges do not tear the cloth apart; the
+ * welded point keeps the UV of its first vertex. Edges are deduplicated
+ * through a hash map that also records the corners opposite to every edge.
+ *
+ * Edges become structural springs, except the diagonals of quads: an edge
+ * shared by two triangles that is the longest edge of both. A diagonal and the
+ * spring between its two opposite corners are the shear springs of the quad.
+ * The corners opposite to any other edge are connected by a bending spring.
+ * On the generated grid this gives the springs the actor always created plus
+ * one bending spring per structural edge.
+ *
+ * The points are then renumbered in m_order, so that the two ends of a spring
+ * and the points of a sleep region lie close in memory. The triangles refer
+ * to the renumbered points.
+ */
+class SPRING_MASS_API SpringNetworkBuilder
+{
+public:
+	// vertices closer than this are one mass point
+	float m_weldDistance = 0.01f;
+	bool m_shear = true;
+	bool m_bending = true;
+	// points within m_pinDistance of the extreme of the mesh along m_pinDirection are pinned
+	FVector3f m_pinDirection = FVector3f(0, 0, 1);
+	float m_pinDistance = 0.5f;
+	// numbering of the points
+	ESpringNetworkOrder m_order = ESpringNetworkOrder::ReverseCuthillMcKee;
+
+	// build the network of a triangle list, uvs may be empty
+	void build(const TArray<FVector3f>& positions, const TArray<uint32>& indices, const TArray<FVector2f>& uvs, SpringNetwork& network) const;
+
+protected:
+	// index of the welded point of every vertex, returns the number of points
+	int32 weld(const TArray<FVector3f>& positions, TArray<int32>& remap) const;
+	// old index of every point in m_order
+	void order(const SpringNetwork& network, TArray<int32>& newToOld) const;
+	// renumber the points of network, the point at i moves to oldToNew[i]
+	static void renumber(const TArray<int32>& oldToNew, SpringNetwork& network);
+};
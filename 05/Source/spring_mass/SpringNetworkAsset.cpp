@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringNetworkAsset.h"
+#include "spring_mass.h"
+#include "SpringNetwork.h"
+#include "StaticMeshResources.h"
+
+
+void
+USpringNetworkAsset::Build()
+{
+	// the render data of the first LOD, in the editor it always has CPU copies
+	const FStaticMeshRenderData* renderData = SourceMesh ? SourceMesh->GetRenderData() : nullptr;
+	if (!renderData || renderData->LODResources.Num() == 0)
+	{
+		return;
+	}
+	const FStaticMeshLODResources& resources = renderData->LODResources[0];
+	const FPositionVertexBuffer& vertices = resources.VertexBuffers.PositionVertexBuffer;
+	const FStaticMeshVertexBuffer& attributes = resources.VertexBuffers.StaticMeshVertexBuffer;
+
+	const int32 numVertices = vertices.GetNumVertices();
+	TArray<FVector3f> positions;
+	TArray<FVector2f> uvs;
+	positions.SetNumUninitialized(numVertices);
+	uvs.SetNumZeroed(numVertices);
+	for (int32 v = 0; v < numVertices; v++)
+	{
+		positions[v] = vertices.VertexPosition(v);
+		if (attributes.GetNumTexCoords() > 0)
+		{
+			uvs[v] = attributes.GetVertexUV(v, 0);
+		}
+	}
+	TArray<uint32> indices;
+	resources.IndexBuffer.GetCopy(indices);
+
+	SpringNetworkBuilder builder;
+	builder.m_weldDistance = WeldDistance;
+	builder.m_order = PointOrder;
+	builder.m_shear = bShearSprings;
+	builder.m_bending = bBendingSprings;
+	builder.m_pinDirection = FVector3f(PinDirection);
+	builder.m_pinDistance = PinDistance;
+
+	SpringNetwork network;
+	builder.build(positions, indices, uvs, network);
+	setNetwork(network);
+}
+
+void
+USpringNetworkAsset::setNetwork(const SpringNetwork& network)
+{
+	Positions = network.positions;
+	UVs = network.uvs;
+	Indices = network.indices;
+	PinnedPoints = network.pinned;
+	// systems loaded before keep the old one
+	CachedTopology.Reset();
+
+	SpringPoints.SetNumUninitialized(network.springs.Num());
+	RestLengths.SetNumUninitialized(network.springs.Num());
+	for (int32 s = 0; s < network.springs.Num(); s++)
+	{
+		const Spring& spring = network.springs[s];
+		SpringPoints[s] = FIntPoint(spring.m_m1, spring.m_m2);
+		RestLengths[s] = spring.m_spring_length_init;
+	}
+
+	NumStructuralSprings = network.numStructural;
+	NumShearSprings = network.numShear;
+	NumBendingSprings = network.numBending;
+	MarkPackageDirty();
+}
+
+SpringMassTopologyRef
+USpringNetworkAsset::getTopology() const
+{
+	// game thread only, like loading the asset
+	if (CachedTopology.IsValid())
+	{
+		return CachedTopology.ToSharedRef();
+	}
+
+	TSharedRef<SpringMassTopology, ESPMode::ThreadSafe> topology = MakeShared<SpringMassTopology, ESPMode::ThreadSafe>();
+	topology->positions = Positions;
+	topology->pinned.Init(0, Positions.Num());
+	for (uint32 p : PinnedPoints)
+	{
+		topology->pinned[p] = 1;
+	}
+	topology->springs.Reserve(SpringPoints.Num());
+	for (int32 s = 0; s < SpringPoints.Num(); s++)
+	{
+		topology->springs.Add(Spring(SpringPoints[s].X, SpringPoints[s].Y, RestLengths[s]));
+	}
+	topology->indices = Indices;
+	topology->uvs = UVs;
+	topology->finalize();
+
+	CachedTopology = topology;
+	return topology;
+}
+
+#if WITH_EDITOR
+void
+USpringNetworkAsset::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// the build takes a fraction of a second even for large meshes
+	Build();
+}
+#endif
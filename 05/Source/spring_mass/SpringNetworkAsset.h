@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SpringNetwork.h"
+#include "SpringMassTopology.h"
+
+#include "Engine/DataAsset.h"
+
+#include "SpringNetworkAsset.generated.h"
+
+class UStaticMesh;
+
+/**
+ * Spring network of a static mesh, built in the editor and saved with the
+ * asset, so loading a cloth neither welds nor hashes anything and the mesh
+ * needs no CPU access at runtime.
+ *
+ * Meshes from other sources, e.g. procedural ones, go through
+ * SpringNetworkBuilder and setNetwork.
+ */
+UCLASS(BlueprintType)
+class SPRING_MASS_API USpringNetworkAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// Mesh the network is built from, its first LOD
+	UPROPERTY(EditAnywhere, Category = "Source")
+	UStaticMesh* SourceMesh = nullptr;
+
+	// Vertices closer than this are welded into one mass point
+	UPROPERTY(EditAnywhere, Category = "Source", meta = (ClampMin = "0.0"))
+	float WeldDistance = 0.01f;
+
+	// Numbering of the mass points, orders other than the mesh's keep the springs of large meshes cache friendly
+	UPROPERTY(EditAnywhere, Category = "Source")
+	ESpringNetworkOrder PointOrder = ESpringNetworkOrder::ReverseCuthillMcKee;
+
+	// Connect the corners of quads diagonally
+	UPROPERTY(EditAnywhere, Category = "Springs")
+	bool bShearSprings = true;
+
+	// Connect the corners opposite to each edge, keeps the cloth from folding freely
+	UPROPERTY(EditAnywhere, Category = "Springs")
+	bool bBendingSprings = true;
+
+	// Points within PinDistance of the extreme of the mesh along this direction do not move
+	UPROPERTY(EditAnywhere, Category = "Springs")
+	FVector PinDirection = FVector(0, 0, 1);
+
+	// Distance from the extreme along PinDirection within which points are pinned
+	UPROPERTY(EditAnywhere, Category = "Springs", meta = (ClampMin = "0.0"))
+	float PinDistance = 0.5f;
+
+	// Rebuild the network from SourceMesh
+	UFUNCTION(CallInEditor, Category = "Source")
+	void Build();
+
+	// replace the network with one built elsewhere
+	void setNetwork(const SpringNetwork& network);
+
+	bool isBuilt() const { return Positions.Num() > 0; }
+
+	// mass points, springs, triangles and UVs, built on first use and shared
+	// by every system loaded from this asset
+	SpringMassTopologyRef getTopology() const;
+
+	//~ Begin UObject Interface
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	//~ End UObject Interface
+
+	// Springs of the built network by kind
+	UPROPERTY(VisibleAnywhere, Category = "Network")
+	int32 NumStructuralSprings = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "Network")
+	int32 NumShearSprings = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "Network")
+	int32 NumBendingSprings = 0;
+
+protected:
+	UPROPERTY()
+	TArray<FVector3f> Positions;
+
+	UPROPERTY()
+	TArray<FVector2f> UVs;
+
+	UPROPERTY()
+	TArray<uint32> Indices;
+
+	// mass points and rest length of every spring
+	UPROPERTY()
+	TArray<FIntPoint> SpringPoints;
+
+	UPROPERTY()
+	TArray<float> RestLengths;
+
+	UPROPERTY()
+	TArray<uint32> PinnedPoints;
+
+	// the network above, colored and sorted
+	mutable TSharedPtr<const SpringMassTopology, ESPMode::ThreadSafe> CachedTopology;
+};
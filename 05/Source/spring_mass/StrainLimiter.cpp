@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "StrainLimiter.h"
+#include "spring_mass.h"
+#include "SpringMassSystem.h"
+
+#include <atomic>
+
+
+void
+StrainLimiter::apply(SpringMassSystem& system, float deltaT) const
+{
+	MassPoints& points = system.massPoints;
+	const SleepRegions& sleep = system.m_sleep;
+	const bool bSleeping = sleep.numAsleep() > 0;
+	const float maxStretch = 1.0f + m_maxStrain;
+	const float invDeltaT = 1.0f / deltaT;
+
+	const TArray<Spring>& springs = system.getSprings();
+	std::atomic<bool> bCorrected{ true };
+	for (int32 iteration = 0; iteration < m_maxIterations && bCorrected; iteration++)
+	{
+		bCorrected = false;
+		system.forEachSpringBatch([&springs, &points, &sleep, bSleeping, maxStretch, invDeltaT, &bCorrected](int32 first, int32 last)
+		{
+			for (int32 i = first; i < last; i++)
+			{
+				const Spring& s = springs[i];
+				const float maxLength = maxStretch * s.m_spring_length_init;
+				const FVector3f m2m1 = points.positions[s.m_m1] - points.positions[s.m_m2];
+				const float length2 = m2m1.SizeSquared();
+				if (length2 <= maxLength * maxLength)
+				{
+					continue;
+				}
+
+				// a spring to a sleeping region only pulls its awake end
+				float w1 = points.invMasses[s.m_m1];
+				float w2 = points.invMasses[s.m_m2];
+				if (bSleeping)
+				{
+					w1 = sleep.isAsleep(s.m_m1 / SleepRegions::RegionSize) ? 0.0f : w1;
+					w2 = sleep.isAsleep(s.m_m2 / SleepRegions::RegionSize) ? 0.0f : w2;
+				}
+				const float w = w1 + w2;
+				if (w <= 0.0f)
+				{
+					continue;
+				}
+
+				const float length = FMath::Sqrt(length2);
+				const FVector3f correction = m2m1 * ((length - maxLength) / (length * w));
+				const FVector3f d1 = -w1 * correction;
+				const FVector3f d2 = w2 * correction;
+				points.positions[s.m_m1] += d1;
+				points.positions[s.m_m2] += d2;
+				points.velocities[s.m_m1] += d1 * invDeltaT;
+				points.velocities[s.m_m2] += d2 * invDeltaT;
+				bCorrected.store(true, std::memory_order_relaxed);
+			}
+		});
+	}
+}
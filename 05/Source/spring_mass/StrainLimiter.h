@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class SpringMassSystem;
+
+/**
+ * Provot's strain limiting: after the solver moved the points, springs
+ * stretched past (1 + m_maxStrain) times their rest length are pulled back to
+ * it. Both ends move along the spring in proportion to their inverse masses,
+ * pinned and sleeping points stay where they are, and the velocities take the
+ * correction too so the next step does not undo it.
+ *
+ * The limit keeps soft springs from stretching without end, so cloth can look
+ * stiff with a stiffness and timestep the explicit solver stays stable with.
+ * The springs are swept color group by color group, in parallel within a
+ * group. A spring corrected early may be stretched again by a later color, so
+ * the sweep repeats until it corrects nothing or m_maxIterations ran out. A
+ * limit below the tear strain keeps the cloth whole.
+ */
+class SPRING_MASS_API StrainLimiter
+{
+public:
+	bool m_enabled = false;
+	// strain springs are limited to, 0.1 allows 10% stretch
+	float m_maxStrain = 0.1f;
+	// most sweeps over the springs per step
+	int32 m_maxIterations = 4;
+
+	// call after the solver step, before the collisions
+	void apply(SpringMassSystem& system, float deltaT) const;
+};
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SubstepScheduler.h"
+#include "spring_mass.h"
+
+
+int32
+SubstepScheduler::beginFrame(float frameTime, float step)
+{
+	m_step = step;
+	float accumulated = m_deltaTimeRemaining + frameTime;
+	const int32 wanted = FMath::FloorToInt(accumulated / step);
+
+	// substeps we can afford, at least one so the simulation never stalls
+	int32 allowed = m_maxSubsteps;
+	if (m_substepCost > 0.0)
+	{
+		allowed = FMath::Min(allowed, FMath::Max(1, int32(m_budget / m_substepCost)));
+	}
+
+	const int32 substeps = FMath::Min(wanted, allowed);
+	accumulated -= substeps * step;
+
+	// drop whole steps we could not afford, keep the fraction for the next frame
+	m_droppedLastFrame = (wanted - substeps) * step;
+	accumulated -= m_droppedLastFrame;
+	m_droppedTotal += m_droppedLastFrame;
+
+	m_deltaTimeRemaining = FMath::Max(0.0f, accumulated);
+	return substeps;
+}
+
+float
+SubstepScheduler::beginFrameSingleStep(float frameTime, float maxStep)
+{
+	m_step = FMath::Min(frameTime, maxStep);
+	m_droppedLastFrame = frameTime - m_step;
+	m_droppedTotal += m_droppedLastFrame;
+	m_deltaTimeRemaining = 0.0f;
+	return m_step;
+}
+
+void
+SubstepScheduler::endFrame(double seconds, int32 substeps)
+{
+	if (substeps <= 0)
+	{
+		return;
+	}
+
+	// exponential moving average, so a single slow frame does not halve the next one
+	const double cost = seconds / substeps;
+	m_substepCost = m_substepCost > 0.0 ? FMath::Lerp(m_substepCost, cost, 0.1) : cost;
+}
+
+void
+SubstepScheduler::reset()
+{
+	m_step = 0.0f;
+	m_deltaTimeRemaining = 0.0f;
+	m_droppedLastFrame = 0.0f;
+	m_droppedTotal = 0.0;
+	m_substepCost = 0.0;
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Decides how many fixed substeps a frame simulates.
+ *
+ * Frame time is accumulated and consumed in steps of the requested size, but
+ * never more than m_maxSubsteps or than fit into m_budget given the measured
+ * cost of a substep. Time beyond that is dropped instead of carried over, so
+ * a single long frame cannot make the following frames long as well.
+ */
+class SPRING_MASS_API SubstepScheduler
+{
+public:
+	// hard limit of substeps per frame
+	int32 m_maxSubsteps = 16;
+	// wall clock seconds the substeps of one frame may take
+	float m_budget = 0.002f;
+
+	// accumulate frameTime and return the number of substeps of length step to run
+	int32 beginFrame(float frameTime, float step);
+	// for unconditionally stable solvers: return the length of the single step to run
+	float beginFrameSingleStep(float frameTime, float maxStep);
+	// report the wall clock time the substeps of this frame took
+	void endFrame(double seconds, int32 substeps);
+
+	// step length of the current frame
+	float getStep() const { return m_step; }
+	// time not simulated in last tick, carried over to the next one
+	float getRemaining() const { return m_deltaTimeRemaining; }
+	// simulation time dropped by the last frame and since the start
+	float getDroppedLastFrame() const { return m_droppedLastFrame; }
+	double getDroppedTotal() const { return m_droppedTotal; }
+	// smoothed wall clock cost of one substep in seconds
+	double getSubstepCost() const { return m_substepCost; }
+
+	// forget carried over time and cost history
+	void reset();
+
+protected:
+	float m_step = 0.0f;
+	float m_deltaTimeRemaining = 0.0f;
+	float m_droppedLastFrame = 0.0f;
+	double m_droppedTotal = 0.0;
+	double m_substepCost = 0.0;
+};
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "XPBDSolver.h"
+#include "spring_mass.h"
+#include "SpringMassSystem.h"
+
+
+void
+XPBDSolver::init(const SpringMassSystem& system)
+{
+	m_prevPositions.SetNumUninitialized(system.massPoints.num());
+	m_lambdas.SetNumUninitialized(system.getSprings().Num());
+	m_initialized = true;
+}
+
+void
+XPBDSolver::reset()
+{
+	m_prevPositions.Empty();
+	m_lambdas.Empty();
+	m_initialized = false;
+}
+
+void
+XPBDSolver::step(SpringMassSystem& system, float deltaT)
+{
+	MassPoints& points = system.massPoints;
+
+	// predict positions from external forces and gravity
+	system.forEachPointBatch([this, &system, &points, deltaT](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			m_prevPositions[i] = points.positions[i];
+			if (!points.pinned[i])
+			{
+				points.velocities[i] += (system.m_gravity + points.forces[i] * points.invMasses[i]) * deltaT;
+				points.positions[i] += points.velocities[i] * deltaT;
+			}
+			points.forces[i] = FVector3f::ZeroVector;
+		}
+	});
+
+	// compliance alpha = 1 / k, scaled by 1 / h^2; the damping follows
+	// XPBD's gamma = alpha~ * beta~ / h with beta~ = h^2 * kd
+	const float alpha = system.m_stiffness > 0.0f ? 1.0f / (system.m_stiffness * deltaT * deltaT) : 0.0f;
+	const float gamma = system.m_stiffness > 0.0f ? system.m_damper / (system.m_stiffness * deltaT) : 0.0f;
+
+	FMemory::Memzero(m_lambdas.GetData(), m_lambdas.Num() * sizeof(float));
+	const TArray<Spring>& springs = system.getSprings();
+	for (int32 iteration = 0; iteration < m_iterations; iteration++)
+	{
+		system.forEachSpringBatch([this, &springs, &points, alpha, gamma](int32 first, int32 last)
+		{
+			for (int32 i = first; i < last; i++)
+			{
+				const Spring& s = springs[i];
+				const float w1 = points.invMasses[s.m_m1];
+				const float w2 = points.invMasses[s.m_m2];
+				const float w = w1 + w2;
+				const FVector3f m2m1 = points.positions[s.m_m1] - points.positions[s.m_m2];
+				const float length = m2m1.Size();
+				if (w <= 0.0f || length <= SMALL_NUMBER)
+				{
+					continue;
+				}
+				const FVector3f n = m2m1 / length;
+
+				// C = |x1 - x2| - L, grad C = (n, -n)
+				const float C = length - s.m_spring_length_init;
+				const FVector3f motion = (points.positions[s.m_m1] - m_prevPositions[s.m_m1]) - (points.positions[s.m_m2] - m_prevPositions[s.m_m2]);
+				const float dLambda = (-C - alpha * m_lambdas[i] - gamma * FVector3f::DotProduct(n, motion)) / ((1.0f + gamma) * w + alpha);
+
+				m_lambdas[i] += dLambda;
+				points.positions[s.m_m1] += (w1 * dLambda) * n;
+				points.positions[s.m_m2] -= (w2 * dLambda) * n;
+			}
+		});
+	}
+
+	// velocities from the corrected positions
+	const float invDeltaT = 1.0f / deltaT;
+	system.forEachPointBatch([this, &points, invDeltaT](int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; i++)
+		{
+			if (!points.pinned[i])
+			{
+				points.velocities[i] = (points.positions[i] - m_prevPositions[i]) * invDeltaT;
+			}
+		}
+	});
+}
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class SpringMassSystem;
+
+/**
+ * Extended position based dynamics for a spring-mass system.
+ *
+ * Every spring becomes a distance constraint with compliance 1 / stiffness
+ * and the matching damping, so the cloth behaves like the force model but
+ * stays stable for any timestep. Constraints are projected Gauss-Seidel
+ * style, color group by color group, which lets each group run in parallel.
+ */
+class SPRING_MASS_API XPBDSolver
+{
+public:
+	// constraint projection sweeps per step, more is stiffer and slower
+	int32 m_iterations = 10;
+
+	// allocate the per spring and per mass point buffers for a topology
+	void init(const SpringMassSystem& system);
+	bool isInitialized() const { return m_initialized; }
+	// drop the buffers, the next step rebuilds them
+	void reset();
+
+	// advance the system by one timestep of any size
+	void step(SpringMassSystem& system, float deltaT);
+
+protected:
+	bool m_initialized = false;
+
+	// positions at the beginning of the step
+	TArray<FVector3f> m_prevPositions;
+	// accumulated Lagrange multiplier of each spring
+	TArray<float> m_lambdas;
+};
@@ -3,3 +3,5 @@
 #include "spring_mass.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, spring_mass, "spring_mass" );
+
+DEFINE_LOG_CATEGORY(LogSpringMass);
@@ -0,0 +1,343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassSystem.h"
+#include "SpringNetwork.h"
+#include "Async/ParallelFor.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+/**
+ * Headless benchmark of the spring-mass step.
+ *
+ * Every configuration simulates a hanging lattice like the one of
+ * ASpringMassActor, with the top row pinned, and reports the median over
+ * several runs of steps per second, nanoseconds per spring and step, and the
+ * heap the system holds after warming up. Sleeping is off so every step does
+ * the full work and the numbers only depend on the machine and the code.
+ * It exits with 1 when a configuration does not step or its positions are
+ * not finite afterwards.
+ *
+ *   spring_mass_benchmark [--quick] [--csv] [--sizes 20x40,64x64]
+ *                         [--threads 1,2,4] [--repeats 5] [--seconds 0.25]
+ */
+
+struct BenchmarkSize
+{
+	int32 rows;
+	int32 cols;
+};
+
+struct BenchmarkMethod
+{
+	const char* name;
+	ESpringMassSolver solver;
+	ESpringMassIntegrator integrator;
+	// the lattice of SpringMassSystem::setLattice, springs evaluated by GridStencil
+	bool bGrid = false;
+	// springs pulled back to 10% stretch after every step
+	bool bStrainLimiting = false;
+};
+
+static const BenchmarkMethod Methods[] = {
+	{ "explicit-euler", ESpringMassSolver::Explicit, ESpringMassIntegrator::SymplecticEuler },
+	{ "explicit-euler-grid", ESpringMassSolver::Explicit, ESpringMassIntegrator::SymplecticEuler, true },
+	{ "explicit-euler-strain-limit", ESpringMassSolver::Explicit, ESpringMassIntegrator::SymplecticEuler, false, true },
+	{ "explicit-position-verlet", ESpringMassSolver::Explicit, ESpringMassIntegrator::PositionVerlet },
+	{ "explicit-velocity-verlet", ESpringMassSolver::Explicit, ESpringMassIntegrator::VelocityVerlet },
+	{ "explicit-rk4", ESpringMassSolver::Explicit, ESpringMassIntegrator::RK4 },
+	{ "implicit", ESpringMassSolver::Implicit, ESpringMassIntegrator::SymplecticEuler },
+	{ "xpbd", ESpringMassSolver::XPBD, ESpringMassIntegrator::SymplecticEuler },
+};
+
+struct BenchmarkOptions
+{
+	std::vector<BenchmarkSize> sizes = { { 20, 40 }, { 64, 64 }, { 128, 128 }, { 256, 256 }, { 512, 512 } };
+	std::vector<int32> threads;
+	int32 repeats = 5;
+	// shortest timed run, a run takes at least MinSteps steps
+	double seconds = 0.25;
+	int32 warmupSteps = 20;
+	bool bCsv = false;
+};
+
+static constexpr int32 MinSteps = 3;
+// distance between neighbours of the lattice, as in the actor
+static constexpr float LatticeSpacing = 10.0f;
+// the implicit and XPBD solvers take one step per frame
+static constexpr float FrameStep = 1 / 90.0f;
+// largest explicit step, MaxTimeStep of the actor
+static constexpr float MaxExplicitStep = 1 / 200.0f;
+
+// heap in use, 0 where the C library cannot tell
+static SIZE_T
+heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+// the lattice of ASpringMassActor, stretch and shear springs, top row pinned,
+// built as the actor does with the stencil if bGrid
+static void
+buildLattice(const BenchmarkSize& size, SpringMassSystem& system, bool bGrid)
+{
+	if (bGrid)
+	{
+		system.setLattice(size.rows, size.cols, LatticeSpacing);
+		return;
+	}
+
+	TArray<FVector3f> positions;
+	TArray<uint32> indices;
+	positions.Reserve(size.rows * size.cols);
+	for (int32 x = 0; x < size.cols; x++)
+	{
+		for (int32 z = 0; z < size.rows; z++)
+		{
+			positions.Add(FVector3f(LatticeSpacing * x, 0, LatticeSpacing * z));
+		}
+	}
+	for (int32 x = 0; x < size.cols - 1; x++)
+	{
+		for (int32 z = 0; z < size.rows - 1; z++)
+		{
+			const uint32 offset = x * size.rows + z;
+			indices.Append({ offset, offset + 1, offset + size.rows, offset + 1, offset + size.rows + 1, offset + size.rows });
+		}
+	}
+
+	SpringNetworkBuilder builder;
+	builder.m_bending = false;
+	builder.m_pinDistance = 0.5f * LatticeSpacing;
+	SpringNetwork network;
+	builder.build(positions, indices, TArray<FVector2f>(), network);
+
+	TSharedRef<SpringMassTopology, ESPMode::ThreadSafe> topology = MakeShared<SpringMassTopology, ESPMode::ThreadSafe>();
+	topology->positions = network.positions;
+	topology->pinned.Init(0, network.positions.Num());
+	for (uint32 p : network.pinned)
+	{
+		topology->pinned[p] = 1;
+	}
+	topology->springs = network.springs;
+	topology->finalize();
+	system.setTopology(topology);
+}
+
+struct BenchmarkResult
+{
+	double stepsPerSecond = 0;
+	double nsPerSpring = 0;
+	SIZE_T bytes = 0;
+	// every position finite after the last step
+	bool bFinite = true;
+};
+
+static BenchmarkResult
+run(const BenchmarkOptions& options, const BenchmarkSize& size, const BenchmarkMethod& method, int32 threads, int32& numPoints, int32& numSprings)
+{
+	StandaloneWorkers::setThreads(threads);
+
+	const SIZE_T heapBefore = heapInUse();
+	SpringMassSystem system;
+	buildLattice(size, system, method.bGrid);
+	numPoints = system.massPoints.num();
+	numSprings = system.numSprings();
+
+	SpringMassSettings settings;
+	settings.parallel = threads > 1;
+	settings.solver = method.solver;
+	settings.integrator = method.integrator;
+	settings.sleeping = false;
+	settings.strainLimiting = method.bStrainLimiting;
+	system.applySettings(settings);
+	const float deltaT = method.solver == ESpringMassSolver::Explicit ? FMath::Min(MaxExplicitStep, system.estimateStableStep()) : FrameStep;
+
+	// a push in the middle keeps the lattice moving
+	system.addForce((size.cols / 2) * size.rows + size.rows / 2, FVector3f(0, 20, 0));
+	for (int32 i = 0; i < options.warmupSteps; i++)
+	{
+		system.step(deltaT);
+	}
+
+	BenchmarkResult result;
+	result.bytes = heapInUse() - heapBefore;
+
+	std::vector<double> rates;
+	for (int32 r = 0; r < options.repeats; r++)
+	{
+		int32 steps = 0;
+		const double start = FPlatformTime::Seconds();
+		double elapsed = 0;
+		while (steps < MinSteps || elapsed < options.seconds)
+		{
+			system.step(deltaT);
+			steps++;
+			elapsed = FPlatformTime::Seconds() - start;
+		}
+		rates.push_back(steps / elapsed);
+	}
+	for (const FVector3f& p : system.massPoints.positions)
+	{
+		result.bFinite &= std::isfinite(p.X) && std::isfinite(p.Y) && std::isfinite(p.Z);
+	}
+	std::sort(rates.begin(), rates.end());
+	result.stepsPerSecond = rates[rates.size() / 2];
+	result.nsPerSpring = 1e9 / (result.stepsPerSecond * FMath::Max(1, numSprings));
+	return result;
+}
+
+// comma separated list, each item parsed by parse, false on an empty list
+template<typename T, typename Parse>
+static bool
+parseList(const char* text, std::vector<T>& items, Parse&& parse)
+{
+	items.clear();
+	std::string list(text);
+	size_t begin = 0;
+	while (begin <= list.size())
+	{
+		size_t end = list.find(',', begin);
+		end = end == std::string::npos ? list.size() : end;
+		T item;
+		if (end > begin && parse(list.substr(begin, end - begin).c_str(), item))
+		{
+			items.push_back(item);
+		}
+		begin = end + 1;
+	}
+	return !items.empty();
+}
+
+static bool
+parseArguments(int argc, char** argv, BenchmarkOptions& options)
+{
+	auto parseSize = [](const char* text, BenchmarkSize& size)
+	{
+		return std::sscanf(text, "%dx%d", &size.rows, &size.cols) == 2 && size.rows >= 2 && size.cols >= 2;
+	};
+	auto parseThreads = [](const char* text, int32& threads)
+	{
+		threads = std::atoi(text);
+		return threads >= 1;
+	};
+
+	for (int32 i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!std::strcmp(arg, "--quick"))
+		{
+			// every code path once, for CI to notice a broken benchmark
+			options.sizes = { { 20, 40 }, { 64, 64 } };
+			options.threads = { 1, 2 };
+			options.repeats = 1;
+			options.seconds = 0;
+			options.warmupSteps = 2;
+		}
+		else if (!std::strcmp(arg, "--csv"))
+		{
+			options.bCsv = true;
+		}
+		else if (!std::strcmp(arg, "--sizes") && value && parseList(value, options.sizes, parseSize))
+		{
+			i++;
+		}
+		else if (!std::strcmp(arg, "--threads") && value && parseList(value, options.threads, parseThreads))
+		{
+			i++;
+		}
+		else if (!std::strcmp(arg, "--repeats") && value && std::atoi(value) >= 1)
+		{
+			options.repeats = std::atoi(value);
+			i++;
+		}
+		else if (!std::strcmp(arg, "--seconds") && value && std::atof(value) >= 0)
+		{
+			options.seconds = std::atof(value);
+			i++;
+		}
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--quick] [--csv] [--sizes 20x40,64x64] [--threads 1,2,4] [--repeats 5] [--seconds 0.25]\n", argv[0]);
+			return false;
+		}
+	}
+
+	// powers of two up to the cores and the cores themselves
+	if (options.threads.empty())
+	{
+		const int32 cores = FPlatformMisc::NumberOfCoresIncludingHyperthreads();
+		for (int32 threads = 1; threads < cores; threads *= 2)
+		{
+			options.threads.push_back(threads);
+		}
+		options.threads.push_back(cores);
+	}
+	return true;
+}
+
+int
+main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	if (!parseArguments(argc, argv, options))
+	{
+		return 1;
+	}
+
+	static const char* const SimdNames[] = { "scalar", "sse2", "avx2", "avx512" };
+	const char* simd = SimdNames[int32(SimdKernels::detect())];
+	if (options.bCsv)
+	{
+		std::printf("rows,cols,points,springs,method,threads,simd,steps_per_second,ns_per_spring,bytes\n");
+	}
+	else
+	{
+		std::printf("spring-mass benchmark, %d cores, %s kernels, median of %d runs\n\n", FPlatformMisc::NumberOfCoresIncludingHyperthreads(), simd, options.repeats);
+		std::printf("%-9s %8s %8s  %-26s %7s %12s %10s %10s\n", "lattice", "points", "springs", "method", "threads", "steps/s", "ns/spring", "KiB");
+	}
+
+	bool bFailed = false;
+	for (const BenchmarkSize& size : options.sizes)
+	{
+		for (const BenchmarkMethod& method : Methods)
+		{
+			for (int32 threads : options.threads)
+			{
+				int32 numPoints = 0;
+				int32 numSprings = 0;
+				const BenchmarkResult result = run(options, size, method, threads, numPoints, numSprings);
+				if (options.bCsv)
+				{
+					std::printf("%d,%d,%d,%d,%s,%d,%s,%.1f,%.3f,%zu\n", size.rows, size.cols, numPoints, numSprings, method.name, threads, simd, result.stepsPerSecond, result.nsPerSpring, size_t(result.bytes));
+				}
+				else
+				{
+					char lattice[32];
+					std::snprintf(lattice, sizeof(lattice), "%dx%d", size.rows, size.cols);
+					std::printf("%-9s %8d %8d  %-26s %7d %12.1f %10.3f %10.1f\n", lattice, numPoints, numSprings, method.name, threads, result.stepsPerSecond, result.nsPerSpring, result.bytes / 1024.0);
+				}
+				std::fflush(stdout);
+				if (!result.bFinite || !(result.stepsPerSecond > 0))
+				{
+					std::fprintf(stderr, "%dx%d %s with %d threads: %s\n", size.rows, size.cols, method.name, threads, result.bFinite ? "no steps" : "positions not finite");
+					bFailed = true;
+				}
+			}
+		}
+	}
+	return bFailed ? 1 : 0;
+}
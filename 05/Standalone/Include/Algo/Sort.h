@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace Algo
+{
+	template<typename Range>
+	void Sort(Range&& range)
+	{
+		std::sort(std::begin(range), std::end(range));
+	}
+
+	template<typename Range, typename Predicate>
+	void Sort(Range&& range, Predicate predicate)
+	{
+		std::sort(std::begin(range), std::end(range), predicate);
+	}
+}
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EParallelForFlags
+{
+	None = 0,
+	ForceSingleThread = 1,
+	Unbalanced = 2,
+};
+
+// run body(i) for i in [0, num) on the calling thread and the workers, returns when all are done
+void ParallelFor(int32 num, TFunctionRef<void(int32)> body, bool bForceSingleThread = false);
+void ParallelFor(int32 num, TFunctionRef<void(int32)> body, EParallelForFlags flags);
+
+/**
+ * Worker threads of ParallelFor. The engine sizes its task graph from the
+ * cores, here the count can be set, e.g. to measure how the simulation
+ * scales. A ParallelFor inside another one runs on the calling thread.
+ */
+struct StandaloneWorkers
+{
+	// threads taking part in a ParallelFor including the calling one, at least 1
+	static void setThreads(int32 count);
+	static int32 getThreads();
+};
@@ -0,0 +1,771 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * The part of the engine's Core module the spring-mass simulation uses, on
+ * top of the C++ standard library, so the simulation sources build without
+ * the engine. Names, signatures and behaviour follow the engine closely
+ * enough that the same sources compile and give the same results in both.
+ * Only what the simulation needs is here, add to it as the core grows.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// types and macros
+
+typedef std::int8_t int8;
+typedef std::int16_t int16;
+typedef std::int32_t int32;
+typedef std::int64_t int64;
+typedef std::uint8_t uint8;
+typedef std::uint16_t uint16;
+typedef std::uint32_t uint32;
+typedef std::uint64_t uint64;
+typedef std::size_t SIZE_T;
+typedef std::uintptr_t UPTRINT;
+typedef char16_t TCHAR;
+
+#define FORCEINLINE inline
+#define RESTRICT __restrict
+#define check(expr) assert(expr)
+#define INDEX_NONE (-1)
+#define SMALL_NUMBER (1.e-8f)
+#define KINDA_SMALL_NUMBER (1.e-4f)
+#define MAX_flt (3.402823466e+38F)
+#define UE_ARRAY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+#define TEXT(x) x
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PLATFORM_CPU_X86_FAMILY 1
+#else
+#define PLATFORM_CPU_X86_FAMILY 0
+#endif
+
+// reflection markup is only read by the engine's header tool
+#define UENUM(...)
+#define UMETA(...)
+
+// the module exports nothing when it is linked statically
+#define SPRING_MASS_API
+
+template<typename T>
+constexpr std::remove_reference_t<T>&& MoveTemp(T&& value)
+{
+	return static_cast<std::remove_reference_t<T>&&>(value);
+}
+
+template<typename T>
+void Swap(T& a, T& b)
+{
+	std::swap(a, b);
+}
+
+enum EForceInit
+{
+	ForceInit,
+	ForceInitToZero,
+};
+
+// ---------------------------------------------------------------------------
+// math
+
+struct FMath
+{
+	template<typename T> static constexpr T Min(T a, T b) { return a < b ? a : b; }
+	template<typename T> static constexpr T Max(T a, T b) { return a < b ? b : a; }
+	template<typename T> static constexpr T Min3(T a, T b, T c) { return Min(Min(a, b), c); }
+	template<typename T> static constexpr T Max3(T a, T b, T c) { return Max(Max(a, b), c); }
+	template<typename T> static constexpr T Clamp(T x, T low, T high) { return x < low ? low : (x < high ? x : high); }
+	template<typename T> static constexpr T Abs(T x) { return x < T(0) ? -x : x; }
+	template<typename T> static constexpr T Square(T x) { return x * x; }
+	template<typename T, typename U> static T Lerp(const T& a, const T& b, const U& alpha) { return (T)(a + (b - a) * alpha); }
+
+	static float Sqrt(float x) { return std::sqrt(x); }
+	static double Sqrt(double x) { return std::sqrt(x); }
+	static float InvSqrt(float x) { return 1.0f / std::sqrt(x); }
+	static float Sin(float x) { return std::sin(x); }
+	static float Cos(float x) { return std::cos(x); }
+	static float Tan(float x) { return std::tan(x); }
+	static float Exp(float x) { return std::exp(x); }
+	static float Loge(float x) { return std::log(x); }
+	static float DegreesToRadians(float degrees) { return degrees * (3.14159265358979323846f / 180.0f); }
+
+	static int32 FloorToInt(float x) { return int32(std::floor(x)); }
+	static int32 CeilToInt(float x) { return int32(std::ceil(x)); }
+	static int32 RoundToInt(float x) { return int32(std::floor(x + 0.5f)); }
+	static bool IsNearlyZero(float x, float tolerance = SMALL_NUMBER) { return Abs(x) <= tolerance; }
+
+	template<typename T> static constexpr T DivideAndRoundUp(T dividend, T divisor) { return (dividend + divisor - 1) / divisor; }
+
+	static uint32 RoundUpToPowerOfTwo(uint32 x)
+	{
+		uint32 power = 1;
+		while (power < x)
+		{
+			power <<= 1;
+		}
+		return power;
+	}
+
+	static uint64 CountTrailingZeros64(uint64 x)
+	{
+		if (x == 0)
+		{
+			return 64;
+		}
+		uint64 count = 0;
+		while ((x & 1) == 0)
+		{
+			x >>= 1;
+			count++;
+		}
+		return count;
+	}
+};
+
+template<typename T>
+struct TVector
+{
+	T X;
+	T Y;
+	T Z;
+
+	static const TVector ZeroVector;
+	static const TVector OneVector;
+	static const TVector UpVector;
+
+	TVector() = default;
+	explicit constexpr TVector(T value) : X(value), Y(value), Z(value) {}
+	constexpr TVector(T x, T y, T z) : X(x), Y(y), Z(z) {}
+	explicit TVector(EForceInit) : X(0), Y(0), Z(0) {}
+	template<typename U, typename = std::enable_if_t<!std::is_same_v<T, U>>>
+	explicit constexpr TVector(const TVector<U>& other) : X(T(other.X)), Y(T(other.Y)), Z(T(other.Z)) {}
+
+	TVector operator+(const TVector& v) const { return TVector(X + v.X, Y + v.Y, Z + v.Z); }
+	TVector operator-(const TVector& v) const { return TVector(X - v.X, Y - v.Y, Z - v.Z); }
+	TVector operator*(const TVector& v) const { return TVector(X * v.X, Y * v.Y, Z * v.Z); }
+	TVector operator/(const TVector& v) const { return TVector(X / v.X, Y / v.Y, Z / v.Z); }
+	TVector operator*(T s) const { return TVector(X * s, Y * s, Z * s); }
+	TVector operator/(T s) const { const T inv = T(1) / s; return TVector(X * inv, Y * inv, Z * inv); }
+	TVector operator-() const { return TVector(-X, -Y, -Z); }
+	TVector& operator+=(const TVector& v) { X += v.X; Y += v.Y; Z += v.Z; return *this; }
+	TVector& operator-=(const TVector& v) { X -= v.X; Y -= v.Y; Z -= v.Z; return *this; }
+	TVector& operator*=(const TVector& v) { X *= v.X; Y *= v.Y; Z *= v.Z; return *this; }
+	TVector& operator*=(T s) { X *= s; Y *= s; Z *= s; return *this; }
+	TVector& operator/=(T s) { const T inv = T(1) / s; X *= inv; Y *= inv; Z *= inv; return *this; }
+	bool operator==(const TVector& v) const { return X == v.X && Y == v.Y && Z == v.Z; }
+	bool operator!=(const TVector& v) const { return !(*this == v); }
+
+	// dot and cross product
+	T operator|(const TVector& v) const { return X * v.X + Y * v.Y + Z * v.Z; }
+	TVector operator^(const TVector& v) const { return TVector(Y * v.Z - Z * v.Y, Z * v.X - X * v.Z, X * v.Y - Y * v.X); }
+
+	T& operator[](int32 i) { return (&X)[i]; }
+	T operator[](int32 i) const { return (&X)[i]; }
+
+	T Size() const { return std::sqrt(X * X + Y * Y + Z * Z); }
+	T SizeSquared() const { return X * X + Y * Y + Z * Z; }
+	T GetMax() const { return FMath::Max3(X, Y, Z); }
+	T GetAbsMax() const { return FMath::Max3(FMath::Abs(X), FMath::Abs(Y), FMath::Abs(Z)); }
+	bool IsZero() const { return X == 0 && Y == 0 && Z == 0; }
+	bool IsNearlyZero(T tolerance = T(KINDA_SMALL_NUMBER)) const { return FMath::Abs(X) <= tolerance && FMath::Abs(Y) <= tolerance && FMath::Abs(Z) <= tolerance; }
+	TVector GetAbs() const { return TVector(FMath::Abs(X), FMath::Abs(Y), FMath::Abs(Z)); }
+	TVector ComponentMin(const TVector& v) const { return TVector(FMath::Min(X, v.X), FMath::Min(Y, v.Y), FMath::Min(Z, v.Z)); }
+	TVector ComponentMax(const TVector& v) const { return TVector(FMath::Max(X, v.X), FMath::Max(Y, v.Y), FMath::Max(Z, v.Z)); }
+
+	TVector GetSafeNormal(T tolerance = T(SMALL_NUMBER)) const
+	{
+		const T size2 = SizeSquared();
+		if (size2 == T(1))
+		{
+			return *this;
+		}
+		return size2 < tolerance ? ZeroVector : *this * (T(1) / std::sqrt(size2));
+	}
+	TVector GetUnsafeNormal() const { return *this * (T(1) / Size()); }
+	bool Normalize(T tolerance = T(SMALL_NUMBER))
+	{
+		const T size2 = SizeSquared();
+		if (size2 > tolerance)
+		{
+			*this *= T(1) / std::sqrt(size2);
+			return true;
+		}
+		return false;
+	}
+
+	static T DotProduct(const TVector& a, const TVector& b) { return a | b; }
+	static TVector CrossProduct(const TVector& a, const TVector& b) { return a ^ b; }
+	static T Dist(const TVector& a, const TVector& b) { return (b - a).Size(); }
+	static T Distance(const TVector& a, const TVector& b) { return (b - a).Size(); }
+	static T DistSquared(const TVector& a, const TVector& b) { return (b - a).SizeSquared(); }
+	static TVector Min(const TVector& a, const TVector& b) { return a.ComponentMin(b); }
+	static TVector Max(const TVector& a, const TVector& b) { return a.ComponentMax(b); }
+};
+
+template<typename T> const TVector<T> TVector<T>::ZeroVector(0, 0, 0);
+template<typename T> const TVector<T> TVector<T>::OneVector(1, 1, 1);
+template<typename T> const TVector<T> TVector<T>::UpVector(0, 0, 1);
+
+template<typename T, typename U, typename = std::enable_if_t<std::is_arithmetic_v<U>>>
+inline TVector<T> operator*(U s, const TVector<T>& v)
+{
+	return v * T(s);
+}
+
+template<typename T>
+struct TVector2
+{
+	T X;
+	T Y;
+
+	static const TVector2 ZeroVector;
+
+	TVector2() = default;
+	constexpr TVector2(T x, T y) : X(x), Y(y) {}
+	explicit constexpr TVector2(T value) : X(value), Y(value) {}
+
+	TVector2 operator+(const TVector2& v) const { return TVector2(X + v.X, Y + v.Y); }
+	TVector2 operator-(const TVector2& v) const { return TVector2(X - v.X, Y - v.Y); }
+	TVector2 operator*(T s) const { return TVector2(X * s, Y * s); }
+	bool operator==(const TVector2& v) const { return X == v.X && Y == v.Y; }
+	bool operator!=(const TVector2& v) const { return !(*this == v); }
+};
+
+template<typename T> const TVector2<T> TVector2<T>::ZeroVector(0, 0);
+
+template<typename T>
+struct TPlane : public TVector<T>
+{
+	T W;
+
+	TPlane() = default;
+	TPlane(T x, T y, T z, T w) : TVector<T>(x, y, z), W(w) {}
+	// through a point with a unit normal
+	TPlane(const TVector<T>& origin, const TVector<T>& normal) : TVector<T>(normal), W(origin | normal) {}
+
+	TVector<T> GetNormal() const { return TVector<T>(this->X, this->Y, this->Z); }
+	// signed distance of a point for a unit normal
+	T PlaneDot(const TVector<T>& p) const { return this->X * p.X + this->Y * p.Y + this->Z * p.Z - W; }
+};
+
+template<typename T>
+struct TBox
+{
+	TVector<T> Min;
+	TVector<T> Max;
+	uint8 IsValid = 0;
+
+	TBox() = default;
+	explicit TBox(EForceInit) : Min(0, 0, 0), Max(0, 0, 0), IsValid(0) {}
+	TBox(const TVector<T>& min, const TVector<T>& max) : Min(min), Max(max), IsValid(1) {}
+	template<typename Range>
+	explicit TBox(const Range& points) : Min(0, 0, 0), Max(0, 0, 0), IsValid(0)
+	{
+		for (const TVector<T>& p : points)
+		{
+			*this += p;
+		}
+	}
+
+	TBox& operator+=(const TVector<T>& p)
+	{
+		Min = IsValid ? Min.ComponentMin(p) : p;
+		Max = IsValid ? Max.ComponentMax(p) : p;
+		IsValid = 1;
+		return *this;
+	}
+
+	TVector<T> GetCenter() const { return (Min + Max) * T(0.5); }
+	TVector<T> GetExtent() const { return (Max - Min) * T(0.5); }
+	TVector<T> GetSize() const { return Max - Min; }
+	TBox ExpandBy(T w) const { return TBox(Min - TVector<T>(w), Max + TVector<T>(w)); }
+	bool Intersect(const TBox& o) const
+	{
+		return !(o.Min.X > Max.X || o.Max.X < Min.X || o.Min.Y > Max.Y || o.Max.Y < Min.Y || o.Min.Z > Max.Z || o.Max.Z < Min.Z);
+	}
+	bool IsInside(const TVector<T>& p) const
+	{
+		return p.X > Min.X && p.X < Max.X && p.Y > Min.Y && p.Y < Max.Y && p.Z > Min.Z && p.Z < Max.Z;
+	}
+};
+
+typedef TVector<float> FVector3f;
+typedef TVector<double> FVector;
+typedef TVector2<float> FVector2f;
+typedef TVector2<double> FVector2D;
+typedef TPlane<float> FPlane4f;
+typedef TPlane<double> FPlane;
+typedef TBox<float> FBox3f;
+typedef TBox<double> FBox;
+
+struct FIntPoint
+{
+	int32 X = 0;
+	int32 Y = 0;
+
+	FIntPoint() = default;
+	constexpr FIntPoint(int32 x, int32 y) : X(x), Y(y) {}
+	bool operator==(const FIntPoint& o) const { return X == o.X && Y == o.Y; }
+	bool operator!=(const FIntPoint& o) const { return !(*this == o); }
+};
+
+struct FIntVector
+{
+	int32 X = 0;
+	int32 Y = 0;
+	int32 Z = 0;
+
+	FIntVector() = default;
+	constexpr FIntVector(int32 x, int32 y, int32 z) : X(x), Y(y), Z(z) {}
+	bool operator==(const FIntVector& o) const { return X == o.X && Y == o.Y && Z == o.Z; }
+	bool operator!=(const FIntVector& o) const { return !(*this == o); }
+};
+
+// ---------------------------------------------------------------------------
+// hashing
+
+inline uint32 HashCombine(uint32 a, uint32 c)
+{
+	// Bob Jenkins' mix, as in the engine
+	uint32 b = 0x9e3779b9;
+	a += b;
+	a -= b; a -= c; a ^= (c >> 13);
+	b -= c; b -= a; b ^= (a << 8);
+	c -= a; c -= b; c ^= (b >> 13);
+	a -= b; a -= c; a ^= (c >> 12);
+	b -= c; b -= a; b ^= (a << 16);
+	c -= a; c -= b; c ^= (b >> 5);
+	a -= b; a -= c; a ^= (c >> 3);
+	b -= c; b -= a; b ^= (a << 10);
+	c -= a; c -= b; c ^= (b >> 15);
+	return c;
+}
+
+inline uint32 GetTypeHash(int32 value) { return uint32(value); }
+inline uint32 GetTypeHash(uint32 value) { return value; }
+inline uint32 GetTypeHash(int64 value) { return uint32(value) + (uint32(uint64(value) >> 32) * 23); }
+inline uint32 GetTypeHash(uint64 value) { return uint32(value) + (uint32(value >> 32) * 23); }
+inline uint32 GetTypeHash(const FIntPoint& p) { return HashCombine(uint32(p.X), uint32(p.Y)); }
+inline uint32 GetTypeHash(const FIntVector& v) { return HashCombine(uint32(v.X), HashCombine(uint32(v.Y), uint32(v.Z))); }
+
+struct FTypeHasher
+{
+	template<typename K>
+	size_t operator()(const K& key) const { return GetTypeHash(key); }
+};
+
+// ---------------------------------------------------------------------------
+// memory
+
+struct FMemory
+{
+	static void* Memcpy(void* dest, const void* src, SIZE_T count) { return std::memcpy(dest, src, count); }
+	static void* Memmove(void* dest, const void* src, SIZE_T count) { return std::memmove(dest, src, count); }
+	static void* Memset(void* dest, uint8 value, SIZE_T count) { return std::memset(dest, value, count); }
+	static void Memzero(void* dest, SIZE_T count) { std::memset(dest, 0, count); }
+};
+
+// ---------------------------------------------------------------------------
+// shared pointers
+
+// the reference counts are always atomic here, the mode only keeps the engine's types
+enum class ESPMode : uint8
+{
+	NotThreadSafe,
+	ThreadSafe,
+};
+
+template<typename T, ESPMode Mode = ESPMode::ThreadSafe> class TSharedRef;
+template<typename T, ESPMode Mode = ESPMode::ThreadSafe> class TSharedPtr;
+template<typename T, ESPMode Mode = ESPMode::ThreadSafe> class TWeakPtr;
+
+// shared pointer that is never null
+template<typename T, ESPMode Mode>
+class TSharedRef
+{
+public:
+	template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+	TSharedRef(const TSharedRef<U, Mode>& other) : m_ptr(other.m_ptr) {}
+
+	T& Get() const { return *m_ptr; }
+	T* operator->() const { return m_ptr.get(); }
+	T& operator*() const { return *m_ptr; }
+	bool IsUnique() const { return m_ptr.use_count() == 1; }
+	bool operator==(const TSharedRef& other) const { return m_ptr == other.m_ptr; }
+
+private:
+	template<typename, ESPMode> friend class TSharedRef;
+	template<typename, ESPMode> friend class TSharedPtr;
+	template<typename U, ESPMode M, typename... Args> friend TSharedRef<U, M> MakeShared(Args&&... args);
+
+	explicit TSharedRef(std::shared_ptr<T> ptr) : m_ptr(std::move(ptr)) {}
+	std::shared_ptr<T> m_ptr;
+};
+
+template<typename T, ESPMode Mode>
+class TSharedPtr
+{
+public:
+	TSharedPtr() = default;
+	TSharedPtr(std::nullptr_t) {}
+	template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+	TSharedPtr(const TSharedRef<U, Mode>& other) : m_ptr(other.m_ptr) {}
+	template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+	TSharedPtr(const TSharedPtr<U, Mode>& other) : m_ptr(other.m_ptr) {}
+
+	T* Get() const { return m_ptr.get(); }
+	T* operator->() const { return m_ptr.get(); }
+	T& operator*() const { return *m_ptr; }
+	bool IsValid() const { return m_ptr != nullptr; }
+	explicit operator bool() const { return IsValid(); }
+	bool IsUnique() const { return m_ptr.use_count() == 1; }
+	void Reset() { m_ptr.reset(); }
+	TSharedRef<T, Mode> ToSharedRef() const { check(IsValid()); return TSharedRef<T, Mode>(m_ptr); }
+	bool operator==(const TSharedPtr& other) const { return m_ptr == other.m_ptr; }
+
+private:
+	template<typename, ESPMode> friend class TSharedPtr;
+	template<typename, ESPMode> friend class TWeakPtr;
+
+	explicit TSharedPtr(std::shared_ptr<T> ptr) : m_ptr(std::move(ptr)) {}
+	std::shared_ptr<T> m_ptr;
+};
+
+// does not keep the object alive, Pin gives a shared pointer while it lives
+template<typename T, ESPMode Mode>
+class TWeakPtr
+{
+public:
+	TWeakPtr() = default;
+	template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+	TWeakPtr(const TSharedRef<U, Mode>& other) : m_ptr(TSharedPtr<U, Mode>(other).m_ptr) {}
+	template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+	TWeakPtr(const TSharedPtr<U, Mode>& other) : m_ptr(other.m_ptr) {}
+
+	TSharedPtr<T, Mode> Pin() const { return TSharedPtr<T, Mode>(m_ptr.lock()); }
+	bool IsValid() const { return !m_ptr.expired(); }
+	void Reset() { m_ptr.reset(); }
+
+private:
+	std::weak_ptr<T> m_ptr;
+};
+
+template<typename T, ESPMode Mode = ESPMode::ThreadSafe, typename... Args>
+TSharedRef<T, Mode> MakeShared(Args&&... args)
+{
+	return TSharedRef<T, Mode>(std::make_shared<T>(std::forward<Args>(args)...));
+}
+
+// ---------------------------------------------------------------------------
+// containers
+
+template<typename T>
+class TArrayView
+{
+public:
+	TArrayView() = default;
+	TArrayView(T* data, int32 num) : m_data(data), m_num(num) {}
+	// a view of mutable elements is also a view of const ones
+	template<typename U, typename = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+	TArrayView(const TArrayView<U>& other) : m_data(other.GetData()), m_num(other.Num()) {}
+
+	T* GetData() const { return m_data; }
+	int32 Num() const { return m_num; }
+	T& operator[](int32 i) const { return m_data[i]; }
+	T* begin() const { return m_data; }
+	T* end() const { return m_data + m_num; }
+
+private:
+	T* m_data = nullptr;
+	int32 m_num = 0;
+};
+
+template<typename T>
+TArrayView<T> MakeArrayView(T* data, int32 num)
+{
+	return TArrayView<T>(data, num);
+}
+
+/**
+ * Dynamic array on top of std::vector. Uninitialized and zeroed growth only
+ * differ for the engine's allocator, here new elements are value initialized.
+ */
+template<typename T>
+class TArray
+{
+public:
+	typedef T ElementType;
+
+	TArray() = default;
+	TArray(std::initializer_list<T> list) : m_items(list) {}
+	TArray(const T* data, int32 num) : m_items(data, data + num) {}
+
+	int32 Num() const { return int32(m_items.size()); }
+	int32 Max() const { return int32(m_items.capacity()); }
+	bool IsEmpty() const { return m_items.empty(); }
+	bool IsValidIndex(int32 i) const { return i >= 0 && i < Num(); }
+	T* GetData() { return m_items.data(); }
+	const T* GetData() const { return m_items.data(); }
+	SIZE_T GetAllocatedSize() const { return m_items.capacity() * sizeof(T); }
+
+	T& operator[](int32 i) { return m_items[i]; }
+	const T& operator[](int32 i) const { return m_items[i]; }
+	T& Last(int32 fromEnd = 0) { return m_items[m_items.size() - 1 - fromEnd]; }
+	const T& Last(int32 fromEnd = 0) const { return m_items[m_items.size() - 1 - fromEnd]; }
+	T& Top() { return Last(); }
+
+	int32 Add(const T& item) { m_items.push_back(item); return Num() - 1; }
+	int32 Add(T&& item) { m_items.push_back(std::move(item)); return Num() - 1; }
+	template<typename... Args>
+	int32 Emplace(Args&&... args) { m_items.emplace_back(std::forward<Args>(args)...); return Num() - 1; }
+	int32 AddUnique(const T& item) { const int32 i = Find(item); return i != INDEX_NONE ? i : Add(item); }
+	int32 AddUninitialized(int32 count = 1) { const int32 first = Num(); m_items.resize(m_items.size() + count); return first; }
+	int32 AddZeroed(int32 count = 1) { return AddUninitialized(count); }
+	int32 AddDefaulted(int32 count = 1) { return AddUninitialized(count); }
+	void Append(const TArray& other) { m_items.insert(m_items.end(), other.m_items.begin(), other.m_items.end()); }
+	void Append(std::initializer_list<T> list) { m_items.insert(m_items.end(), list); }
+	void Append(const T* data, int32 num) { m_items.insert(m_items.end(), data, data + num); }
+	void Insert(const T& item, int32 i) { m_items.insert(m_items.begin() + i, item); }
+
+	T Pop() { T item = std::move(m_items.back()); m_items.pop_back(); return item; }
+	void RemoveAt(int32 i, int32 count = 1) { m_items.erase(m_items.begin() + i, m_items.begin() + i + count); }
+	void RemoveAtSwap(int32 i)
+	{
+		if (i != Num() - 1)
+		{
+			m_items[i] = std::move(m_items.back());
+		}
+		m_items.pop_back();
+	}
+	int32 Remove(const T& item)
+	{
+		const int32 before = Num();
+		m_items.erase(std::remove(m_items.begin(), m_items.end(), item), m_items.end());
+		return before - Num();
+	}
+
+	int32 Find(const T& item) const
+	{
+		const auto it = std::find(m_items.begin(), m_items.end(), item);
+		return it == m_items.end() ? INDEX_NONE : int32(it - m_items.begin());
+	}
+	bool Contains(const T& item) const { return Find(item) != INDEX_NONE; }
+
+	void Init(const T& value, int32 num) { m_items.assign(num, value); }
+	void SetNum(int32 num, bool bAllowShrinking = true) { resize(num, bAllowShrinking); }
+	void SetNumUninitialized(int32 num, bool bAllowShrinking = true) { resize(num, bAllowShrinking); }
+	void SetNumZeroed(int32 num, bool bAllowShrinking = true) { resize(num, bAllowShrinking); }
+	void Reserve(int32 num) { m_items.reserve(num); }
+	// remove the elements, keep the allocation if it holds newSize
+	void Reset(int32 newSize = 0) { m_items.clear(); m_items.reserve(newSize); }
+	// remove the elements and the allocation unless slack is requested
+	void Empty(int32 slack = 0)
+	{
+		std::vector<T>().swap(m_items);
+		m_items.reserve(slack);
+	}
+	void Shrink() { m_items.shrink_to_fit(); }
+
+	bool operator==(const TArray& other) const { return m_items == other.m_items; }
+	bool operator!=(const TArray& other) const { return m_items != other.m_items; }
+
+	auto begin() { return m_items.begin(); }
+	auto end() { return m_items.end(); }
+	auto begin() const { return m_items.begin(); }
+	auto end() const { return m_items.end(); }
+
+private:
+	std::vector<T> m_items;
+
+	void resize(int32 num, bool bAllowShrinking)
+	{
+		m_items.resize(num);
+		if (bAllowShrinking && m_items.capacity() > 2 * m_items.size() + 16)
+		{
+			m_items.shrink_to_fit();
+		}
+	}
+};
+
+template<typename T>
+TArrayView<T> MakeArrayView(TArray<T>& array)
+{
+	return TArrayView<T>(array.GetData(), array.Num());
+}
+
+template<typename A = void>
+class TBitArray
+{
+public:
+	TBitArray() = default;
+	TBitArray(bool value, int32 num) : m_bits(num, value) {}
+
+	int32 Num() const { return int32(m_bits.size()); }
+	void Init(bool value, int32 num) { m_bits.assign(num, value); }
+	int32 Add(bool value) { m_bits.push_back(value); return Num() - 1; }
+	std::vector<bool>::reference operator[](int32 i) { return m_bits[i]; }
+	bool operator[](int32 i) const { return m_bits[i]; }
+
+private:
+	std::vector<bool> m_bits;
+};
+
+template<typename K, typename V>
+struct TPair
+{
+	K Key;
+	V Value;
+};
+
+/**
+ * Hash map that iterates in insertion order while nothing is removed, as the
+ * engine's TMap does.
+ */
+template<typename K, typename V>
+class TMap
+{
+public:
+	int32 Num() const { return m_pairs.Num(); }
+	void Reserve(int32 num) { m_pairs.Reserve(num); m_index.reserve(num); }
+	void Reset() { m_pairs.Reset(); m_index.clear(); }
+	void Empty(int32 slack = 0) { m_pairs.Empty(slack); m_index.clear(); }
+
+	bool Contains(const K& key) const { return m_index.count(key) > 0; }
+	V* Find(const K& key)
+	{
+		const auto it = m_index.find(key);
+		return it == m_index.end() ? nullptr : &m_pairs[it->second].Value;
+	}
+	const V* Find(const K& key) const
+	{
+		const auto it = m_index.find(key);
+		return it == m_index.end() ? nullptr : &m_pairs[it->second].Value;
+	}
+	V& FindOrAdd(const K& key)
+	{
+		const auto [it, bInserted] = m_index.emplace(key, m_pairs.Num());
+		if (bInserted)
+		{
+			m_pairs.Add(TPair<K, V>{ key, V() });
+		}
+		return m_pairs[it->second].Value;
+	}
+	V& Add(const K& key, const V& value) { return FindOrAdd(key) = value; }
+	int32 Remove(const K& key)
+	{
+		const auto it = m_index.find(key);
+		if (it == m_index.end())
+		{
+			return 0;
+		}
+		m_pairs.RemoveAt(it->second);
+		m_index.clear();
+		for (int32 i = 0; i < m_pairs.Num(); i++)
+		{
+			m_index.emplace(m_pairs[i].Key, i);
+		}
+		return 1;
+	}
+
+	auto begin() { return m_pairs.begin(); }
+	auto end() { return m_pairs.end(); }
+	auto begin() const { return m_pairs.begin(); }
+	auto end() const { return m_pairs.end(); }
+
+private:
+	TArray<TPair<K, V>> m_pairs;
+	std::unordered_map<K, int32, FTypeHasher> m_index;
+};
+
+// hash set that iterates in insertion order while nothing is removed
+template<typename K>
+class TSet
+{
+public:
+	int32 Num() const { return m_items.Num(); }
+	void Reserve(int32 num) { m_items.Reserve(num); m_index.reserve(num); }
+	void Reset() { m_items.Reset(); m_index.clear(); }
+	void Empty(int32 slack = 0) { m_items.Empty(slack); m_index.clear(); }
+
+	bool Contains(const K& key) const { return m_index.count(key) > 0; }
+	void Add(const K& key, bool* bIsAlreadyInSetPtr = nullptr)
+	{
+		const bool bInserted = m_index.emplace(key, m_items.Num()).second;
+		if (bInserted)
+		{
+			m_items.Add(key);
+		}
+		if (bIsAlreadyInSetPtr)
+		{
+			*bIsAlreadyInSetPtr = !bInserted;
+		}
+	}
+
+	auto begin() const { return m_items.begin(); }
+	auto end() const { return m_items.end(); }
+
+private:
+	TArray<K> m_items;
+	std::unordered_map<K, int32, FTypeHasher> m_index;
+};
+
+// ---------------------------------------------------------------------------
+// callables
+
+template<typename Signature>
+class TFunctionRef;
+
+// non-owning reference to a callable, valid while the callable lives
+template<typename R, typename... Args>
+class TFunctionRef<R(Args...)>
+{
+public:
+	template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, TFunctionRef>>>
+	TFunctionRef(F&& callable)
+		: m_callable((void*)&callable)
+		, m_invoke([](void* callable, Args... args) -> R { return (*(std::remove_reference_t<F>*)callable)(std::forward<Args>(args)...); })
+	{
+	}
+
+	R operator()(Args... args) const { return m_invoke(m_callable, std::forward<Args>(args)...); }
+
+private:
+	void* m_callable;
+	R (*m_invoke)(void*, Args...);
+};
+
+// ---------------------------------------------------------------------------
+// platform
+
+struct FPlatformAtomics
+{
+	// return the new value
+	static int32 InterlockedIncrement(volatile int32* value) { return __atomic_add_fetch((int32*)value, 1, __ATOMIC_SEQ_CST); }
+	static int32 InterlockedDecrement(volatile int32* value) { return __atomic_sub_fetch((int32*)value, 1, __ATOMIC_SEQ_CST); }
+	static int32 InterlockedAdd(volatile int32* value, int32 amount) { return __atomic_fetch_add((int32*)value, amount, __ATOMIC_SEQ_CST); }
+};
+
+struct FPlatformTime
+{
+	static double Seconds();
+};
+
+struct FPlatformMisc
+{
+	static int32 NumberOfCoresIncludingHyperthreads();
+};
@@ -0,0 +1,9 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// the module header includes the engine, the simulation core only needs Core
+#include "CoreMinimal.h"
+
+// the module header declares its log category, the core does not log
+#define DECLARE_LOG_CATEGORY_EXTERN(...)
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <mutex>
+
+// the engine's HAL/CriticalSection.h, a recursive mutex like on its platforms
+class FCriticalSection
+{
+public:
+	void Lock() { m_mutex.lock(); }
+	void Unlock() { m_mutex.unlock(); }
+
+private:
+	std::recursive_mutex m_mutex;
+};
+
+// holds the lock of a critical section while in scope
+class FScopeLock
+{
+public:
+	explicit FScopeLock(FCriticalSection* section) : m_section(section) { m_section->Lock(); }
+	~FScopeLock() { m_section->Unlock(); }
+	FScopeLock(const FScopeLock&) = delete;
+	FScopeLock& operator=(const FScopeLock&) = delete;
+
+private:
+	FCriticalSection* m_section;
+};
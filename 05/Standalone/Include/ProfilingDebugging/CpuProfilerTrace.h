@@ -0,0 +1,8 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// no trace without the engine, the scopes compile to nothing
+#define TRACE_CPUPROFILER_EVENT_SCOPE(...)
@@ -0,0 +1,18 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// there is no stats system without the engine, the markup compiles to nothing
+#define DECLARE_STATS_GROUP(...)
+#define DECLARE_CYCLE_STAT_EXTERN(...)
+#define DECLARE_DWORD_COUNTER_STAT_EXTERN(...)
+#define DECLARE_FLOAT_COUNTER_STAT_EXTERN(...)
+#define DEFINE_STAT(...)
+#define SCOPE_CYCLE_COUNTER(...)
+#define INC_DWORD_STAT(...)
+#define INC_DWORD_STAT_BY(...)
+#define INC_FLOAT_STAT_BY(...)
+#define SET_DWORD_STAT(...)
+#define SET_FLOAT_STAT(...)
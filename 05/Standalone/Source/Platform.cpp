@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+double
+FPlatformTime::Seconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int32
+FPlatformMisc::NumberOfCoresIncludingHyperthreads()
+{
+	return FMath::Max(1, int32(std::thread::hardware_concurrency()));
+}
+
+/**
+ * Threads waiting for the indices of one ParallelFor at a time. The caller
+ * publishes the body and a new generation, everybody takes indices from an
+ * atomic counter until none are left, and the caller waits until the last
+ * worker left the body.
+ */
+class WorkerPool
+{
+public:
+	~WorkerPool() { resize(1); }
+
+	void resize(int32 threads)
+	{
+		std::lock_guard<std::mutex> submit(m_submit);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wake.notify_all();
+		for (std::thread& thread : m_threads)
+		{
+			thread.join();
+		}
+		m_threads.clear();
+		m_quit = false;
+
+		for (int32 i = 1; i < threads; i++)
+		{
+			m_threads.emplace_back([this] { work(); });
+		}
+	}
+
+	int32 threads() const { return int32(m_threads.size()) + 1; }
+
+	void run(int32 num, TFunctionRef<void(int32)> body)
+	{
+		if (t_worker || m_threads.empty() || num <= 1)
+		{
+			for (int32 i = 0; i < num; i++)
+			{
+				body(i);
+			}
+			return;
+		}
+
+		// one ParallelFor at a time, a second caller waits
+		std::lock_guard<std::mutex> submit(m_submit);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_body = &body;
+			m_num = num;
+			m_next.store(0);
+			m_busy = int32(m_threads.size());
+			m_generation++;
+		}
+		m_wake.notify_all();
+
+		take(body, num);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this] { return m_busy == 0; });
+		m_body = nullptr;
+	}
+
+private:
+	std::vector<std::thread> m_threads;
+	std::mutex m_submit;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	TFunctionRef<void(int32)>* m_body = nullptr;
+	int32 m_num = 0;
+	std::atomic<int32> m_next{ 0 };
+	// workers still inside the current generation
+	int32 m_busy = 0;
+	uint64 m_generation = 0;
+	bool m_quit = false;
+
+	static thread_local bool t_worker;
+
+	void take(TFunctionRef<void(int32)>& body, int32 num)
+	{
+		for (int32 i = m_next.fetch_add(1); i < num; i = m_next.fetch_add(1))
+		{
+			body(i);
+		}
+	}
+
+	void work()
+	{
+		t_worker = true;
+		uint64 seen = 0;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;)
+		{
+			m_wake.wait(lock, [this, seen] { return m_quit || m_generation != seen; });
+			if (m_quit)
+			{
+				return;
+			}
+			seen = m_generation;
+			TFunctionRef<void(int32)>& body = *m_body;
+			const int32 num = m_num;
+
+			lock.unlock();
+			take(body, num);
+			lock.lock();
+
+			if (--m_busy == 0)
+			{
+				m_done.notify_one();
+			}
+		}
+	}
+};
+
+thread_local bool WorkerPool::t_worker = false;
+
+static WorkerPool&
+workerPool()
+{
+	static WorkerPool pool;
+	static std::once_flag started;
+	std::call_once(started, [] { pool.resize(FPlatformMisc::NumberOfCoresIncludingHyperthreads()); });
+	return pool;
+}
+
+void
+ParallelFor(int32 num, TFunctionRef<void(int32)> body, bool bForceSingleThread)
+{
+	if (bForceSingleThread)
+	{
+		for (int32 i = 0; i < num; i++)
+		{
+			body(i);
+		}
+		return;
+	}
+	workerPool().run(num, body);
+}
+
+void
+ParallelFor(int32 num, TFunctionRef<void(int32)> body, EParallelForFlags flags)
+{
+	ParallelFor(num, body, (int32(flags) & int32(EParallelForFlags::ForceSingleThread)) != 0);
+}
+
+void
+StandaloneWorkers::setThreads(int32 count)
+{
+	workerPool().resize(FMath::Max(1, count));
+}
+
+int32
+StandaloneWorkers::getThreads()
+{
+	return workerPool().threads();
+}
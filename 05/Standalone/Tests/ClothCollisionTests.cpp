@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTests.h"
+
+#include "SpringMassSystem.h"
+
+// a hanging lattice cut by the colliders, inside(p) tells a point inside one of them
+template<typename Inside>
+static bool
+collideLattice(const SpringMassColliders& colliders, Inside&& inside)
+{
+	SpringMassSystem system;
+	system.setTopology(SpringMassTopology::getLattice(16, 16, 10.0f));
+	SpringMassSettings settings;
+	settings.sleeping = false;
+	system.applySettings(settings);
+	system.m_collision.m_colliders = colliders;
+
+	const float deltaT = FMath::Min(1 / 200.0f, system.estimateStableStep());
+	int32 touched = 0;
+	for (int32 s = 0; s * deltaT < 2.0f; s++)
+	{
+		system.step(deltaT);
+		for (int32 i = 0; i < system.massPoints.num(); i++)
+		{
+			CHECK(system.massPoints.pinned[i] || !inside(system.massPoints.positions[i]));
+		}
+	}
+	// the colliders pushed the cloth away from its rest shape
+	for (int32 i = 0; i < system.massPoints.num(); i++)
+	{
+		touched += inside(system.getTopology().positions[i]);
+	}
+	CHECK(touched > 0);
+	return true;
+}
+
+SPRING_MASS_TEST(ClothCollisionSphere)
+{
+	SpringMassColliders colliders;
+	colliders.spheres.Add({ FVector3f(75, 2, 60), 25.0f });
+	return collideLattice(colliders, [&colliders](const FVector3f& p)
+	{
+		const SpringMassColliders::Sphere& sphere = colliders.spheres[0];
+		return FVector3f::Dist(p, sphere.center) < sphere.radius;
+	});
+}
+
+SPRING_MASS_TEST(ClothCollisionCapsule)
+{
+	SpringMassColliders colliders;
+	colliders.capsules.Add({ FVector3f(10, -2, 40), FVector3f(140, -2, 40), 6.0f });
+	return collideLattice(colliders, [&colliders](const FVector3f& p)
+	{
+		const SpringMassColliders::Capsule& capsule = colliders.capsules[0];
+		const FVector3f axis = capsule.b - capsule.a;
+		const float t = FMath::Clamp(((p - capsule.a) | axis) / axis.SizeSquared(), 0.0f, 1.0f);
+		return FVector3f::Dist(p, capsule.a + axis * t) < capsule.radius;
+	});
+}
+
+SPRING_MASS_TEST(ClothCollisionPlane)
+{
+	SpringMassColliders colliders;
+	colliders.planes.Add(FPlane4f(FVector3f(0, 0, 30), FVector3f(0, 0.6f, 0.8f)));
+	return collideLattice(colliders, [&colliders](const FVector3f& p)
+	{
+		return colliders.planes[0].PlaneDot(p) < 0.0f;
+	});
+}
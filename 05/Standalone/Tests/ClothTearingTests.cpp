@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTests.h"
+
+#include "SpringMassLod.h"
+#include "SpringMassSystem.h"
+
+#include <cmath>
+
+// root of the set of p, with path halving
+static int32
+findRoot(TArray<int32>& parents, int32 p)
+{
+	while (parents[p] != p)
+	{
+		parents[p] = parents[parents[p]];
+		p = parents[p];
+	}
+	return p;
+}
+
+// pull the left half of the bottom row of a lattice to the left and the other
+// half to the right, pointOf gives the point of system for a lattice point
+template<typename PointOf>
+static void
+pullApart(SpringMassSystem& system, int32 rows, int32 cols, PointOf&& pointOf)
+{
+	for (int32 x = 0; x < cols; x++)
+	{
+		system.addForce(pointOf(x * rows), FVector3f(x < cols / 2 ? -1.0f : 1.0f, 0, 0));
+	}
+}
+
+// a lattice hanging from its top row, pulled apart sideways until it tears
+static bool
+tearLattice(ESpringMassSolver solver, float deltaT)
+{
+	const int32 rows = 30;
+	const int32 cols = 30;
+	SpringMassSystem other;
+	other.setTopology(SpringMassTopology::getLattice(rows, cols, 10.0f));
+	const int32 otherSprings = other.numSprings();
+
+	SpringMassSystem system;
+	system.setTopology(SpringMassTopology::getLattice(rows, cols, 10.0f));
+	SpringMassSettings settings;
+	settings.solver = solver;
+	settings.sleeping = false;
+	settings.tearing = true;
+	settings.tearStrain = 0.5f;
+	system.applySettings(settings);
+	const int32 numPoints = system.massPoints.num();
+
+	for (int32 s = 0; s * deltaT < 4.0f; s++)
+	{
+		if (s * deltaT < 2.0f)
+		{
+			pullApart(system, rows, cols, [](int32 p) { return p; });
+		}
+		system.step(deltaT);
+	}
+
+	// it tore on a copy of its own, the shared lattice is untouched
+	const int32 n = system.massPoints.num();
+	CHECK(n > numPoints);
+	CHECK(&system.getTopology() != &other.getTopology());
+	CHECK(other.numSprings() == otherSprings);
+
+	for (const FVector3f& p : system.massPoints.positions)
+	{
+		CHECK(std::isfinite(p.X) && std::isfinite(p.Y) && std::isfinite(p.Z));
+	}
+	const TArray<uint32>& indices = system.getTriangles();
+	for (uint32 v : indices)
+	{
+		CHECK(int32(v) < n);
+	}
+
+	// springs of one color never share a mass point
+	const TArray<Spring>& springs = system.getSprings();
+	const TArray<int32>& colorOffsets = system.getColorOffsets();
+	TArray<int32> color;
+	color.Init(-1, n);
+	for (int32 c = 0; c + 1 < colorOffsets.Num(); c++)
+	{
+		for (int32 i = colorOffsets[c]; i < colorOffsets[c + 1]; i++)
+		{
+			CHECK(int32(springs[i].m_m1) < n && int32(springs[i].m_m2) < n);
+			CHECK(color[springs[i].m_m1] != c && color[springs[i].m_m2] != c);
+			color[springs[i].m_m1] = c;
+			color[springs[i].m_m2] = c;
+		}
+	}
+
+	// no spring is left between pieces the triangles separated
+	TArray<int32> parents;
+	parents.SetNum(n);
+	for (int32 i = 0; i < n; i++)
+	{
+		parents[i] = i;
+	}
+	for (int32 t = 0; t < indices.Num(); t += 3)
+	{
+		parents[findRoot(parents, indices[t])] = findRoot(parents, indices[t + 1]);
+		parents[findRoot(parents, indices[t + 1])] = findRoot(parents, indices[t + 2]);
+	}
+	for (const Spring& spring : springs)
+	{
+		CHECK(int32(spring.m_m1) < n && int32(spring.m_m2) < n);
+		CHECK(findRoot(parents, spring.m_m1) == findRoot(parents, spring.m_m2));
+	}
+	return true;
+}
+
+SPRING_MASS_TEST(ClothTearingExplicit)
+{
+	return tearLattice(ESpringMassSolver::Explicit, 1 / 400.0f);
+}
+
+SPRING_MASS_TEST(ClothTearingImplicit)
+{
+	return tearLattice(ESpringMassSolver::Implicit, 1 / 90.0f);
+}
+
+SPRING_MASS_TEST(ClothTearingXPBD)
+{
+	return tearLattice(ESpringMassSolver::XPBD, 1 / 90.0f);
+}
+
+SPRING_MASS_TEST(ClothTearingKeepsCoarseLodIntact)
+{
+	const int32 rows = 30;
+	const int32 cols = 30;
+	const float deltaT = 1 / 400.0f;
+	SpringMassSystem fine;
+	fine.setLattice(rows, cols, 10.0f);
+	SpringMassLod lod;
+	lod.init(fine, rows, cols, 10.0f, 2);
+	SpringMassSettings settings;
+	settings.sleeping = false;
+	settings.tearing = true;
+	settings.tearStrain = 0.5f;
+	fine.applySettings(settings);
+	lod.applySettings(settings);
+	const int32 numPoints = fine.massPoints.num();
+	const int32 numCoarse = lod.getCoarse().massPoints.num();
+
+	// the pull that tears the fine lattice only stretches the coarse one, which
+	// goes back and forth between the levels with the points of its maps
+	for (int32 pass = 0; pass < 2; pass++)
+	{
+		lod.beginCoarse(fine, 0.5f);
+		for (int32 s = 0; s * deltaT < 4.0f; s++)
+		{
+			if (s * deltaT < 2.0f)
+			{
+				pullApart(lod.getCoarse(), rows, cols, [&lod](int32 p) { return lod.coarsePointOf(p); });
+			}
+			lod.getCoarse().step(deltaT);
+			lod.advanceBlend(deltaT);
+		}
+		CHECK(lod.getCoarse().massPoints.num() == numCoarse);
+		TArray<FVector3f> positions;
+		lod.interpolate(positions);
+		CHECK(positions.Num() == numPoints);
+
+		lod.endCoarse(fine);
+		for (int32 s = 0; s < 10; s++)
+		{
+			fine.step(deltaT);
+		}
+		CHECK(fine.massPoints.num() == numPoints);
+	}
+
+	// the fine lattice tears, the coarse level no longer fits and is dropped
+	for (int32 s = 0; s * deltaT < 2.0f && fine.massPoints.num() == numPoints; s++)
+	{
+		pullApart(fine, rows, cols, [](int32 p) { return p; });
+		fine.step(deltaT);
+	}
+	CHECK(fine.massPoints.num() > numPoints);
+	lod.reset();
+	CHECK(!lod.isInitialized());
+	return true;
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTests.h"
+
+#include "SpringMassSystem.h"
+
+#include <random>
+
+// the stencil of setLattice gives the forces of the lattice's spring list
+static bool
+matchesSpringList(int32 rows, int32 cols, ESimdLevel simdLevel, bool bParallel)
+{
+	SpringMassSystem springs;
+	springs.setTopology(SpringMassTopology::getLattice(rows, cols, 10.0f));
+	SpringMassSystem stencil;
+	stencil.setLattice(rows, cols, 10.0f);
+	CHECK(stencil.m_grid.isInitialized());
+	CHECK(stencil.getSprings().Num() == 0);
+	CHECK(stencil.numSprings() == springs.numSprings());
+	CHECK(stencil.massPoints.num() == springs.massPoints.num());
+
+	std::mt19937 random(rows * cols);
+	std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+	for (int32 i = 0; i < springs.massPoints.num(); i++)
+	{
+		const FVector3f position(offset(random), offset(random), offset(random));
+		const FVector3f velocity(offset(random), offset(random), offset(random));
+		for (SpringMassSystem* system : { &springs, &stencil })
+		{
+			system->m_simdLevel = simdLevel;
+			system->m_parallel = bParallel;
+			system->massPoints.positions[i] += position;
+			system->massPoints.velocities[i] = velocity;
+		}
+	}
+	springs.updateSprings();
+	stencil.updateSprings();
+
+	float largest = 0;
+	float error = 0;
+	for (int32 i = 0; i < springs.massPoints.num(); i++)
+	{
+		largest = FMath::Max(largest, springs.massPoints.forces[i].Size());
+		error = FMath::Max(error, (springs.massPoints.forces[i] - stencil.massPoints.forces[i]).Size());
+	}
+	CHECK(largest > 0);
+	CHECK(error <= 1e-4f * largest);
+	return true;
+}
+
+SPRING_MASS_TEST(GridStencilMatchesSpringList)
+{
+	// odd sizes leave partial vectors at the ends of the columns
+	CHECK(matchesSpringList(20, 40, ESimdLevel::AVX512, true));
+	CHECK(matchesSpringList(7, 13, ESimdLevel::AVX512, false));
+	CHECK(matchesSpringList(7, 13, ESimdLevel::SSE2, true));
+	CHECK(matchesSpringList(33, 5, ESimdLevel::Scalar, false));
+	return true;
+}
+
+SPRING_MASS_TEST(GridStencilListsSpringsOnDemand)
+{
+	SpringMassSystem system;
+	system.setLattice(8, 12, 10.0f);
+	const int32 numSprings = system.numSprings();
+	CHECK(system.getSprings().Num() == 0);
+
+	// the implicit solver walks the springs
+	SpringMassSettings settings;
+	settings.solver = ESpringMassSolver::Implicit;
+	system.applySettings(settings);
+	CHECK(system.getSprings().Num() == numSprings);
+
+	settings.solver = ESpringMassSolver::Explicit;
+	system.applySettings(settings);
+	CHECK(system.getSprings().Num() == 0);
+	CHECK(system.numSprings() == numSprings);
+	return true;
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTests.h"
+
+#include "MeshSubdivision.h"
+
+SPRING_MASS_TEST(MeshSubdivisionWeightsSumToOne)
+{
+	const SpringMassTopologyRef topology = SpringMassTopology::getLattice(9, 12, 10.0f);
+	TArray<FVector3f> ones;
+	ones.Init(FVector3f(1, 1, 1), topology->positions.Num());
+	for (int32 levels = 0; levels <= 3; levels++)
+	{
+		const MeshSubdivisionRef subdivision = MeshSubdivision::get(topology, levels);
+		CHECK(subdivision->numLevels() == levels);
+		CHECK(subdivision->getIndices().Num() == topology->indices.Num() << (2 * levels));
+		CHECK(subdivision->getUVs().Num() == subdivision->numVertices());
+		for (uint32 v : subdivision->getIndices())
+		{
+			CHECK(int32(v) < subdivision->numVertices());
+		}
+
+		// a constant field stays constant, so every stencil sums to one
+		TArray<FVector3f> vertices;
+		subdivision->evaluate(ones, vertices, SimdKernels::get(ESimdLevel::Scalar), false);
+		CHECK(vertices.Num() == subdivision->numVertices());
+		for (const FVector3f& v : vertices)
+		{
+			CHECK(FMath::Abs(v.X - 1) < 1e-5f && FMath::Abs(v.Y - 1) < 1e-5f && FMath::Abs(v.Z - 1) < 1e-5f);
+		}
+	}
+	return true;
+}
+
+SPRING_MASS_TEST(MeshSubdivisionKeepsOutlineAndPins)
+{
+	// the flat lattice stays in its plane and rectangle, pinned points in place
+	const SpringMassTopologyRef topology = SpringMassTopology::getLattice(9, 12, 10.0f);
+	const MeshSubdivisionRef subdivision = MeshSubdivision::get(topology, 2);
+	TArray<FVector3f> vertices;
+	subdivision->evaluate(topology->positions, vertices, SimdKernels::get(ESimdLevel::Scalar), false);
+
+	FVector3f lower = topology->positions[0];
+	FVector3f upper = topology->positions[0];
+	for (const FVector3f& p : topology->positions)
+	{
+		lower = FVector3f(FMath::Min(lower.X, p.X), FMath::Min(lower.Y, p.Y), FMath::Min(lower.Z, p.Z));
+		upper = FVector3f(FMath::Max(upper.X, p.X), FMath::Max(upper.Y, p.Y), FMath::Max(upper.Z, p.Z));
+	}
+	for (const FVector3f& v : vertices)
+	{
+		CHECK(v.X >= lower.X - 1e-3f && v.X <= upper.X + 1e-3f);
+		CHECK(FMath::Abs(v.Y - lower.Y) < 1e-3f);
+		CHECK(v.Z >= lower.Z - 1e-3f && v.Z <= upper.Z + 1e-3f);
+	}
+	for (int32 i = 0; i < topology->positions.Num(); i++)
+	{
+		CHECK(!topology->pinned[i] || (vertices[i] - topology->positions[i]).Size() < 1e-4f);
+	}
+	return true;
+}
+
+SPRING_MASS_TEST(MeshSubdivisionKernelsAgree)
+{
+	// the gathers of every instruction set, serial and in parallel
+	const SpringMassTopologyRef topology = SpringMassTopology::getLattice(23, 17, 10.0f);
+	const MeshSubdivisionRef subdivision = MeshSubdivision::get(topology, 2);
+	TArray<FVector3f> positions = topology->positions;
+	for (int32 i = 0; i < positions.Num(); i++)
+	{
+		positions[i].Y = FMath::Sin(0.37f * i) * 5.0f;
+	}
+
+	TArray<FVector3f> expected;
+	subdivision->evaluate(positions, expected, SimdKernels::get(ESimdLevel::Scalar), false);
+	for (ESimdLevel level : { ESimdLevel::SSE2, ESimdLevel::AVX2, ESimdLevel::AVX512 })
+	{
+		for (bool bParallel : { false, true })
+		{
+			TArray<FVector3f> vertices;
+			subdivision->evaluate(positions, vertices, SimdKernels::get(level), bParallel);
+			CHECK(vertices.Num() == expected.Num());
+			for (int32 i = 0; i < vertices.Num(); i++)
+			{
+				CHECK((vertices[i] - expected[i]).Size() < 1e-3f);
+			}
+		}
+	}
+	return true;
+}
+
+SPRING_MASS_TEST(MeshSubdivisionIsShared)
+{
+	const SpringMassTopologyRef topology = SpringMassTopology::getLattice(6, 6, 10.0f);
+	const MeshSubdivisionRef first = MeshSubdivision::get(topology, 1);
+	CHECK(&MeshSubdivision::get(topology, 1).Get() == &first.Get());
+	CHECK(&MeshSubdivision::get(topology, 2).Get() != &first.Get());
+	return true;
+}
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTests.h"
+
+#include "RestState.h"
+#include "SpringMassSystem.h"
+
+static void
+hangLattice(SpringMassSystem& system, int32 rows, int32 cols)
+{
+	system.setTopology(SpringMassTopology::getLattice(rows, cols, 10.0f));
+	SpringMassSettings settings;
+	settings.sleeping = false;
+	system.applySettings(settings);
+}
+
+SPRING_MASS_TEST(RestStateRoundTrip)
+{
+	SpringMassSystem baked;
+	hangLattice(baked, 12, 10);
+	TArray<uint8> cache;
+	CHECK(RestStateBaker().bake(baked, cache));
+
+	// a system of the same shape starts from the settled state
+	SpringMassSystem loaded;
+	hangLattice(loaded, 12, 10);
+	CHECK(RestStateCache::read(loaded, MakeArrayView(cache.GetData(), cache.Num())));
+	CHECK(loaded.massPoints.positions == baked.massPoints.positions);
+	CHECK(loaded.massPoints.velocities == baked.massPoints.velocities);
+	CHECK(!(loaded.massPoints.positions == loaded.getTopology().positions));
+
+	// and rewrites the same cache
+	TArray<uint8> rewritten;
+	const RestStateHeader& header = *reinterpret_cast<const RestStateHeader*>(cache.GetData());
+	RestStateCache::write(loaded, header.bakedTime, header.residualSpeed, rewritten);
+	CHECK(rewritten == cache);
+	return true;
+}
+
+SPRING_MASS_TEST(RestStateRejectsOtherSystems)
+{
+	SpringMassSystem baked;
+	hangLattice(baked, 12, 10);
+	baked.step(0.005f);
+	TArray<uint8> cache;
+	RestStateCache::write(baked, 0.005f, 0.0f, cache);
+
+	// another shape, other parameters and a damaged cache leave the system as it was
+	SpringMassSystem other;
+	hangLattice(other, 10, 12);
+	CHECK(other.massPoints.num() == baked.massPoints.num());
+	CHECK(RestStateCache::fingerprint(other) != RestStateCache::fingerprint(baked));
+	CHECK(!RestStateCache::read(other, MakeArrayView(cache.GetData(), cache.Num())));
+	CHECK(other.massPoints.positions == other.getTopology().positions);
+
+	SpringMassSystem stiffer;
+	hangLattice(stiffer, 12, 10);
+	stiffer.m_stiffness *= 2.0f;
+	CHECK(!RestStateCache::read(stiffer, MakeArrayView(cache.GetData(), cache.Num())));
+
+	SpringMassSystem same;
+	hangLattice(same, 12, 10);
+	CHECK(!RestStateCache::read(same, MakeArrayView(cache.GetData(), cache.Num() - 1)));
+	TArray<uint8> damaged = cache;
+	damaged[0] ^= 1;
+	CHECK(!RestStateCache::read(same, MakeArrayView(damaged.GetData(), damaged.Num())));
+	CHECK(same.massPoints.positions == same.getTopology().positions);
+	CHECK(RestStateCache::read(same, MakeArrayView(cache.GetData(), cache.Num())));
+	return true;
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTests.h"
+
+#include "SpringMassSystem.h"
+
+#include <cmath>
+
+// longest spring over its rest length
+static float
+maxStretch(const SpringMassSystem& system)
+{
+	const TArray<FVector3f>& positions = system.massPoints.positions;
+	float stretch = 0;
+	for (const Spring& spring : system.getSprings())
+	{
+		stretch = FMath::Max(stretch, (positions[spring.m_m1] - positions[spring.m_m2]).Size() / spring.m_spring_length_init);
+	}
+	return stretch;
+}
+
+// a lattice hanging from its top row comes to rest with its springs close to their rest lengths
+static bool
+settleLattice(ESpringMassSolver solver)
+{
+	SpringMassSystem system;
+	system.setTopology(SpringMassTopology::getLattice(16, 16, 10.0f));
+	SpringMassSettings settings;
+	settings.solver = solver;
+	settings.sleeping = false;
+	system.applySettings(settings);
+
+	const TArray<FVector3f> rest = system.massPoints.positions;
+	for (int32 s = 0; s < 900; s++)
+	{
+		system.step(1 / 90.0f);
+	}
+
+	float speed = 0;
+	for (int32 i = 0; i < system.massPoints.num(); i++)
+	{
+		const FVector3f& p = system.massPoints.positions[i];
+		CHECK(std::isfinite(p.X) && std::isfinite(p.Y) && std::isfinite(p.Z));
+		CHECK(!system.massPoints.pinned[i] || p == rest[i]);
+		speed = FMath::Max(speed, system.massPoints.velocities[i].Size());
+	}
+	CHECK(speed < 0.1f);
+	CHECK(maxStretch(system) < 1.02f);
+	return true;
+}
+
+SPRING_MASS_TEST(ImplicitSolverSettles)
+{
+	return settleLattice(ESpringMassSolver::Implicit);
+}
+
+SPRING_MASS_TEST(XPBDSolverSettles)
+{
+	return settleLattice(ESpringMassSolver::XPBD);
+}
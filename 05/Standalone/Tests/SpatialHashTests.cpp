@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTests.h"
+
+#include "SpatialHash.h"
+
+#include <random>
+
+// scattered points, more than one parallel build batch
+static TArray<FVector3f>
+randomPoints(int32 num)
+{
+	std::mt19937 random(num);
+	std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+	TArray<FVector3f> positions;
+	positions.Reserve(num);
+	for (int32 i = 0; i < num; i++)
+	{
+		positions.Add(FVector3f(coordinate(random), coordinate(random), coordinate(random)));
+	}
+	return positions;
+}
+
+SPRING_MASS_TEST(SpatialHashFindsEveryNeighbour)
+{
+	const TArray<FVector3f> positions = randomPoints(3 * SpatialHash::BuildBatchSize + 17);
+	const float radius = 4.0f;
+	SpatialHash hash;
+	hash.build(positions, radius, true);
+
+	TArray<int32> reported;
+	reported.Init(0, positions.Num());
+	for (int32 i = 0; i < positions.Num(); i += 97)
+	{
+		const FVector3f extent(radius, radius, radius);
+		hash.forEachPointNear(positions[i] - extent, positions[i] + extent, [&](int32 j)
+		{
+			reported[j]++;
+		});
+		for (int32 j = 0; j < positions.Num(); j++)
+		{
+			// once each, including every point within the radius
+			CHECK(reported[j] <= 1);
+			CHECK(reported[j] == 1 || (positions[j] - positions[i]).Size() > radius);
+			reported[j] = 0;
+		}
+	}
+	return true;
+}
+
+SPRING_MASS_TEST(SpatialHashParallelBuildIsDeterministic)
+{
+	const TArray<FVector3f> positions = randomPoints(5 * SpatialHash::BuildBatchSize);
+	SpatialHash serial;
+	serial.build(positions, 3.0f, false);
+	SpatialHash parallel;
+	parallel.build(positions, 3.0f, true);
+
+	TArray<int32> serialPoints;
+	TArray<int32> parallelPoints;
+	for (int32 i = 0; i < positions.Num(); i += 31)
+	{
+		const FVector3f extent(6.0f, 6.0f, 6.0f);
+		serialPoints.Reset();
+		parallelPoints.Reset();
+		serial.forEachPointNear(positions[i] - extent, positions[i] + extent, [&](int32 j) { serialPoints.Add(j); });
+		parallel.forEachPointNear(positions[i] - extent, positions[i] + extent, [&](int32 j) { parallelPoints.Add(j); });
+		CHECK(serialPoints.Num() > 0);
+		CHECK(serialPoints == parallelPoints);
+	}
+	return true;
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTests.h"
+
+#include <cstring>
+
+SpringMassTest::SpringMassTest(const char* name, Function function)
+	: name(name)
+	, function(function)
+	, next(first())
+{
+	first() = this;
+}
+
+const SpringMassTest*&
+SpringMassTest::first()
+{
+	static const SpringMassTest* tests = nullptr;
+	return tests;
+}
+
+// spring_mass_tests [name...], every test without names
+int
+main(int argc, char** argv)
+{
+	int failed = 0;
+	int found = 0;
+	for (const SpringMassTest* test = SpringMassTest::first(); test; test = test->next)
+	{
+		bool bSelected = argc < 2;
+		for (int i = 1; i < argc; i++)
+		{
+			bSelected |= !std::strcmp(argv[i], test->name);
+		}
+		if (bSelected)
+		{
+			const bool bPassed = test->function();
+			std::printf("%-40s %s\n", test->name, bPassed ? "passed" : "FAILED");
+			failed += !bPassed;
+			found++;
+		}
+	}
+	if (found < argc - 1)
+	{
+		std::fprintf(stderr, "unknown test in the arguments\n");
+		return 1;
+	}
+	return failed > 0;
+}
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdio>
+
+/**
+ * Checks of the spring-mass core without a test framework.
+ *
+ * SPRING_MASS_TEST(Name) defines a test that registers itself with the
+ * runner; spring_mass_tests Name runs one of them and CMake adds a CTest
+ * test for each. A test fails on the first CHECK that does not hold.
+ */
+struct SpringMassTest
+{
+	typedef bool (*Function)();
+
+	SpringMassTest(const char* name, Function function);
+
+	const char* name;
+	Function function;
+	const SpringMassTest* next;
+
+	// tests in reverse order of registration
+	static const SpringMassTest*& first();
+};
+
+#define SPRING_MASS_TEST(Name) \
+	static bool Name(); \
+	static const SpringMassTest Name##Test(#Name, &Name); \
+	static bool Name()
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			return false; \
+		} \
+	} while (0)
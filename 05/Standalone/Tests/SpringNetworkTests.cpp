@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTests.h"
+
+#include "SpringNetwork.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <tuple>
+
+// a sheet of cols x rows unit quads in the xz plane, every quad with vertices
+// of its own split by two triangles along the same diagonal
+static void
+quadSheet(int32 cols, int32 rows, TArray<FVector3f>& positions, TArray<uint32>& indices)
+{
+	for (int32 x = 0; x < cols; x++)
+	{
+		for (int32 z = 0; z < rows; z++)
+		{
+			const uint32 first = positions.Num();
+			positions.Add(FVector3f(x, 0, z));
+			positions.Add(FVector3f(x + 1, 0, z));
+			// within the weld distance of the neighbours' copies
+			positions.Add(FVector3f(x + 1, 0.001f, z + 1));
+			positions.Add(FVector3f(x, 0, z + 1));
+			indices.Append({ first, first + 1, first + 2, first, first + 2, first + 3 });
+		}
+	}
+}
+
+SPRING_MASS_TEST(SpringNetworkCountsQuadSprings)
+{
+	const int32 cols = 5;
+	const int32 rows = 3;
+	TArray<FVector3f> positions;
+	TArray<uint32> indices;
+	quadSheet(cols, rows, positions, indices);
+
+	SpringNetworkBuilder builder;
+	SpringNetwork network;
+	builder.build(positions, indices, TArray<FVector2f>(), network);
+
+	CHECK(network.positions.Num() == (cols + 1) * (rows + 1));
+	CHECK(network.indices.Num() == indices.Num());
+	CHECK(network.pinned.Num() == cols + 1);
+	// the edges of the quads, the diagonal and the other diagonal of every quad,
+	// and the corners opposite to the edges between two quads
+	CHECK(network.numStructural == cols * (rows + 1) + (cols + 1) * rows);
+	CHECK(network.numShear == 2 * cols * rows);
+	CHECK(network.numBending == cols * (rows - 1) + (cols - 1) * rows);
+	CHECK(network.springs.Num() == network.numStructural + network.numShear + network.numBending);
+	for (uint32 v : network.indices)
+	{
+		CHECK(int32(v) < network.positions.Num());
+	}
+	return true;
+}
+
+SPRING_MASS_TEST(SpringNetworkWeldsByDistance)
+{
+	TArray<FVector3f> positions;
+	TArray<uint32> indices;
+	quadSheet(4, 4, positions, indices);
+
+	SpringNetworkBuilder builder;
+	SpringNetwork network;
+	builder.m_weldDistance = 0.0001f;
+	builder.build(positions, indices, TArray<FVector2f>(), network);
+	// the raised corner of every quad stays a point of its own, the far corner
+	// of the sheet has no other copy
+	CHECK(network.positions.Num() == 5 * 5 - 1 + 4 * 4);
+
+	builder.m_shear = false;
+	builder.m_bending = false;
+	builder.m_weldDistance = 0.01f;
+	builder.build(positions, indices, TArray<FVector2f>(), network);
+	CHECK(network.positions.Num() == 5 * 5);
+	CHECK(network.numShear == 0 && network.numBending == 0);
+	CHECK(network.springs.Num() == network.numStructural);
+	return true;
+}
+
+// integer grid position of a point, as one number
+static int32
+cellOf(const SpringNetwork& network, uint32 p)
+{
+	return FMath::RoundToInt(network.positions[p].X) * 1000 + FMath::RoundToInt(network.positions[p].Z);
+}
+
+// the springs, triangles and pins by the positions of their points, which no numbering changes
+static std::set<std::tuple<int32, int32, int32>>
+shapeOf(const SpringNetwork& network)
+{
+	std::set<std::tuple<int32, int32, int32>> shape;
+	for (const Spring& spring : network.springs)
+	{
+		const int32 a = cellOf(network, spring.m_m1);
+		const int32 b = cellOf(network, spring.m_m2);
+		shape.insert({ -1, FMath::Min(a, b), FMath::Max(a, b) });
+	}
+	for (int32 t = 0; t < network.indices.Num(); t += 3)
+	{
+		int32 corners[3] = { cellOf(network, network.indices[t]), cellOf(network, network.indices[t + 1]), cellOf(network, network.indices[t + 2]) };
+		// the smallest corner first keeps the winding
+		std::rotate(corners, std::min_element(corners, corners + 3), corners + 3);
+		shape.insert({ corners[0], corners[1], corners[2] });
+	}
+	for (uint32 p : network.pinned)
+	{
+		shape.insert({ -2, cellOf(network, p), 0 });
+	}
+	return shape;
+}
+
+// largest index distance between the ends of a spring
+static int32
+bandwidth(const SpringNetwork& network)
+{
+	int32 width = 0;
+	for (const Spring& spring : network.springs)
+	{
+		width = FMath::Max(width, FMath::Abs(int32(spring.m_m1) - int32(spring.m_m2)));
+	}
+	return width;
+}
+
+SPRING_MASS_TEST(SpringNetworkOrderIsPermutation)
+{
+	// a 20 x 20 grid with its vertices shuffled, texture coordinates from the position
+	const int32 size = 20;
+	TArray<int32> shuffled;
+	for (int32 i = 0; i < size * size; i++)
+	{
+		shuffled.Add(i);
+	}
+	std::mt19937 random(7);
+	std::shuffle(shuffled.GetData(), shuffled.GetData() + shuffled.Num(), random);
+	TArray<FVector3f> positions;
+	TArray<FVector2f> uvs;
+	positions.SetNum(size * size);
+	uvs.SetNum(size * size);
+	for (int32 i = 0; i < size * size; i++)
+	{
+		positions[shuffled[i]] = FVector3f(i / size, 0, i % size);
+		uvs[shuffled[i]] = FVector2f(float(i / size) / size, float(i % size) / size);
+	}
+	TArray<uint32> indices;
+	for (int32 x = 0; x + 1 < size; x++)
+	{
+		for (int32 z = 0; z + 1 < size; z++)
+		{
+			const uint32 p = shuffled[x * size + z];
+			const uint32 right = shuffled[(x + 1) * size + z];
+			const uint32 up = shuffled[x * size + z + 1];
+			const uint32 corner = shuffled[(x + 1) * size + z + 1];
+			indices.Append({ p, right, corner, p, corner, up });
+		}
+	}
+
+	SpringNetworkBuilder builder;
+	builder.m_order = ESpringNetworkOrder::None;
+	SpringNetwork meshOrder;
+	builder.build(positions, indices, uvs, meshOrder);
+	const std::set<std::tuple<int32, int32, int32>> shape = shapeOf(meshOrder);
+
+	for (ESpringNetworkOrder order : { ESpringNetworkOrder::ReverseCuthillMcKee, ESpringNetworkOrder::Morton })
+	{
+		builder.m_order = order;
+		SpringNetwork network;
+		builder.build(positions, indices, uvs, network);
+
+		// every point once, with its texture coordinates
+		CHECK(network.positions.Num() == size * size);
+		CHECK(network.uvs.Num() == size * size);
+		TArray<int32> seen;
+		seen.Init(0, size * size);
+		for (int32 p = 0; p < network.positions.Num(); p++)
+		{
+			const int32 x = FMath::RoundToInt(network.positions[p].X);
+			const int32 z = FMath::RoundToInt(network.positions[p].Z);
+			CHECK(++seen[x * size + z] == 1);
+			CHECK(network.uvs[p] == FVector2f(float(x) / size, float(z) / size));
+		}
+
+		// the same springs, triangles and pins between the same positions, closer in memory
+		CHECK(network.springs.Num() == meshOrder.springs.Num());
+		CHECK(network.numStructural == meshOrder.numStructural);
+		CHECK(shapeOf(network) == shape);
+		CHECK(bandwidth(network) < bandwidth(meshOrder));
+	}
+	return true;
+}
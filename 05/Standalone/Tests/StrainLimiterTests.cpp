@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpringMassTests.h"
+
+#include "SpringMassSystem.h"
+
+#include <random>
+
+// longest spring over its rest length
+static float
+maxStretch(const SpringMassSystem& system)
+{
+	const TArray<FVector3f>& positions = system.massPoints.positions;
+	float stretch = 0;
+	for (const Spring& spring : system.getSprings())
+	{
+		stretch = FMath::Max(stretch, (positions[spring.m_m1] - positions[spring.m_m2]).Size() / spring.m_spring_length_init);
+	}
+	return stretch;
+}
+
+SPRING_MASS_TEST(StrainLimiterBoundsStretch)
+{
+	SpringMassSystem system;
+	system.setTopology(SpringMassTopology::getLattice(16, 16, 10.0f));
+	SpringMassSettings settings;
+	settings.sleeping = false;
+	settings.strainLimiting = true;
+	system.applySettings(settings);
+
+	// points scattered far beyond the limit
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> offset(-3.0f, 3.0f);
+	for (int32 i = 0; i < system.massPoints.num(); i++)
+	{
+		if (!system.massPoints.pinned[i])
+		{
+			system.massPoints.positions[i] += FVector3f(offset(random), offset(random), offset(random));
+		}
+	}
+	const TArray<FVector3f> scattered = system.massPoints.positions;
+	CHECK(maxStretch(system) > 1.5f);
+
+	StrainLimiter& limiter = system.m_strainLimiter;
+	limiter.m_maxIterations = 100;
+	limiter.apply(system, 1 / 200.0f);
+	CHECK(maxStretch(system) <= (1.0f + limiter.m_maxStrain) * 1.0001f);
+	for (int32 i = 0; i < system.massPoints.num(); i++)
+	{
+		CHECK(!system.massPoints.pinned[i] || system.massPoints.positions[i] == scattered[i]);
+	}
+	return true;
+}
+
+SPRING_MASS_TEST(StrainLimiterHoldsSoftCloth)
+{
+	// soft springs under a pull that would stretch them far past the limit
+	SpringMassSystem system;
+	system.setTopology(SpringMassTopology::getLattice(16, 16, 10.0f));
+	system.m_stiffness = 0.02f;
+	SpringMassSettings settings;
+	settings.sleeping = false;
+	settings.strainLimiting = true;
+	system.applySettings(settings);
+
+	const float deltaT = FMath::Min(1 / 200.0f, system.estimateStableStep());
+	for (int32 s = 0; s * deltaT < 3.0f; s++)
+	{
+		for (int32 x = 0; x < 16; x++)
+		{
+			system.addForce(x * 16, FVector3f(0, 0, -0.02f));
+		}
+		system.step(deltaT);
+		// the sweeps of one step may leave a little over the limit, the next step takes it back
+		CHECK(maxStretch(system) <= (1.0f + system.m_strainLimiter.m_maxStrain) * 1.01f);
+	}
+	return true;
+}